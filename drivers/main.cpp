@@ -5,13 +5,25 @@
 
 #include "custom_functions.h"
 #include "visibility_polygon.h"
+#include "segment_simplification.h"
+#include "obstacles.h"
+#include "convex_decomposition.h"
+#include "geometry_store.h"
+#include "geometry_transaction.h"
+#include "edit_history.h"
+#include "prefabs.h"
+#include "primitives.h"
+#include "scene_file.h"
+#include "scene_codec.h"
+#include "svg_import.h"
+#include "geo_import.h"
+#include "raster_import.h"
+#include "scene_reload.h"
+#include "tiled_world.h"
+#include "edit_journal.h"
 
 
 // Use "vf2d" and "vi2d" where appropriate
-// Add bounding box method.
-// Add convex polygon method.
-// Change container from a vector to list (if it is better).
-// Add posibility to select multiple nodes at once.
 // Show node numbering and show line numbering
 
 
@@ -49,6 +61,45 @@ private: // Drawing rutine coordinate transformations
 	}
 
 
+	// Rebuild the obstacles and their convex pieces if the geometry changed since they were built
+	void UpdateObstacles()
+	{
+		if (bObstaclesValid && nObstacleNodeVersion == geometry.GetNodeVersion() && nObstacleSegmentVersion == geometry.GetSegmentVersion())
+		{
+			return;
+		}
+		const std::vector<olc::vf2d>& nodes = geometry.GetNodes();
+		obstacles = FindObstacles(nodes, geometry.GetSegments());
+		pieces = DecomposeObstacles(nodes, obstacles, &failedObstacles);
+		nObstacleNodeVersion = geometry.GetNodeVersion();
+		nObstacleSegmentVersion = geometry.GetSegmentVersion();
+		bObstaclesValid = true;
+	}
+
+	// Rebuild the levels of detail if the geometry changed since they were built. With "bDefer" they are not rebuilt,
+	// e.g. while a drag changes the geometry every frame. Returns "false" if the levels are out of date.
+	bool UpdateLevelsOfDetail(const bool& bDefer)
+	{
+		if (bLevelsValid && nLevelNodeVersion == geometry.GetNodeVersion() && nLevelSegmentVersion == geometry.GetSegmentVersion())
+		{
+			return true;
+		}
+		if (bDefer) { return false; }
+		levels = BuildLevelsOfDetail(geometry.GetNodes(), geometry.GetSegments(), fLevelBaseTolerance, nLevels);
+		nLevelNodeVersion = geometry.GetNodeVersion();
+		nLevelSegmentVersion = geometry.GetSegmentVersion();
+		bLevelsValid = true;
+		return true;
+	}
+
+	// Store the edits of one user action for undo and in the autosave journal
+	void PushEdits(const std::vector<GeometryEdit>& edits, const bool& bMerge = false)
+	{
+		history.Push(edits, bMerge);
+		journal.Record(edits);
+	}
+
+
 private: // Private variables
 	
 	// Panning and scaling default variables
@@ -64,10 +115,22 @@ private: // Private variables
 	bool bDisplayLineSegmentInfo = false;
 	bool bDisplaySelfIntersections = false;
 
+	// Simplification tolerance in pixels at the current zoom level
+	float fSimplificationTolerance = 1.0f;
+
+	// Simplified levels of detail that are displayed instead of the geometry, rebuilt when the geometry versions
+	// change. The levels cover the tolerances of the whole zoom range, the geometry itself is not changed.
+	bool bDisplayLevelOfDetail = false;
+	std::vector<GeometryLOD> levels;
+	float fLevelBaseTolerance = 0.01f;
+	int nLevels = 14;
+	uint64_t nLevelNodeVersion = 0;
+	uint64_t nLevelSegmentVersion = 0;
+	bool bLevelsValid = false;
+
 	// Other flags
 	bool bIsSelected = false;
 	int32_t nSelectionSize = 10;
-	int32_t nSelectionSizeSquared = nSelectionSize * nSelectionSize;
 
 	// Drawing selection
 	bool bToolbarMode = false;
@@ -91,15 +154,79 @@ private: // Private variables
 	olc::vf2d vTL_W, vTR_W, vBL_W, vBR_W;
 
 	// Currently node and segment
-	int i_segment = -1;
-	int i_node = -1;
-	int i_node_start = -1;
-	int i_node_end = -1;
+	SegmentHandle h_segment;
+	NodeHandle h_node;
+	NodeHandle h_node_start;
 	olc::vf2d vDifferenceStart, vDifferenceEnd;
 
-	// Geometry
-	std::vector<olc::vf2d> nodes;
-	std::vector<std::array<int, 2>> segments;
+	// Multi-selection, the box corner or the lasso points are in world space
+	std::vector<NodeHandle> selection;
+	std::vector<NodeHandle> selectionCandidates;
+	std::vector<olc::vf2d> selectionLasso;
+	olc::vf2d vSelectionStart;
+	olc::vf2d vSelectionDrag;
+	bool bSelecting = false;
+	float fSelectionRotationSpeed = 1.0f;
+
+	// Geometry, its undo history and its autosave journal, which restores the last session on start
+	GeometryStore geometry;
+	EditHistory history;
+	EditJournal journal;
+	std::string sJournalPath = "autosave";
+	std::vector<GeometryEdit> historyEdits;
+
+	// Prefab definitions and their placed instances, the last created prefab is placed in the prefab mode
+	PrefabScene prefabs;
+	std::vector<int32_t> visibleInstances;
+	int nPrefab = -1;
+	float fPrefabRotationSpeed = 1.0f;
+	float fPrefabRotation = 0.0f;
+
+	// Solid rectangles, circles and convex polygons, the polygon points are collected before it is made
+	std::vector<Primitive> primitives;
+	std::vector<olc::vf2d> primitivePoints;
+	olc::vf2d vPrimitiveStart;
+
+	// Compact the geometry store when more than this fraction of its slots is free
+	float fMaxFragmentation = 0.5f;
+
+	// Scene file that is written and read with the save and load keys
+	std::string sScenePath = "scene.sc2d";
+
+	// Changes of the scene file made by other programs are applied to the geometry as edits
+	FileWatcher sceneWatcher;
+
+	// Compressed scene file that is written and read while SHIFT is held, positions are rounded to the quantum
+	std::string sCompressedScenePath = "scene.sc2z";
+	float fSceneQuantum = 1e-3f;
+
+	// Floorplan that is added to the geometry with the import key
+	std::string sSvgPath = "floorplan.svg";
+
+	// Scanned floorplan that is vectorized with the import key while SHIFT is held, one pixel is one world unit
+	std::string sRasterPath = "floorplan.png";
+
+	// Map in GeoJSON or WKT that is added to the geometry with the import key
+	std::string sGeoPath = "map.geojson";
+
+	// Tiled world that is streamed around the screen, the loaded geometry on the screen is gathered every frame
+	TiledWorld world;
+	std::string sWorldPath = "world.sc2w";
+	float fWorldChunkSize = 256.0f;
+	size_t nWorldMemoryBudget = size_t(256) << 20;
+	std::vector<olc::vf2d> worldNodes;
+	std::vector<std::array<int, 2>> worldSegments;
+
+	// Self-intersections, only the part inside the dirty region of the geometry is recomputed
+	std::vector<olc::vf2d> intersections;
+
+	// Obstacles and their convex pieces, rebuilt when the geometry versions change
+	std::vector<Obstacle> obstacles;
+	std::vector<ConvexPiece> pieces;
+	std::vector<int> failedObstacles; // Obstacles with a hole that could not be bridged, they have no pieces
+	uint64_t nObstacleNodeVersion = 0;
+	uint64_t nObstacleSegmentVersion = 0;
+	bool bObstaclesValid = false;
 
 
 
@@ -123,6 +250,9 @@ private: // Private variables
 	olc::Pixel color_TempNode = olc::YELLOW;
 	olc::Pixel color_Intersection = olc::RED;
 	olc::Pixel color_VisibilityPolygon = olc::DARK_YELLOW;
+	olc::Pixel color_Prefab = olc::CYAN;
+	olc::Pixel color_Primitive = olc::MAGENTA;
+	olc::Pixel color_World = olc::GREY;
 
 	// Layers
 	int nLayerBouncingBall = 0;
@@ -145,8 +275,11 @@ public:
 		
 		// Reserve the number of nodes and segments
 		// TODO : Optimize this
-		nodes.reserve(16);
-		segments.reserve(16);
+		geometry.Reserve(16, 16);
+
+		// Restore the geometry of the last session
+		journal.Open(sJournalPath, &geometry);
+		sceneWatcher.Watch(sScenePath);
 
 		// Create layers in order from top to bottom
 		nLayerToolbar = CreateLayer();
@@ -219,13 +352,55 @@ public:
 		// | DISPLAY ALL GEOMETRY	                                                      |
 		// O------------------------------------------------------------------------------O
 		SetDrawTarget(nLayerGeometry);
-		for (int i = 0; i < segments.size(); i++)
+		const std::vector<olc::vf2d>& nodes = geometry.GetNodes();
+		const std::vector<std::array<int, 2>>& segments = geometry.GetSegments();
+		if (GetKey(olc::Key::S).bPressed && nMode == 0)
+		{
+			bDisplayLevelOfDetail = !bDisplayLevelOfDetail;
+		}
+		// The level of detail is selected for the current zoom. The levels are rebuilt once a drag ends, until then
+		// the geometry itself is shown.
+		const std::vector<olc::vf2d>* nodes_displayed = &nodes;
+		const std::vector<std::array<int, 2>>* segments_displayed = &segments;
+		if (bDisplayLevelOfDetail && UpdateLevelsOfDetail(GetMouse(0).bHeld))
+		{
+			const GeometryLOD& level = SelectLevelOfDetail(levels, fScale, fSimplificationTolerance);
+			nodes_displayed = &level.nodes;
+			segments_displayed = &level.segments;
+		}
+		for (int i = 0; i < segments_displayed->size(); i++)
+		{
+			DrawLine(w2s((*nodes_displayed)[(*segments_displayed)[i][0]]), w2s((*nodes_displayed)[(*segments_displayed)[i][1]]), color_Line);
+		}
+		for (int i = 0; i < nodes_displayed->size(); i++)
 		{
-			DrawLine(w2s(nodes[segments[i][0]]), w2s(nodes[segments[i][1]]), color_Line);
+			FillCircle(w2s((*nodes_displayed)[i]), 2, color_Node);
 		}
-		for (int i = 0; i < nodes.size(); i++)
+		// Only the prefab instances inside the screen are transformed to world space
+		prefabs.FindInstancesInBox(vBL_W, vTR_W, &visibleInstances);
+		for (int32_t i_instance : visibleInstances)
 		{
-			FillCircle(w2s(nodes[i]), 2, color_Node);
+			const PrefabInstance& instance = prefabs.GetInstance(i_instance);
+			const Prefab& prefab = prefabs.GetPrefab(instance.nPrefab);
+			for (int i = 0; i < prefab.segments.size(); i++)
+			{
+				DrawLine(w2s(prefabs.ToWorld(instance, prefab.nodes[prefab.segments[i][0]])), w2s(prefabs.ToWorld(instance, prefab.nodes[prefab.segments[i][1]])), color_Prefab);
+			}
+		}
+		// Primitives outside the screen are skipped with their bounding box
+		for (int i = 0; i < primitives.size(); i++)
+		{
+			const Primitive& primitive = primitives[i];
+			if (primitive.vMax.x < vBL_W.x || primitive.vMax.y < vBL_W.y || primitive.vMin.x > vTR_W.x || primitive.vMin.y > vTR_W.y) { continue; }
+			if (primitive.nType == PrimitiveType::Circle)
+			{
+				DrawCircle(w2s(primitive.vCenter), int(primitive.fRadius * fScale), color_Primitive);
+				continue;
+			}
+			for (int j = 0; j < primitive.vertices.size(); j++)
+			{
+				DrawLine(w2s(primitive.vertices[j]), w2s(primitive.vertices[(j + 1) % primitive.vertices.size()]), color_Primitive);
+			}
 		}
 		SetDrawTarget(nullptr);
 
@@ -353,23 +528,21 @@ public:
 		if (nMode == 1)
 		{	
 			olc::vf2d temp_MP = vMP_W;
-			float squaredDistance;
 			bool bNodeExists = false;
 
 			// Snap mouse pointer to the nearest existing node
-			if (!nodes.empty())
+			NodeHandle temp_h_node = geometry.FindNearestNode(temp_MP, float(nSelectionSize) / fScale);
+			if (geometry.IsValid(temp_h_node))
 			{
-				i_node = FindClosestNode(temp_MP, nodes, &squaredDistance);
-				if (squaredDistance * fScale * fScale <= nSelectionSizeSquared)
-				{
-					temp_MP = nodes[i_node];
-					bNodeExists = true;
-					DrawCircle(w2s(temp_MP), nSelectionSize, color_Selection);
-				}
+				temp_MP = geometry.GetNodePosition(temp_h_node);
+				bNodeExists = true;
+				DrawCircle(w2s(temp_MP), nSelectionSize, color_Selection);
 			}
 			if (GetMouse(0).bPressed && !bNodeExists)
 			{
-				nodes.push_back(temp_MP);
+				GeometryTransaction transaction(&geometry);
+				transaction.AddNode(temp_MP);
+				PushEdits(transaction.GetEdits());
 			}
 			FillCircle(w2s(temp_MP), 2, color_TempNode);
 		}
@@ -383,7 +556,7 @@ public:
 		// Enter the "move nodes" mode
 		if (nMode == 0 && GetKey(olc::Key::K2).bPressed)
 		{
-			i_node = -1;
+			h_node = NodeHandle();
 			nMode = 2;
 		}
 		// Exit the "move nodes" mode
@@ -392,37 +565,35 @@ public:
 			nMode = 0;
 		}
 		// Select the node
-		if (nMode == 2 && i_node == -1)
+		if (nMode == 2 && !geometry.IsValid(h_node))
 		{
 			olc::vf2d temp_MP = vMP_W;
-			float squaredDistance;
 
 			// Snap mouse pointer to the nearest existing node
-			if (!nodes.empty())
+			NodeHandle temp_h_node = geometry.FindNearestNode(temp_MP, float(nSelectionSize) / fScale);
+			if (geometry.IsValid(temp_h_node))
 			{
-				int temp_i_node = FindClosestNode(temp_MP, nodes, &squaredDistance);
-				if (squaredDistance * fScale * fScale <= nSelectionSizeSquared)
-				{
-					temp_MP = nodes[temp_i_node];
-					DrawCircle(w2s(temp_MP), nSelectionSize, color_Selection);
+				temp_MP = geometry.GetNodePosition(temp_h_node);
+				DrawCircle(w2s(temp_MP), nSelectionSize, color_Selection);
 
-					if (GetMouse(0).bPressed)
-					{
-						i_node = temp_i_node;
-					}
+				if (GetMouse(0).bPressed)
+				{
+					h_node = temp_h_node;
 				}
 			}
 		}
 		// Move the node
-		if (nMode == 2 && i_node != -1 && GetMouse(0).bHeld)
+		if (nMode == 2 && geometry.IsValid(h_node) && GetMouse(0).bHeld)
 		{
 			DrawCircle(vMP_S, nSelectionSize, color_Selection);
-			nodes[i_node] = vMP_W;
+			GeometryTransaction transaction(&geometry);
+			transaction.MoveNode(h_node, vMP_W);
+			PushEdits(transaction.GetEdits(), !GetMouse(0).bPressed);
 		}
 		// De-select the node
-		if (nMode == 2 && i_node != -1 && GetMouse(0).bReleased)
+		if (nMode == 2 && geometry.IsValid(h_node) && GetMouse(0).bReleased)
 		{
-			i_node = -1;
+			h_node = NodeHandle();
 		}
 		SetDrawTarget(nullptr);
 
@@ -445,37 +616,22 @@ public:
 		if (nMode == 3)
 		{
 			olc::vf2d temp_MP = vMP_W;
-			float squaredDistance;
 			bool bNodeExists = false;
 
 			// Snap mouse pointer to the nearest existing node
-			if (!nodes.empty())
+			NodeHandle temp_h_node = geometry.FindNearestNode(temp_MP, float(nSelectionSize) / fScale);
+			if (geometry.IsValid(temp_h_node))
 			{
-				i_node = FindClosestNode(temp_MP, nodes, &squaredDistance);
-				if (squaredDistance * fScale * fScale <= nSelectionSizeSquared)
-				{
-					temp_MP = nodes[i_node];
-					bNodeExists = true;
-					DrawCircle(w2s(temp_MP), nSelectionSize, olc::GREEN);
-				}
+				temp_MP = geometry.GetNodePosition(temp_h_node);
+				bNodeExists = true;
+				DrawCircle(w2s(temp_MP), nSelectionSize, olc::GREEN);
 			}
-			// Delete the selected node
+			// Delete the selected node, connected segments are deleted with it
 			if (GetMouse(0).bPressed && bNodeExists)
 			{	
-				// Find and delete connected segments
-				std::vector<int> connectedSegments = FindConnectedSegments(i_node, segments);
-				for (int i = connectedSegments.size()-1; i >= 0; i--)
-				{
-					segments.erase(segments.begin() + connectedSegments[i]);
-				}
-				// Re-number the remaining segments
-				for (int i = 0; i < segments.size(); i++)
-				{
-					if (segments[i][0] >= i_node) { segments[i][0] -= 1; }
-					if (segments[i][1] >= i_node) { segments[i][1] -= 1; }
-				}
-				// Delete the selected node
-				nodes.erase(nodes.begin() + i_node);
+				GeometryTransaction transaction(&geometry);
+				transaction.DeleteNode(temp_h_node);
+				PushEdits(transaction.GetEdits());
 			}
 		}
 		SetDrawTarget(nullptr);
@@ -493,71 +649,62 @@ public:
 		// Exit the "add line segment" mode
 		else if (nMode == 4 && (GetKey(olc::Key::K4).bPressed || GetKey(olc::Key::ESCAPE).bPressed))
 		{	
-			i_node_start = -1;
-			i_node_end = -1;
+			h_node_start = NodeHandle();
 			nMode = 0;
 		}
 		// Add a line segment
 		if (nMode == 4)
 		{
 			olc::vf2d vMP_W_temp = vMP_W;
-			float squaredDistance;
 			bool bNodeExists = false;
 
-			// Check if any nodes exist
-			if (nodes.empty())
+			bool bStartExists = geometry.IsValid(h_node_start);
+
+			// Snap mouse pointer to the nearest existing node
+			NodeHandle temp_h_node = geometry.FindNearestNode(vMP_W, float(nSelectionSize) / fScale);
+			if (geometry.IsValid(temp_h_node))
 			{
-				FillCircle(vMP_S, 2, color_TempNode);
-				if (i_node_start != -1) { DrawLine(w2s(nodes[i_node_start]), vMP_S, color_TempLine); }
+				vMP_W_temp = geometry.GetNodePosition(temp_h_node);
+				bNodeExists = true;
+				DrawCircle(w2s(vMP_W_temp), nSelectionSize, color_Selection);
+				FillCircle(w2s(vMP_W_temp), 2, color_TempNode);
+				if (bStartExists) { DrawLine(w2s(geometry.GetNodePosition(h_node_start)), w2s(vMP_W_temp), color_TempLine); }
 			}
 			else
 			{
-				i_node = FindClosestNode(vMP_W, nodes, &squaredDistance);
-				if (squaredDistance * fScale * fScale <= nSelectionSizeSquared)
-				{
-					vMP_W_temp = nodes[i_node];
-					bNodeExists = true;
-					DrawCircle(w2s(vMP_W_temp), nSelectionSize, color_Selection);
-					FillCircle(w2s(vMP_W_temp), 2, color_TempNode);
-					if (i_node_start != -1) { DrawLine(w2s(nodes[i_node_start]), w2s(vMP_W_temp), color_TempLine); }
-				}
-				else
-				{
-					FillCircle(vMP_S, 2, color_TempNode);
-					if (i_node_start != -1) { DrawLine(w2s(nodes[i_node_start]), vMP_S, color_TempLine); }
-				}
+				FillCircle(vMP_S, 2, color_TempNode);
+				if (bStartExists) { DrawLine(w2s(geometry.GetNodePosition(h_node_start)), vMP_S, color_TempLine); }
 			}
-			// First selection - push back a new node and assign it to "start"
-			if (GetMouse(0).bPressed && !bNodeExists && i_node_start == -1)
+			GeometryTransaction transaction(&geometry);
+
+			// First selection - add a new node and assign it to "start"
+			if (GetMouse(0).bPressed && !bNodeExists && !bStartExists)
 			{
-				nodes.push_back(vMP_W_temp);
-				i_node_start = nodes.size() - 1;
+				h_node_start = transaction.AddNode(vMP_W_temp);
 			}
 			// First selection - selected node is the "start"
-			else if (GetMouse(0).bPressed && bNodeExists && i_node_start == -1)
+			else if (GetMouse(0).bPressed && bNodeExists && !bStartExists)
 			{
-				i_node_start = i_node;
+				h_node_start = temp_h_node;
 			}
-			// Second selection - push back a new node and assign it to "end"
-			else if (GetMouse(0).bPressed && !bNodeExists && i_node_start != -1)
+			// Second selection - add a new node and assign it to "end"
+			else if (GetMouse(0).bPressed && !bNodeExists && bStartExists)
 			{
-				nodes.push_back(vMP_W_temp);
-				i_node_end = nodes.size() - 1;
-				segments.push_back({i_node_start, i_node_end});
-				i_node_start = i_node_end;
+				NodeHandle h_node_end = transaction.AddNode(vMP_W_temp);
+				transaction.AddSegment(h_node_start, h_node_end);
+				h_node_start = h_node_end;
 
 			}
 			// Second selection - selected node is the "end"
-			else if (GetMouse(0).bPressed && bNodeExists && i_node_start != -1)
+			else if (GetMouse(0).bPressed && bNodeExists && bStartExists)
 			{
-				i_node_end = i_node;
-				std::array<int, 2> temp_segment = {i_node_start, i_node_end};
-				if (!DoesSegmentExist(temp_segment, segments) && i_node_start != i_node_end)
+				NodeHandle h_node_end = temp_h_node;
+				if (transaction.AddSegment(h_node_start, h_node_end).nSlot != -1)
 				{
-					segments.push_back({ i_node_start, i_node_end });
-					i_node_start = i_node_end;
+					h_node_start = h_node_end;
 				}
 			}
+			PushEdits(transaction.GetEdits());
 		}
 		SetDrawTarget(nullptr);
 
@@ -569,7 +716,7 @@ public:
 		// Enter the "move line segments" mode
 		if (nMode == 0 && GetKey(olc::Key::K5).bPressed)
 		{
-			i_segment = -1;
+			h_segment = SegmentHandle();
 			nMode = 5;
 		}
 		// Exit the "move line segments" mode
@@ -578,52 +725,50 @@ public:
 			nMode = 0;
 		}
 		// Select the line segment
-		if (nMode == 5 && i_segment == -1)
+		if (nMode == 5 && !geometry.IsValid(h_segment))
 		{	
-			olc::vf2d temp_Start, temp_End;
-			float squaredDistance;
-
 			// Snap mouse pointer to the nearest existing line segment
-			if (!segments.empty())
+			SegmentHandle temp_h_segment = geometry.FindNearestSegment(vMP_W, float(nSelectionSize) / fScale);
+			if (geometry.IsValid(temp_h_segment))
 			{
-				int temp_i_segment = FindClosestLineSegment(vMP_W, nodes, segments, &squaredDistance);
-				if (squaredDistance * fScale * fScale <= nSelectionSizeSquared)
+				// Show selected segment
+				std::array<NodeHandle, 2> segmentNodes = geometry.GetSegmentNodes(temp_h_segment);
+				olc::vf2d temp_Start = w2s(geometry.GetNodePosition(segmentNodes[0]));
+				olc::vf2d temp_End = w2s(geometry.GetNodePosition(segmentNodes[1]));
+				DrawCircle(temp_Start, nSelectionSize, color_Selection);
+				DrawCircle(temp_End, nSelectionSize, color_Selection);
+				DrawLine(temp_Start, temp_End, color_Selection);
+
+				// Select the segment
+				if (GetMouse(0).bPressed)
 				{
-					// Show selected segment
-					temp_Start = w2s(nodes[segments[temp_i_segment][0]]);
-					temp_End = w2s(nodes[segments[temp_i_segment][1]]);
-					DrawCircle(temp_Start, nSelectionSize, color_Selection);
-					DrawCircle(temp_End, nSelectionSize, color_Selection);
-					DrawLine(temp_Start, temp_End, color_Selection);
-
-					// Select the segment
-					if (GetMouse(0).bPressed)
-					{
-						i_segment = temp_i_segment;
-						vDifferenceStart = nodes[segments[i_segment][0]] - vMP_W;
-						vDifferenceEnd = nodes[segments[i_segment][1]] - vMP_W;
-					}
+					h_segment = temp_h_segment;
+					vDifferenceStart = geometry.GetNodePosition(segmentNodes[0]) - vMP_W;
+					vDifferenceEnd = geometry.GetNodePosition(segmentNodes[1]) - vMP_W;
 				}
 			}
 		}
 		// Move the segment (with the nodes)
-		if (nMode == 5 && i_segment != -1 && GetMouse(0).bHeld)
+		if (nMode == 5 && geometry.IsValid(h_segment) && GetMouse(0).bHeld)
 		{	
 			// Show selected segment
-			olc::vf2d temp_Start = w2s(nodes[segments[i_segment][0]]);
-			olc::vf2d temp_End = w2s(nodes[segments[i_segment][1]]);
+			std::array<NodeHandle, 2> segmentNodes = geometry.GetSegmentNodes(h_segment);
+			olc::vf2d temp_Start = w2s(geometry.GetNodePosition(segmentNodes[0]));
+			olc::vf2d temp_End = w2s(geometry.GetNodePosition(segmentNodes[1]));
 			DrawCircle(temp_Start, nSelectionSize, color_Selection);
 			DrawCircle(temp_End, nSelectionSize, color_Selection);
 			DrawLine(temp_Start, temp_End, color_Selection);
 
 			// Move the segment (with the nodes)
-			nodes[segments[i_segment][0]] = vMP_W + vDifferenceStart;
-			nodes[segments[i_segment][1]] = vMP_W + vDifferenceEnd;
+			GeometryTransaction transaction(&geometry);
+			transaction.MoveNode(segmentNodes[0], vMP_W + vDifferenceStart);
+			transaction.MoveNode(segmentNodes[1], vMP_W + vDifferenceEnd);
+			PushEdits(transaction.GetEdits(), !GetMouse(0).bPressed);
 		}
 		// De-select the segment
-		if (nMode == 5 && i_segment != -1 && GetMouse(0).bReleased)
+		if (nMode == 5 && geometry.IsValid(h_segment) && GetMouse(0).bReleased)
 		{
-			i_segment = -1;
+			h_segment = SegmentHandle();
 		}
 		SetDrawTarget(nullptr);
 
@@ -635,7 +780,6 @@ public:
 		// Enter the "delete line segment" mode
 		if (nMode == 0 && GetKey(olc::Key::K6).bPressed)
 		{	
-			i_segment = -1;
 			nMode = 6;
 		}
 		// Exit the "delete line segment" mode
@@ -646,62 +790,598 @@ public:
 		// Delete the line segment
 		if (nMode == 6)
 		{
-			olc::vf2d temp_Start, temp_End;
-			float squaredDistance;
 			bool bSegmentExists = false;
 
 			// Snap mouse pointer to the nearest existing line segment
-			if (!segments.empty())
+			SegmentHandle temp_h_segment = geometry.FindNearestSegment(vMP_W, float(nSelectionSize) / fScale);
+			if (geometry.IsValid(temp_h_segment))
+			{
+				std::array<NodeHandle, 2> segmentNodes = geometry.GetSegmentNodes(temp_h_segment);
+				olc::vf2d temp_Start = w2s(geometry.GetNodePosition(segmentNodes[0]));
+				olc::vf2d temp_End   = w2s(geometry.GetNodePosition(segmentNodes[1]));
+				bSegmentExists = true;
+
+				DrawCircle(temp_Start, nSelectionSize, color_Selection);
+				DrawCircle(temp_End, nSelectionSize, color_Selection);
+				DrawLine(temp_Start, temp_End, color_Selection);
+			}
+			// Delete the selected segment
+			if (GetMouse(0).bPressed && bSegmentExists)
+			{
+				GeometryTransaction transaction(&geometry);
+				transaction.DeleteSegment(temp_h_segment);
+				PushEdits(transaction.GetEdits());
+			}
+		}
+		SetDrawTarget(nullptr);
+
+
+		// O------------------------------------------------------------------------------O
+		// | SELECT MULTIPLE NODES                                                        |
+		// O------------------------------------------------------------------------------O
+		SetDrawTarget(nLayerCursor);
+		// Enter the "select nodes" mode
+		if (nMode == 0 && GetKey(olc::Key::K7).bPressed)
+		{
+			selection.clear();
+			bSelecting = false;
+			nMode = 9;
+		}
+		// Exit the "select nodes" mode
+		else if (nMode == 9 && (GetKey(olc::Key::K7).bPressed || GetKey(olc::Key::ESCAPE).bPressed))
+		{
+			selection.clear();
+			nMode = 0;
+		}
+		// Start a box selection, or a lasso selection while SHIFT is held
+		if (nMode == 9 && !bToolbarMode && !GetKey(olc::Key::CTRL).bHeld && GetMouse(0).bPressed)
+		{
+			vSelectionStart = vMP_W;
+			selectionLasso.clear();
+			selectionLasso.push_back(vMP_W);
+			bSelecting = true;
+		}
+		// Draw the box or extend the lasso
+		if (nMode == 9 && bSelecting && GetMouse(0).bHeld)
+		{
+			if (GetKey(olc::Key::SHIFT).bHeld)
 			{
-				i_segment = FindClosestLineSegment(vMP_W, nodes, segments, &squaredDistance);
-				if (squaredDistance * fScale * fScale <= nSelectionSizeSquared)
+				if ((vMP_W - selectionLasso.back()).mag2() * fScale * fScale >= 4.0f) { selectionLasso.push_back(vMP_W); }
+				for (int i = 1; i < selectionLasso.size(); i++)
 				{
-					temp_Start = w2s(nodes[segments[i_segment][0]]);
-					temp_End   = w2s(nodes[segments[i_segment][1]]);
-					bSegmentExists = true;
+					DrawLine(w2s(selectionLasso[i - 1]), w2s(selectionLasso[i]), color_Selection);
+				}
+				DrawLine(w2s(selectionLasso.back()), vMP_S, color_Selection);
+			}
+			else
+			{
+				olc::vf2d vCorner = w2s(vSelectionStart);
+				DrawRect(vCorner.min(vMP_S), vCorner.max(vMP_S) - vCorner.min(vMP_S), color_Selection);
+			}
+		}
+		// Replace the selection with the nodes in the box or the lasso
+		if (nMode == 9 && bSelecting && GetMouse(0).bReleased)
+		{
+			if (GetKey(olc::Key::SHIFT).bHeld && selectionLasso.size() >= 3)
+			{
+				// Range query over the bounds of the lasso, then the exact point in polygon test
+				olc::vf2d vMin = selectionLasso[0];
+				olc::vf2d vMax = selectionLasso[0];
+				for (int i = 1; i < selectionLasso.size(); i++)
+				{
+					vMin = vMin.min(selectionLasso[i]);
+					vMax = vMax.max(selectionLasso[i]);
+				}
+				std::vector<int> lassoPolygon(selectionLasso.size());
+				for (int i = 0; i < lassoPolygon.size(); i++) { lassoPolygon[i] = i; }
 
-					DrawCircle(temp_Start, nSelectionSize, color_Selection);
-					DrawCircle(temp_End, nSelectionSize, color_Selection);
-					DrawLine(temp_Start, temp_End, color_Selection);
+				geometry.FindNodesInBox(vMin, vMax, &selectionCandidates);
+				selection.clear();
+				for (int i = 0; i < selectionCandidates.size(); i++)
+				{
+					if (IsPointInPolygon(geometry.GetNodePosition(selectionCandidates[i]), selectionLasso, lassoPolygon))
+					{
+						selection.push_back(selectionCandidates[i]);
+					}
 				}
 			}
-			// Delete the selected segment
-			if (GetMouse(0).bPressed && bSegmentExists)
+			else
+			{
+				geometry.FindNodesInBox(vSelectionStart.min(vMP_W), vSelectionStart.max(vMP_W), &selection);
+			}
+			bSelecting = false;
+		}
+		// Translate the selection while CTRL is held
+		if (nMode == 9 && !bSelecting && GetKey(olc::Key::CTRL).bHeld && GetMouse(0).bPressed)
+		{
+			vSelectionDrag = vMP_W;
+		}
+		if (nMode == 9 && !bSelecting && GetKey(olc::Key::CTRL).bHeld && GetMouse(0).bHeld)
+		{
+			GeometryTransaction transaction(&geometry);
+			transaction.TranslateNodes(selection, vMP_W - vSelectionDrag);
+			PushEdits(transaction.GetEdits(), !GetMouse(0).bPressed);
+			vSelectionDrag = vMP_W;
+		}
+		// Rotate the selection around its center
+		if (nMode == 9 && !selection.empty() && (GetKey(olc::Key::Q).bHeld || GetKey(olc::Key::E).bHeld))
+		{
+			olc::vf2d vCenter = { 0.0f, 0.0f };
+			int nValid = 0;
+			for (int i = 0; i < selection.size(); i++)
+			{
+				if (geometry.IsValid(selection[i])) { vCenter += geometry.GetNodePosition(selection[i]); nValid += 1; }
+			}
+			if (nValid > 0)
+			{
+				float fAngle = (GetKey(olc::Key::Q).bHeld ? 1.0f : -1.0f) * fSelectionRotationSpeed * fElapsedTime;
+				GeometryTransaction transaction(&geometry);
+				transaction.RotateNodes(selection, fAngle, vCenter / float(nValid));
+				PushEdits(transaction.GetEdits(), !(GetKey(olc::Key::Q).bPressed || GetKey(olc::Key::E).bPressed));
+			}
+		}
+		// Delete the selection, connected segments are deleted with it
+		if (nMode == 9 && GetKey(olc::Key::DEL).bPressed)
+		{
+			GeometryTransaction transaction(&geometry);
+			transaction.DeleteNodes(selection);
+			PushEdits(transaction.GetEdits());
+			selection.clear();
+		}
+		// Turn the selection and the segments between selected nodes into a prefab, placed where the selection was
+		if (nMode == 9 && GetKey(olc::Key::P).bPressed && !selection.empty())
+		{
+			std::unordered_map<int32_t, int> selectedSlots;
+			std::vector<olc::vf2d> prefabNodes;
+			olc::vf2d vCenter = { 0.0f, 0.0f };
+			for (int i = 0; i < selection.size(); i++)
+			{
+				if (!geometry.IsValid(selection[i])) { continue; }
+				selectedSlots[selection[i].nSlot] = int(prefabNodes.size());
+				prefabNodes.push_back(geometry.GetNodePosition(selection[i]));
+				vCenter += prefabNodes.back();
+			}
+			std::vector<std::array<int, 2>> prefabSegments;
+			std::vector<NodeHandle> neighbourNodes;
+			for (int i = 0; i < selection.size(); i++)
+			{
+				if (!geometry.IsValid(selection[i])) { continue; }
+				geometry.GetNeighbourNodes(selection[i], &neighbourNodes);
+				for (int j = 0; j < neighbourNodes.size(); j++)
+				{
+					// Every segment is seen from both ends, keep it once
+					auto it = selectedSlots.find(neighbourNodes[j].nSlot);
+					if (it != selectedSlots.end() && selection[i].nSlot < neighbourNodes[j].nSlot)
+					{
+						prefabSegments.push_back({ selectedSlots[selection[i].nSlot], it->second });
+					}
+				}
+			}
+			if (!prefabNodes.empty())
+			{
+				vCenter /= float(prefabNodes.size());
+				for (int i = 0; i < prefabNodes.size(); i++)
+				{
+					prefabNodes[i] -= vCenter;
+				}
+				nPrefab = prefabs.AddPrefab(prefabNodes, prefabSegments);
+				prefabs.AddInstance(nPrefab, vCenter);
+
+				// Nodes that are still connected to unselected nodes stay with those segments, so the walls around
+				// the selection are kept. Only the segments inside the selection go with the other nodes.
+				GeometryTransaction transaction(&geometry);
+				std::vector<SegmentHandle> connectedSegments;
+				for (int i = 0; i < selection.size(); i++)
+				{
+					if (!geometry.IsValid(selection[i])) { continue; }
+					geometry.GetConnectedSegments(selection[i], &connectedSegments);
+					bool bBoundary = false;
+					for (const SegmentHandle& hSegment : connectedSegments)
+					{
+						std::array<NodeHandle, 2> segmentNodes = geometry.GetSegmentNodes(hSegment);
+						bBoundary = bBoundary || selectedSlots.count(segmentNodes[segmentNodes[0] == selection[i] ? 1 : 0].nSlot) == 0;
+					}
+					if (!bBoundary)
+					{
+						transaction.DeleteNode(selection[i]);
+						continue;
+					}
+					for (const SegmentHandle& hSegment : connectedSegments)
+					{
+						std::array<NodeHandle, 2> segmentNodes = geometry.GetSegmentNodes(hSegment);
+						if (selectedSlots.count(segmentNodes[segmentNodes[0] == selection[i] ? 1 : 0].nSlot) != 0) { transaction.DeleteSegment(hSegment); }
+					}
+				}
+				transaction.Commit();
+
+				// Prefabs are not part of the undo history, so the conversion cannot be undone and the earlier steps
+				// would refer to the converted nodes. The history is cleared as for loading, the journal keeps up.
+				journal.Record(transaction.GetEdits());
+				history.Clear();
+			}
+			selection.clear();
+		}
+		// Highlight the selection
+		if (nMode == 9)
+		{
+			for (int i = 0; i < selection.size(); i++)
+			{
+				if (geometry.IsValid(selection[i])) { DrawCircle(w2s(geometry.GetNodePosition(selection[i])), 4, color_Selection); }
+			}
+		}
+		SetDrawTarget(nullptr);
+
+
+		// O------------------------------------------------------------------------------O
+		// | PLACE PREFABS                                                                |
+		// O------------------------------------------------------------------------------O
+		SetDrawTarget(nLayerCursor);
+		// Enter the "place prefabs" mode
+		if (nMode == 0 && GetKey(olc::Key::K8).bPressed && nPrefab != -1)
+		{
+			fPrefabRotation = 0.0f;
+			nMode = 10;
+		}
+		// Exit the "place prefabs" mode
+		else if (nMode == 10 && (GetKey(olc::Key::K8).bPressed || GetKey(olc::Key::ESCAPE).bPressed))
+		{
+			nMode = 0;
+		}
+		if (nMode == 10)
+		{
+			// Rotate the preview
+			if (GetKey(olc::Key::Q).bHeld) { fPrefabRotation += fPrefabRotationSpeed * fElapsedTime; }
+			if (GetKey(olc::Key::E).bHeld) { fPrefabRotation -= fPrefabRotationSpeed * fElapsedTime; }
+
+			// Pick the closest instance segment, the search runs in prefab space
+			int i_segment = -1;
+			int i_instance = prefabs.FindNearestSegment(vMP_W, float(nSelectionSize) / fScale, &i_segment, nullptr);
+			if (i_instance != -1)
+			{
+				const PrefabInstance& instance = prefabs.GetInstance(i_instance);
+				const Prefab& prefab = prefabs.GetPrefab(instance.nPrefab);
+				DrawLine(w2s(prefabs.ToWorld(instance, prefab.nodes[prefab.segments[i_segment][0]])),
+					w2s(prefabs.ToWorld(instance, prefab.nodes[prefab.segments[i_segment][1]])), color_Selection);
+				DrawCircle(w2s(instance.vPosition), nSelectionSize, color_Selection);
+
+				// Remove the picked instance
+				if (GetKey(olc::Key::DEL).bPressed)
+				{
+					prefabs.RemoveInstance(i_instance);
+				}
+			}
+			// Preview and place a new instance
+			else
 			{
-				segments.erase(segments.begin() + i_segment);
+				const Prefab& prefab = prefabs.GetPrefab(nPrefab);
+				PrefabInstance preview;
+				preview.nPrefab = nPrefab;
+				preview.vPosition = vMP_W;
+				preview.fRotation = fPrefabRotation;
+				for (int i = 0; i < prefab.segments.size(); i++)
+				{
+					DrawLine(w2s(prefabs.ToWorld(preview, prefab.nodes[prefab.segments[i][0]])), w2s(prefabs.ToWorld(preview, prefab.nodes[prefab.segments[i][1]])), color_TempLine);
+				}
+				if (GetMouse(0).bPressed)
+				{
+					prefabs.AddInstance(nPrefab, vMP_W, fPrefabRotation);
+				}
 			}
 		}
 		SetDrawTarget(nullptr);
 
 
+		// O------------------------------------------------------------------------------O
+		// | ADD PRIMITIVES                                                               |
+		// O------------------------------------------------------------------------------O
+		SetDrawTarget(nLayerCursor);
+		// Enter the "add primitives" mode
+		if (nMode == 0 && GetKey(olc::Key::K9).bPressed)
+		{
+			primitivePoints.clear();
+			nMode = 11;
+		}
+		// Exit the "add primitives" mode
+		else if (nMode == 11 && (GetKey(olc::Key::K9).bPressed || GetKey(olc::Key::ESCAPE).bPressed))
+		{
+			nMode = 0;
+		}
+		if (nMode == 11)
+		{
+			// Pick the closest primitive outline
+			int i_primitive = FindClosestPrimitive(vMP_W, primitives, float(nSelectionSize) / fScale, nullptr);
+			if (i_primitive != -1)
+			{
+				DrawRect(w2s({ primitives[i_primitive].vMin.x, primitives[i_primitive].vMax.y }),
+					(primitives[i_primitive].vMax - primitives[i_primitive].vMin) * fScale, color_Selection);
+				if (GetKey(olc::Key::DEL).bPressed)
+				{
+					primitives.erase(primitives.begin() + i_primitive);
+				}
+			}
+
+			// Collect the points of a convex polygon with CTRL and make it with ENTER
+			if (GetKey(olc::Key::CTRL).bHeld)
+			{
+				if (GetMouse(0).bPressed) { primitivePoints.push_back(vMP_W); }
+				for (int i = 0; i < primitivePoints.size(); i++)
+				{
+					FillCircle(w2s(primitivePoints[i]), 2, color_TempNode);
+				}
+			}
+			if (GetKey(olc::Key::ENTER).bPressed && primitivePoints.size() >= 3)
+			{
+				Primitive polygon = MakeConvexPolygon(primitivePoints);
+				if (polygon.vertices.size() >= 3) { primitives.push_back(polygon); }
+				primitivePoints.clear();
+			}
+
+			// Drag a rectangle, or a circle with SHIFT
+			if (!GetKey(olc::Key::CTRL).bHeld)
+			{
+				if (GetMouse(0).bPressed) { vPrimitiveStart = vMP_W; }
+				if (GetMouse(0).bHeld || GetMouse(0).bReleased)
+				{
+					Primitive primitive;
+					if (GetKey(olc::Key::SHIFT).bHeld)
+					{
+						primitive = MakeCircle(vPrimitiveStart, EuclideanDistance(vPrimitiveStart, vMP_W));
+						DrawCircle(w2s(primitive.vCenter), int(primitive.fRadius * fScale), color_TempLine);
+					}
+					else
+					{
+						olc::vf2d vMin = vPrimitiveStart.min(vMP_W);
+						olc::vf2d vMax = vPrimitiveStart.max(vMP_W);
+						primitive = MakeRectangle(0.5f * (vMin + vMax), 0.5f * (vMax - vMin));
+						DrawRect(w2s({ vMin.x, vMax.y }), (vMax - vMin) * fScale, color_TempLine);
+					}
+					if (GetMouse(0).bReleased && (primitive.vMax - primitive.vMin).mag2() > 0.0f)
+					{
+						primitives.push_back(primitive);
+					}
+				}
+			}
+		}
+		SetDrawTarget(nullptr);
+
+
+		// O------------------------------------------------------------------------------O
+		// | UNDO AND REDO                                                                |
+		// O------------------------------------------------------------------------------O
+		// Not while a drag is in progress
+		if (GetKey(olc::Key::CTRL).bHeld && !GetMouse(0).bHeld && GetKey(olc::Key::Z).bPressed)
+		{
+			if (history.Undo(&geometry, &historyEdits)) { journal.Record(historyEdits); }
+		}
+		if (GetKey(olc::Key::CTRL).bHeld && !GetMouse(0).bHeld && GetKey(olc::Key::Y).bPressed)
+		{
+			if (history.Redo(&geometry, &historyEdits)) { journal.Record(historyEdits); }
+		}
+
+
 		// O------------------------------------------------------------------------------O
 		// | CLEAR GEOMETRY                                                               |
 		// O------------------------------------------------------------------------------O
 		if (GetKey(olc::Key::C).bHeld)
 		{
-			nodes.clear();
-			segments.clear();
+			geometry.Clear();
+			history.Clear();
+			if (GetKey(olc::Key::C).bPressed) { journal.Snapshot(&geometry); }
+			prefabs.Clear();
+			nPrefab = -1;
+			primitives.clear();
+			primitivePoints.clear();
+			h_segment = SegmentHandle();
+			h_node = NodeHandle();
+			h_node_start = NodeHandle();
+			selection.clear();
 		}		
 
 
+		// O------------------------------------------------------------------------------O
+		// | SAVE AND LOAD GEOMETRY                                                       |
+		// O------------------------------------------------------------------------------O
+		bool bCompressedScene = GetKey(olc::Key::SHIFT).bHeld;
+		if (nMode == 0 && GetKey(olc::Key::F5).bPressed)
+		{
+			if (bCompressedScene) { SaveCompressedScene(sCompressedScenePath, geometry.GetNodes(), geometry.GetSegments(), fSceneQuantum); }
+			else                  { SaveScene(sScenePath, geometry.GetNodes(), geometry.GetSegments()); }
+		}
+		if (nMode == 0 && GetKey(olc::Key::F9).bPressed)
+		{
+			// The file is mapped only while the geometry is copied into the store
+			SceneFile file;
+			std::vector<olc::vf2d> nodes_loaded;
+			std::vector<std::array<int, 2>> segments_loaded;
+			bool bLoaded = bCompressedScene ? LoadCompressedScene(sCompressedScenePath, &nodes_loaded, &segments_loaded) :
+				file.Open(sScenePath) && LoadScene(file, &nodes_loaded, &segments_loaded);
+			if (bLoaded)
+			{
+				geometry.Assign(nodes_loaded, segments_loaded);
+
+				// The grid of the file finds the self-intersections of the loaded geometry, which saves the test of
+				// all pairs of segments that the unbounded dirty region of the new geometry would cause
+				if (file.IsOpen() && file.HasGrid())
+				{
+					std::vector<uint32_t> candidates;
+					intersections.clear();
+					for (int i = 0; i < segments_loaded.size(); i++)
+					{
+						const olc::vf2d& vStart = nodes_loaded[segments_loaded[i][0]];
+						const olc::vf2d& vEnd = nodes_loaded[segments_loaded[i][1]];
+						file.FindSegmentsInBox(vStart.min(vEnd), vStart.max(vEnd), &candidates);
+						for (uint32_t j : candidates)
+						{
+							olc::vf2d vIntersectionPoint;
+							if (j > uint32_t(i) && SegmentToSegmentIntersection(vStart, vEnd, nodes_loaded[segments_loaded[j][0]], nodes_loaded[segments_loaded[j][1]], &vIntersectionPoint))
+							{
+								intersections.push_back(vIntersectionPoint);
+							}
+						}
+					}
+					geometry.ResetDirtyRegion();
+				}
+				history.Clear();
+				journal.Snapshot(&geometry);
+				h_segment = SegmentHandle();
+				h_node = NodeHandle();
+				h_node_start = NodeHandle();
+				selection.clear();
+			}
+		}
+
+		// Only the differences to the reloaded scene are applied, so they can be undone and the derived data is
+		// updated in the changed region only. Not while a drag is in progress, the events wait until it ends.
+		if (!GetMouse(0).bHeld && sceneWatcher.Poll())
+		{
+			SceneFile file;
+			std::vector<olc::vf2d> nodes_loaded;
+			std::vector<std::array<int, 2>> segments_loaded;
+			if (file.Open(sScenePath) && LoadScene(file, &nodes_loaded, &segments_loaded))
+			{
+				GeometryTransaction transaction(&geometry);
+				ApplySceneDiff(nodes_loaded, segments_loaded, &geometry, &transaction);
+				transaction.Commit();
+				PushEdits(transaction.GetEdits());
+			}
+		}
+
+
+		// The imported floorplan is added to the current geometry and can be undone in one step
+		if (nMode == 0 && GetKey(olc::Key::F6).bPressed)
+		{
+			GeometryTransaction transaction(&geometry);
+			bool bImported = GetKey(olc::Key::SHIFT).bHeld ? ImportRaster(sRasterPath, &transaction) : ImportSvg(sSvgPath, &transaction);
+			if (bImported)
+			{
+				transaction.Commit();
+				PushEdits(transaction.GetEdits());
+			}
+		}
+
+		// Same for a map, it is placed around the origin of the world
+		if (nMode == 0 && GetKey(olc::Key::F7).bPressed)
+		{
+			GeometryTransaction transaction(&geometry);
+			if (ImportGeo(sGeoPath, &transaction))
+			{
+				transaction.Commit();
+				PushEdits(transaction.GetEdits());
+			}
+		}
+
+
+		// O------------------------------------------------------------------------------O
+		// | STREAM WORLD                                                                 |
+		// O------------------------------------------------------------------------------O
+		// Toggle streaming, the current geometry is written as the world if there is none yet
+		if (nMode == 0 && GetKey(olc::Key::F8).bPressed)
+		{
+			if (world.IsOpen())
+			{
+				world.Close();
+				worldNodes.clear();
+				worldSegments.clear();
+			}
+			else if (world.Open(sWorldPath) || (SaveTiledWorld(sWorldPath, nodes, segments, fWorldChunkSize) && world.Open(sWorldPath)))
+			{
+				world.SetMemoryBudget(nWorldMemoryBudget);
+			}
+		}
+		if (world.IsOpen())
+		{
+			// Chunks up to half a screen away are loaded ahead of panning
+			world.RequestRegion(vBL_W, vTR_W, 0.5f * std::max(vTR_W.x - vBL_W.x, vTR_W.y - vBL_W.y));
+			world.Update();
+			world.GatherRegion(vBL_W, vTR_W, &worldNodes, &worldSegments);
+
+			SetDrawTarget(nLayerGeometry);
+			for (int i = 0; i < worldSegments.size(); i++)
+			{
+				DrawLine(w2s(worldNodes[worldSegments[i][0]]), w2s(worldNodes[worldSegments[i][1]]), color_World);
+			}
+			// Closest loaded node under the cursor, it can lie in any chunk
+			olc::vf2d vWorldNode;
+			if (world.FindNearestNode(vMP_W, 10.0f / fScale, &vWorldNode) != -1)
+			{
+				DrawCircle(w2s(vWorldNode), 4, color_Selection);
+			}
+			SetDrawTarget(nullptr);
+		}
+
+
+		// O------------------------------------------------------------------------------O
+		// | COMPACT GEOMETRY                                                             |
+		// O------------------------------------------------------------------------------O
+		// No handles are held outside of the editing modes, the undo history is remapped
+		if (nMode == 0 && geometry.GetFragmentation() > fMaxFragmentation)
+		{
+			std::vector<NodeHandle> nodeRemap;
+			std::vector<SegmentHandle> segmentRemap;
+			geometry.Compact(&nodeRemap, &segmentRemap);
+			history.Remap(nodeRemap, segmentRemap);
+		}
+
+		// The journal identifies nodes and segments by generation, which compacting keeps. It is replaced by a
+		// snapshot once it is larger than one.
+		if (journal.IsSnapshotDue())
+		{
+			journal.Snapshot(&geometry);
+		}
+
+
 		// O------------------------------------------------------------------------------O
 		// | CHECK FOR SELF-INTERSECTIONS                                                 |
 		// O------------------------------------------------------------------------------O
-		std::vector<olc::vf2d> intersections;
-		intersections.reserve(16);
-		// Find all line segment intersections
-		for (int i = 0; i < segments.size(); i++)
-		{	
-			for (int j = 0; j < segments.size(); j++)
-			{	
-				// Check for intersection
-				olc::vf2d vIntersectionPoint;
-				if (SegmentToSegmentIntersection(nodes[segments[i][0]], nodes[segments[i][1]],
-					                             nodes[segments[j][0]], nodes[segments[j][1]], &vIntersectionPoint))
+		// Refresh the packed views after the edits of this frame
+		geometry.GetSegments();
+
+		// Only intersections inside the dirty region can have changed, changed segments lie inside it entirely.
+		// Both segments of such an intersection touch the region, so it is enough to test the segments that
+		// touch it against all segments and to keep the hits that fall inside the region.
+		olc::vf2d vDirtyMin, vDirtyMax;
+		if (geometry.GetDirtyRegion(&vDirtyMin, &vDirtyMax))
+		{
+			// Segments get twice the rounding margin of the points, so they always cover the points they produce
+			olc::vf2d vMargin = 1e-4f * (olc::vf2d{ 1.0f, 1.0f } + vDirtyMax.max(-vDirtyMin));
+			auto isInDirtyRegion = [&](const olc::vf2d& vMin, const olc::vf2d& vMax, const float& fMargins)
+			{
+				return vMax.x >= vDirtyMin.x - fMargins * vMargin.x && vMax.y >= vDirtyMin.y - fMargins * vMargin.y &&
+					vMin.x <= vDirtyMax.x + fMargins * vMargin.x && vMin.y <= vDirtyMax.y + fMargins * vMargin.y;
+			};
+
+			// Remove the old intersections inside the region
+			int nKept = 0;
+			for (int i = 0; i < intersections.size(); i++)
+			{
+				if (!isInDirtyRegion(intersections[i], intersections[i], 1.0f)) { intersections[nKept++] = intersections[i]; }
+			}
+			intersections.resize(nKept);
+
+			// Find the intersections of the segments that touch the region, each pair once
+			std::vector<uint8_t> dirtySegments(segments.size(), 0);
+			for (int i = 0; i < segments.size(); i++)
+			{
+				const olc::vf2d& vStart = nodes[segments[i][0]];
+				const olc::vf2d& vEnd = nodes[segments[i][1]];
+				dirtySegments[i] = isInDirtyRegion(vStart.min(vEnd), vStart.max(vEnd), 2.0f);
+			}
+			for (int i = 0; i < segments.size(); i++)
+			{
+				if (!dirtySegments[i]) { continue; }
+				for (int j = 0; j < segments.size(); j++)
 				{
-					intersections.push_back(vIntersectionPoint);
+					if (dirtySegments[j] && j <= i) { continue; }
+					olc::vf2d vIntersectionPoint;
+					if (SegmentToSegmentIntersection(nodes[segments[i][0]], nodes[segments[i][1]],
+						                             nodes[segments[j][0]], nodes[segments[j][1]], &vIntersectionPoint) &&
+						isInDirtyRegion(vIntersectionPoint, vIntersectionPoint, 1.0f))
+					{
+						intersections.push_back(vIntersectionPoint);
+					}
 				}
 			}
+			geometry.ResetDirtyRegion();
 		}
 		// Draw all intersections
 		if (GetKey(olc::Key::I).bPressed)
@@ -715,6 +1395,16 @@ public:
 			{
 				FillCircle(w2s(intersections[i]), 2, color_Intersection);
 			}
+			// Obstacles that the self-intersections kept from being decomposed, the ball falls through them
+			UpdateObstacles();
+			for (int i_obstacle : failedObstacles)
+			{
+				const Obstacle& obstacle = obstacles[i_obstacle];
+				for (int j = 0; j < obstacle.nodes.size(); j++)
+				{
+					DrawLine(w2s(nodes[obstacle.nodes[j]]), w2s(nodes[obstacle.nodes[(j + 1) % obstacle.nodes.size()]]), color_Intersection);
+				}
+			}
 			SetDrawTarget(nullptr);
 		}
 		
@@ -737,20 +1427,57 @@ public:
 		{	
 			SetDrawTarget(nLayerVisibilityPolygon);
 
-			// Compute The visibility polygon
-			std::vector<olc::vf2d> visibilityPolygon = VisibilityPolygon(vMP_W, vTL_W, vTR_W, vBR_W, vBL_W, nodes, segments, intersections);
-
-			// Compute screen coordinates of the nodes
-			for (int i = 0; i < visibilityPolygon.size(); i++)
+			// Nothing is visible from inside a solid obstacle
+			UpdateObstacles();
+			bool bInsidePrimitive = false;
+			for (int i = 0; i < primitives.size() && !bInsidePrimitive; i++)
 			{
-				visibilityPolygon[i] = w2s(visibilityPolygon[i]);
+				bInsidePrimitive = IsPointInPrimitive(vMP_W, primitives[i]);
 			}
-			// Draw visibility polygon
-			for (int i = 0; i < visibilityPolygon.size()-1; i++)
+			if (!IsPointInsideSolid(vMP_W, nodes, obstacles) && !bInsidePrimitive)
 			{
-				FillTriangle(vMP_S, visibilityPolygon[i], visibilityPolygon[i + 1], color_VisibilityPolygon);
+				// Back-facing obstacle segments are always hidden behind front-facing ones
+				std::vector<bool> backFacing = FindBackFacingSegments(vMP_W, nodes, segments, obstacles);
+				std::vector<std::array<int, 2>> segments_visible;
+				segments_visible.reserve(segments.size());
+				for (int i = 0; i < segments.size(); i++)
+				{
+					if (!backFacing[i]) { segments_visible.push_back(segments[i]); }
+				}
+
+				// The loaded world chunks block the view too
+				const std::vector<olc::vf2d>* nodes_visible = &nodes;
+				std::vector<olc::vf2d> nodes_combined;
+				if (!worldSegments.empty())
+				{
+					nodes_combined.reserve(nodes.size() + worldNodes.size());
+					nodes_combined.insert(nodes_combined.end(), nodes.begin(), nodes.end());
+					nodes_combined.insert(nodes_combined.end(), worldNodes.begin(), worldNodes.end());
+					for (int i = 0; i < worldSegments.size(); i++)
+					{
+						segments_visible.push_back({ worldSegments[i][0] + int(nodes.size()), worldSegments[i][1] + int(nodes.size()) });
+					}
+					nodes_visible = &nodes_combined;
+				}
+
+				// Compute The visibility polygon
+				std::vector<olc::vf2d> visibilityPolygon = VisibilityPolygon(vMP_W, vTL_W, vTR_W, vBR_W, vBL_W, *nodes_visible, segments_visible, intersections, &prefabs, &primitives);
+
+				// Compute screen coordinates of the nodes
+				for (int i = 0; i < visibilityPolygon.size(); i++)
+				{
+					visibilityPolygon[i] = w2s(visibilityPolygon[i]);
+				}
+				// Draw visibility polygon
+				for (int i = 0; i + 1 < visibilityPolygon.size(); i++)
+				{
+					FillTriangle(vMP_S, visibilityPolygon[i], visibilityPolygon[i + 1], color_VisibilityPolygon);
+				}
+				if (!visibilityPolygon.empty())
+				{
+					FillTriangle(vMP_S, visibilityPolygon.back(), visibilityPolygon.front(), color_VisibilityPolygon);
+				}
 			}
-			FillTriangle(vMP_S, visibilityPolygon.back(), visibilityPolygon.front(), color_VisibilityPolygon);
 			FillCircle(vMP_S, 3, olc::RED);
 			
 			SetDrawTarget(nullptr);
@@ -778,7 +1505,12 @@ public:
 			FillCircle(vMP_S, 3, olc::RED);
 
 
-			vBallPosition = vMP_W;
+			// Do not spawn the ball inside a solid obstacle
+			UpdateObstacles();
+			if (!IsPointInsideSolid(vMP_W, nodes, obstacles))
+			{
+				vBallPosition = vMP_W;
+			}
 
 			SetDrawTarget(nullptr);
 		}
@@ -789,7 +1521,18 @@ public:
 			// Draw the ball
 			FillCircle(w2s(vBallPosition), int(fBallRadius), olc::WHITE);
 
-			vBallPosition.y -= 1;
+			// Let the ball fall until it hits a solid obstacle
+			UpdateObstacles();
+			olc::vf2d vBallPositionNext = vBallPosition - olc::vf2d{ 0.0f, 1.0f };
+			bool bBallCollides = false;
+			for (int i = 0; i < pieces.size() && !bBallCollides; i++)
+			{
+				bBallCollides = DoesCircleOverlapConvexPiece(vBallPositionNext, fBallRadius / fScale, nodes, pieces[i]);
+			}
+			if (!bBallCollides)
+			{
+				vBallPosition = vBallPositionNext;
+			}
 
 			SetDrawTarget(nullptr);
 
@@ -827,59 +1570,80 @@ public:
 		DrawLine(olc::vi2d{ 0, 35 }, olc::vi2d{ mainToolbarWidth - 1, 35 }, olc::WHITE);
 
 		// Number of shapes, nodes, segments
-		std::string sNumNodes = "# NODES    = " + std::to_string(nodes.size());
-		std::string sNumLines = "# SEGMENTS = " + std::to_string(segments.size());
+		std::string sNumNodes = "# NODES    = " + std::to_string(geometry.GetNodeCount());
+		std::string sNumLines = "# SEGMENTS = " + std::to_string(geometry.GetSegmentCount());
+		std::string sNumInstances = "# PREFABS  = " + std::to_string(prefabs.GetInstanceCount());
 		DrawString(olc::vi2d{ 5, 40 }, sNumNodes, olc::WHITE);
 		DrawString(olc::vi2d{ 5, 50 }, sNumLines, olc::WHITE);
+		std::string sNumPrimitives = "# SHAPES   = " + std::to_string(primitives.size());
+		DrawString(olc::vi2d{ 5, 60 }, sNumInstances, olc::WHITE);
+		DrawString(olc::vi2d{ 5, 70 }, sNumPrimitives, olc::WHITE);
 
 		// Divider line
-		DrawLine(olc::vi2d{ 0, 60 }, olc::vi2d{ mainToolbarWidth - 1, 60 }, olc::WHITE);
+		DrawLine(olc::vi2d{ 0, 80 }, olc::vi2d{ mainToolbarWidth - 1, 80 }, olc::WHITE);
 
 		// Display selection info
-		DrawString(olc::vi2d{ 5, 65  }, "[ESC] CLEAR SELECTION ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 75  }, "[1]   NODE - ADD      ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 85  }, "[2]   NODE - MOVE     ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 95  }, "[3]   NODE - DELETE   ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 105 }, "[4]   LINE - ADD      ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 115 }, "[5]   LINE - MOVE     ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 125 }, "[6]   LINE - DELETE   ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 85  }, "[ESC] CLEAR SELECTION ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 95  }, "[1]   NODE - ADD      ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 105 }, "[2]   NODE - MOVE     ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 115 }, "[3]   NODE - DELETE   ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 125 }, "[4]   LINE - ADD      ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 135 }, "[5]   LINE - MOVE     ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 145 }, "[6]   LINE - DELETE   ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 155 }, "[7]   NODES - SELECT  ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 165 }, "[8]   PREFAB - PLACE  ", nPrefab != -1 ? olc::WHITE : olc::GREY);
+		DrawString(olc::vi2d{ 5, 175 }, "[9]   SHAPE - ADD     ", olc::WHITE);
 		
 		// Highlight the selected mode
-		if      (nMode == 0) { DrawString(olc::vi2d{ 5, 65  }, "[ESC] CLEAR SELECTION ", olc::RED); }
-		else if (nMode == 1) { DrawString(olc::vi2d{ 5, 75  }, "[1]   NODE - ADD      ", olc::RED); }
-		else if (nMode == 2) { DrawString(olc::vi2d{ 5, 85  }, "[2]   NODE - MOVE     ", olc::RED); }
-		else if (nMode == 3) { DrawString(olc::vi2d{ 5, 95  }, "[3]   NODE - DELETE   ", olc::RED); }
-		else if (nMode == 4) { DrawString(olc::vi2d{ 5, 105 }, "[4]   LINE - ADD      ", olc::RED); }
-		else if (nMode == 5) { DrawString(olc::vi2d{ 5, 115 }, "[5]   LINE - MOVE     ", olc::RED); }
-		else if (nMode == 6) { DrawString(olc::vi2d{ 5, 125 }, "[6]   LINE - DELETE   ", olc::RED); }
+		if      (nMode == 0) { DrawString(olc::vi2d{ 5, 85  }, "[ESC] CLEAR SELECTION ", olc::RED); }
+		else if (nMode == 1) { DrawString(olc::vi2d{ 5, 95  }, "[1]   NODE - ADD      ", olc::RED); }
+		else if (nMode == 2) { DrawString(olc::vi2d{ 5, 105 }, "[2]   NODE - MOVE     ", olc::RED); }
+		else if (nMode == 3) { DrawString(olc::vi2d{ 5, 115 }, "[3]   NODE - DELETE   ", olc::RED); }
+		else if (nMode == 4) { DrawString(olc::vi2d{ 5, 125 }, "[4]   LINE - ADD      ", olc::RED); }
+		else if (nMode == 5) { DrawString(olc::vi2d{ 5, 135 }, "[5]   LINE - MOVE     ", olc::RED); }
+		else if (nMode == 6) { DrawString(olc::vi2d{ 5, 145 }, "[6]   LINE - DELETE   ", olc::RED); }
+		else if (nMode == 9) { DrawString(olc::vi2d{ 5, 155 }, "[7]   NODES - SELECT  ", olc::RED); }
+		else if (nMode == 10) { DrawString(olc::vi2d{ 5, 165 }, "[8]   PREFAB - PLACE  ", olc::RED); }
+		else if (nMode == 11) { DrawString(olc::vi2d{ 5, 175 }, "[9]   SHAPE - ADD     ", olc::RED); }
 
 		// Divider line
-		DrawLine(olc::vi2d{ 0, 135 }, olc::vi2d{ mainToolbarWidth - 1, 135 }, olc::WHITE);
+		DrawLine(olc::vi2d{ 0, 185 }, olc::vi2d{ mainToolbarWidth - 1, 185 }, olc::WHITE);
 
 		// Display addition options
-		DrawString(olc::vi2d{ 5, 140 }, "[R] RESET PAN & ZOOM  ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 150 }, "[A] SHOW AXIS         ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 160 }, "[N] SHOW NODE INFO    ", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 170 }, "[I] SHOW INTERSECTIONS", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 180 }, "[C] CLEAR GEOMETRY    ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 190 }, "[R] RESET PAN & ZOOM  ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 200 }, "[A] SHOW AXIS         ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 210 }, "[N] SHOW NODE INFO    ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 220 }, "[I] SHOW INTERSECTIONS", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 230 }, "[C] CLEAR GEOMETRY    ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 240 }, "[S] SIMPLIFY DISPLAY  ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 250 }, "[^Z] UNDO  [^Y] REDO  ", history.CanUndo() || history.CanRedo() ? olc::WHITE : olc::GREY);
+		DrawString(olc::vi2d{ 5, 260 }, "[F5] SAVE  [F9] LOAD  ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 270 }, "[F6] IMPORT SVG       ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 280 }, "[F7] IMPORT GEOJSON   ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 290 }, "[F8] STREAM WORLD     ", olc::WHITE);
 
 		// Highlight the selected mode
-		if (GetKey(olc::Key::R).bHeld) { DrawString(olc::vi2d{ 5, 140 }, "[R] RESET PAN & ZOOM  ", olc::GREEN); }
-		if (bDisplayCoordinateSystem)  { DrawString(olc::vi2d{ 5, 150 }, "[A] SHOW AXIS         ", olc::GREEN); }
-		if (bDisplayLineSegmentInfo)   { DrawString(olc::vi2d{ 5, 160 }, "[N] SHOW NODE INFO    ", olc::GREEN); }
-		if (bDisplaySelfIntersections) { DrawString(olc::vi2d{ 5, 170 }, "[I] SHOW INTERSECTIONS", olc::GREEN); }
-		if (GetKey(olc::Key::C).bHeld) { DrawString(olc::vi2d{ 5, 180 }, "[C] CLEAR GEOMETRY    ", olc::GREEN); }
+		if (GetKey(olc::Key::R).bHeld) { DrawString(olc::vi2d{ 5, 190 }, "[R] RESET PAN & ZOOM  ", olc::GREEN); }
+		if (bDisplayCoordinateSystem)  { DrawString(olc::vi2d{ 5, 200 }, "[A] SHOW AXIS         ", olc::GREEN); }
+		if (bDisplayLineSegmentInfo)   { DrawString(olc::vi2d{ 5, 210 }, "[N] SHOW NODE INFO    ", olc::GREEN); }
+		if (bDisplaySelfIntersections) { DrawString(olc::vi2d{ 5, 220 }, "[I] SHOW INTERSECTIONS", olc::GREEN); }
+		if (GetKey(olc::Key::C).bHeld) { DrawString(olc::vi2d{ 5, 230 }, "[C] CLEAR GEOMETRY    ", olc::GREEN); }
+		if (bDisplayLevelOfDetail)     { DrawString(olc::vi2d{ 5, 240 }, "[S] SIMPLIFY DISPLAY  ", olc::GREEN); }
+		if (GetKey(olc::Key::F5).bHeld || GetKey(olc::Key::F9).bHeld) { DrawString(olc::vi2d{ 5, 260 }, "[F5] SAVE  [F9] LOAD  ", olc::GREEN); }
+		if (GetKey(olc::Key::F6).bHeld) { DrawString(olc::vi2d{ 5, 270 }, "[F6] IMPORT SVG       ", olc::GREEN); }
+		if (GetKey(olc::Key::F7).bHeld) { DrawString(olc::vi2d{ 5, 280 }, "[F7] IMPORT GEOJSON   ", olc::GREEN); }
+		if (world.IsOpen())             { DrawString(olc::vi2d{ 5, 290 }, "[F8] STREAM WORLD     ", olc::GREEN); }
 
 		// Divider line
-		DrawLine(olc::vi2d{ 0, 190 }, olc::vi2d{ mainToolbarWidth - 1, 190 }, olc::WHITE);
+		DrawLine(olc::vi2d{ 0, 300 }, olc::vi2d{ mainToolbarWidth - 1, 300 }, olc::WHITE);
 
 		// Display selection info
-		DrawString(olc::vi2d{ 5, 195 }, "[V] VISIBILITY POLYGON", olc::WHITE);
-		DrawString(olc::vi2d{ 5, 205 }, "[B] BOUNCING BALL     ", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 305 }, "[V] VISIBILITY POLYGON", olc::WHITE);
+		DrawString(olc::vi2d{ 5, 315 }, "[B] BOUNCING BALL     ", olc::WHITE);
 
 		// Highlight selected mode
-		if (nMode == 7) { DrawString(olc::vi2d{ 5, 195 }, "[V] VISIBILITY POLYGON", olc::RED); }
-		if (nMode == 8) { DrawString(olc::vi2d{ 5, 205 }, "[B] BOUNCING BALL     ", olc::RED); }
+		if (nMode == 7) { DrawString(olc::vi2d{ 5, 305 }, "[V] VISIBILITY POLYGON", olc::RED); }
+		if (nMode == 8) { DrawString(olc::vi2d{ 5, 315 }, "[B] BOUNCING BALL     ", olc::RED); }
 
 
 		// Default draw target
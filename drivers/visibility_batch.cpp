@@ -0,0 +1,275 @@
+// Headless batch visibility
+//
+// Computes the visibility polygons of many observers in a scene file without opening a window:
+//   visibility_batch <scene.sc2d> <observers> <output> [--csv | --binary] [--radius R] [--threads N]
+//
+// Observers are float32 x, y pairs, or "x,y" lines with "--csv" or a ".csv" file. "-" reads them from the
+// standard input. With "--radius" every observer sees a square of that half size, which only needs the
+// segments in the grid cells of the scene that overlap it. Without it every observer sees the bounding box of
+// the scene and of all observers.
+//
+// Output format, little-endian:
+//   header              char[8] "SC2DVIS" followed by a zero, uint32_t version, uint32_t reserved,
+//                       uint64_t nObservers, uint64_t nOffsetTable
+//   vertices            float x, y of all polygons one after the other
+//   offsets             uint64_t[nObservers + 1] at "nOffsetTable", polygon "i" is vertices offsets[i] to
+//                       offsets[i + 1]. Observers inside a solid obstacle have an empty polygon.
+//
+#define OLC_PGE_HEADLESS
+#define OLC_PGE_APPLICATION
+
+#include "custom_functions.h"
+#include "visibility_polygon.h"
+#include "obstacles.h"
+#include "scene_file.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+
+// Observers that are computed before their polygons are written
+const int nObserverBatch = 1 << 14;
+
+
+// Settings from the command line
+struct BatchOptions
+{
+	std::string sScenePath;
+	std::string sObserverPath;
+	std::string sOutputPath;
+	int nFormat = 0; // 0 from the file extension, 1 binary, 2 CSV
+	float fRadius = 0.0f;
+	int nThreads = 0;
+};
+
+
+// Read the command line, returns "false" if it is incomplete
+bool ParseArguments(int argc, char** argv, BatchOptions* options)
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string sArgument = argv[i];
+		if      (sArgument == "--csv")                     { options->nFormat = 2; }
+		else if (sArgument == "--binary")                  { options->nFormat = 1; }
+		else if (sArgument == "--radius" && i + 1 < argc)  { options->fRadius = std::stof(argv[++i]); }
+		else if (sArgument == "--threads" && i + 1 < argc) { options->nThreads = std::stoi(argv[++i]); }
+		else                                               { paths.push_back(sArgument); }
+	}
+	if (paths.size() != 3) { return false; }
+	options->sScenePath = paths[0];
+	options->sObserverPath = paths[1];
+	options->sOutputPath = paths[2];
+	if (options->nFormat == 0)
+	{
+		bool bCsv = options->sObserverPath.size() > 4 && options->sObserverPath.compare(options->sObserverPath.size() - 4, 4, ".csv") == 0;
+		options->nFormat = bCsv ? 2 : 1;
+	}
+	return true;
+}
+
+// Read all observers, CSV lines that do not start with two numbers (e.g. a header) are skipped
+bool ReadObservers(std::istream& input, const bool& bCsv, std::vector<olc::vf2d>* observers)
+{
+	if (!bCsv)
+	{
+		float fPoint[2];
+		while (input.read(reinterpret_cast<char*>(fPoint), sizeof(fPoint)))
+		{
+			observers->push_back({ fPoint[0], fPoint[1] });
+		}
+		return input.gcount() == 0;
+	}
+	std::string sLine;
+	while (std::getline(input, sLine))
+	{
+		for (char& c : sLine)
+		{
+			if (c == ',' || c == ';' || c == '\t') { c = ' '; }
+		}
+		std::istringstream line(sLine);
+		olc::vf2d vPoint;
+		if (line >> vPoint.x >> vPoint.y) { observers->push_back(vPoint); }
+	}
+	return true;
+}
+
+// Find the self-intersections of the scene, each pair of segments is tested once
+std::vector<olc::vf2d> FindIntersections(const SceneFile& scene, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments)
+{
+	std::vector<olc::vf2d> intersections;
+	std::vector<uint32_t> candidates;
+	for (int i = 0; i < segments.size(); i++)
+	{
+		const olc::vf2d& vStart = nodes[segments[i][0]];
+		const olc::vf2d& vEnd = nodes[segments[i][1]];
+		if (!scene.FindSegmentsInBox(vStart.min(vEnd), vStart.max(vEnd), &candidates))
+		{
+			candidates.resize(segments.size());
+			for (int j = 0; j < segments.size(); j++) { candidates[j] = uint32_t(j); }
+		}
+		for (uint32_t j : candidates)
+		{
+			if (j <= uint32_t(i)) { continue; }
+			// Segments that share a node meet at the node, which casts rays anyway
+			if (segments[j][0] == segments[i][0] || segments[j][0] == segments[i][1] || segments[j][1] == segments[i][0] || segments[j][1] == segments[i][1]) { continue; }
+			olc::vf2d vIntersectionPoint;
+			if (SegmentToSegmentIntersection(vStart, vEnd, nodes[segments[j][0]], nodes[segments[j][1]], &vIntersectionPoint))
+			{
+				intersections.push_back(vIntersectionPoint);
+			}
+		}
+	}
+	return intersections;
+}
+
+
+int main(int argc, char** argv)
+{
+	BatchOptions options;
+	if (!ParseArguments(argc, argv, &options))
+	{
+		std::cerr << "usage: visibility_batch <scene.sc2d> <observers> <output> [--csv | --binary] [--radius R] [--threads N]" << std::endl;
+		return 1;
+	}
+
+	// Load the scene, its grid is only used for the local queries
+	SceneFile scene;
+	std::vector<olc::vf2d> nodes;
+	std::vector<std::array<int, 2>> segments;
+	if (!scene.Open(options.sScenePath) || !LoadScene(scene, &nodes, &segments))
+	{
+		std::cerr << "cannot read scene " << options.sScenePath << std::endl;
+		return 1;
+	}
+	std::vector<olc::vf2d> observers;
+	bool bRead = false;
+	if (options.sObserverPath == "-")
+	{
+		bRead = ReadObservers(std::cin, options.nFormat == 2, &observers);
+	}
+	else
+	{
+		std::ifstream input(options.sObserverPath, options.nFormat == 2 ? std::ios::in : std::ios::binary);
+		bRead = input.is_open() && ReadObservers(input, options.nFormat == 2, &observers);
+	}
+	if (!bRead)
+	{
+		std::cerr << "cannot read observers " << options.sObserverPath << std::endl;
+		return 1;
+	}
+	std::ofstream output(options.sOutputPath, std::ios::binary | std::ios::trunc);
+	if (!output.is_open())
+	{
+		std::cerr << "cannot write " << options.sOutputPath << std::endl;
+		return 1;
+	}
+
+	// Shared by all observers
+	std::vector<olc::vf2d> intersections = FindIntersections(scene, nodes, segments);
+	std::vector<Obstacle> obstacles = FindObstacles(nodes, segments);
+	olc::vf2d vSceneMin = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	olc::vf2d vSceneMax = -vSceneMin;
+	for (const olc::vf2d& vPoint : nodes)     { vSceneMin = vSceneMin.min(vPoint); vSceneMax = vSceneMax.max(vPoint); }
+	for (const olc::vf2d& vPoint : observers) { vSceneMin = vSceneMin.min(vPoint); vSceneMax = vSceneMax.max(vPoint); }
+	olc::vf2d vMargin = 0.01f * (vSceneMax - vSceneMin) + olc::vf2d{ 1.0f, 1.0f };
+	vSceneMin -= vMargin;
+	vSceneMax += vMargin;
+
+	// Visibility polygon of one observer
+	auto computePolygon = [&](const olc::vf2d& vObserver, std::vector<olc::vf2d>* polygon)
+	{
+		polygon->clear();
+		if (IsPointInsideSolid(vObserver, nodes, obstacles)) { return; }
+		if (options.fRadius <= 0.0f)
+		{
+			*polygon = VisibilityPolygon(vObserver, { vSceneMin.x, vSceneMax.y }, vSceneMax, { vSceneMax.x, vSceneMin.y }, vSceneMin, nodes, segments, intersections);
+			return;
+		}
+
+		// Only the segments near the observer, with their nodes renumbered
+		olc::vf2d vMin = vObserver - olc::vf2d{ options.fRadius, options.fRadius };
+		olc::vf2d vMax = vObserver + olc::vf2d{ options.fRadius, options.fRadius };
+		std::vector<uint32_t> found;
+		if (!scene.FindSegmentsInBox(vMin, vMax, &found))
+		{
+			found.resize(segments.size());
+			for (int i = 0; i < segments.size(); i++) { found[i] = uint32_t(i); }
+		}
+		std::vector<olc::vf2d> nodes_local;
+		std::vector<std::array<int, 2>> segments_local;
+		std::unordered_map<int, int> localIndex;
+		for (uint32_t i_segment : found)
+		{
+			std::array<int, 2> segment;
+			for (int k = 0; k < 2; k++)
+			{
+				auto it = localIndex.emplace(segments[i_segment][k], int(nodes_local.size()));
+				if (it.second) { nodes_local.push_back(nodes[segments[i_segment][k]]); }
+				segment[k] = it.first->second;
+			}
+			segments_local.push_back(segment);
+		}
+		std::vector<olc::vf2d> intersections_local;
+		for (const olc::vf2d& vPoint : intersections)
+		{
+			if (vPoint.x >= vMin.x && vPoint.y >= vMin.y && vPoint.x <= vMax.x && vPoint.y <= vMax.y) { intersections_local.push_back(vPoint); }
+		}
+		*polygon = VisibilityPolygon(vObserver, { vMin.x, vMax.y }, vMax, { vMax.x, vMin.y }, vMin, nodes_local, segments_local, intersections_local);
+	};
+
+	// Header first, the offset table is written at the end
+	char header[32] = { 'S', 'C', '2', 'D', 'V', 'I', 'S', '\0' };
+	uint32_t nVersion = 1;
+	uint64_t nObservers = observers.size();
+	std::memcpy(header + 8, &nVersion, sizeof(uint32_t));
+	std::memcpy(header + 16, &nObservers, sizeof(uint64_t));
+	output.write(header, sizeof(header));
+
+	// Batches of observers are computed in parallel and written in order
+	int nThreads = options.nThreads > 0 ? options.nThreads : std::max(int(std::thread::hardware_concurrency()), 1);
+	std::vector<uint64_t> offsets = { 0 };
+	offsets.reserve(observers.size() + 1);
+	std::vector<std::vector<olc::vf2d>> polygons(std::min(observers.size(), size_t(nObserverBatch)));
+	for (size_t nBatchStart = 0; nBatchStart < observers.size(); nBatchStart += nObserverBatch)
+	{
+		int nBatch = int(std::min(observers.size() - nBatchStart, size_t(nObserverBatch)));
+		std::atomic<int> nNext(0);
+		auto worker = [&]()
+		{
+			for (int i = nNext++; i < nBatch; i = nNext++)
+			{
+				computePolygon(observers[nBatchStart + i], &polygons[i]);
+			}
+		};
+		std::vector<std::thread> workers;
+		for (int t = 1; t < std::min(nThreads, nBatch); t++)
+		{
+			workers.emplace_back(worker);
+		}
+		worker();
+		for (std::thread& thread : workers) { thread.join(); }
+
+		for (int i = 0; i < nBatch; i++)
+		{
+			output.write(reinterpret_cast<const char*>(polygons[i].data()), std::streamsize(polygons[i].size() * sizeof(olc::vf2d)));
+			offsets.push_back(offsets.back() + polygons[i].size());
+		}
+	}
+	uint64_t nOffsetTable = uint64_t(output.tellp());
+	output.write(reinterpret_cast<const char*>(offsets.data()), std::streamsize(offsets.size() * sizeof(uint64_t)));
+	output.seekp(24);
+	output.write(reinterpret_cast<const char*>(&nOffsetTable), sizeof(uint64_t));
+	if (!output)
+	{
+		std::cerr << "cannot write " << options.sOutputPath << std::endl;
+		return 1;
+	}
+	std::cerr << observers.size() << " observers, " << offsets.back() << " vertices" << std::endl;
+	return 0;
+}
@@ -0,0 +1,162 @@
+#ifndef AABB_TREE_H
+#define AABB_TREE_H
+
+#include "olcPixelGameEngine.h"
+
+#include <algorithm>
+#include <functional>
+
+
+// Node of the AABB tree. Leaves have no children and store the user data.
+struct AABBTreeNode
+{
+	olc::vf2d vMin;
+	olc::vf2d vMax;
+	int32_t nParent = -1; // Next free node while the node is unused
+	int32_t nChild[2] = { -1, -1 };
+	int32_t nUserData = -1;
+	int32_t nHeight = 0;
+};
+
+
+// Dynamic AABB tree (a binary R-tree kept balanced by rotations). Leaves store enlarged "fat" boxes, so objects
+// that move a little only need a new box when they leave it. Queries do not allocate memory after the first call.
+class AABBTree
+{
+public:
+	AABBTree(const float& fMargin = 1.0f);
+
+	// Insert a box and return its proxy
+	int32_t Insert(const olc::vf2d& vMin, const olc::vf2d& vMax, const int32_t& nUserData);
+
+	// Remove a proxy
+	void Remove(const int32_t& nProxy);
+
+	// Update the box of a proxy. Returns "true" if the proxy had to be re-inserted.
+	bool Update(const int32_t& nProxy, const olc::vf2d& vMin, const olc::vf2d& vMax);
+
+	// Remove all proxies
+	void Clear();
+
+	// User data and fat box of a proxy
+	int32_t GetUserData(const int32_t& nProxy) const;
+	const AABBTreeNode& GetNode(const int32_t& nProxy) const;
+
+	// Find the user data of all proxies that overlap a box
+	void QueryBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<int32_t>* userData) const;
+
+	// Best-first search for the closest object within "fMaxDistance". The callback returns the exact squared
+	// distance of an object, boxes that are further away than the best object so far are never opened.
+	// Returns the user data of the closest object or -1.
+	template<typename DistanceFunction>
+	int32_t FindNearest(const olc::vf2d& vPoint, const float& fMaxDistance, DistanceFunction distanceSquared, float* squaredDistance) const;
+
+	// Visit the proxies whose boxes are hit by the ray "vOrigin + t * vDirection" with 0 <= t <= fMaxT. The callback
+	// gets the user data and the current "fMaxT" and returns the new one, so boxes behind the closest hit are skipped.
+	template<typename HitFunction>
+	void RayCast(const olc::vf2d& vOrigin, const olc::vf2d& vDirection, float fMaxT, HitFunction hit) const;
+
+private:
+	// Node allocation from the free list
+	int32_t AllocateNode();
+	void FreeNode(const int32_t& n);
+
+	// Insert or remove a leaf and restore the boxes and heights of its ancestors
+	void InsertLeaf(const int32_t& nLeaf);
+	void RemoveLeaf(const int32_t& nLeaf);
+
+	// Rotate the subtree at "n" if it is unbalanced and return its new root
+	int32_t Balance(const int32_t& n);
+
+	// Recompute the box and height of an internal node from its children
+	void Refit(const int32_t& n);
+
+	// Squared distance from a point to the box of a node
+	float BoxDistanceSquared(const int32_t& n, const olc::vf2d& vPoint) const;
+
+	// Check if a ray segment hits the box of a node
+	bool IsBoxHitByRay(const int32_t& n, const olc::vf2d& vOrigin, const olc::vf2d& vDirection, const float& fMaxT) const;
+
+private:
+	std::vector<AABBTreeNode> treeNodes;
+	int32_t nRoot = -1;
+	int32_t nFreeNode = -1;
+	float fMargin;
+
+	// Query buffers, reused between queries
+	mutable std::vector<int32_t> stack;
+	mutable std::vector<std::pair<float, int32_t>> queue;
+};
+
+
+// Best-first search for the closest object within "fMaxDistance"
+template<typename DistanceFunction>
+int32_t AABBTree::FindNearest(const olc::vf2d& vPoint, const float& fMaxDistance, DistanceFunction distanceSquared, float* squaredDistance) const
+{
+	int32_t nBest = -1;
+	float fBest = fMaxDistance * fMaxDistance;
+	std::greater<std::pair<float, int32_t>> compare;
+
+	queue.clear();
+	if (nRoot != -1) { queue.push_back({ BoxDistanceSquared(nRoot, vPoint), nRoot }); }
+	while (!queue.empty())
+	{
+		// Open the closest box next, the search ends once it is further away than the best object
+		std::pop_heap(queue.begin(), queue.end(), compare);
+		std::pair<float, int32_t> entry = queue.back();
+		queue.pop_back();
+		if (entry.first > fBest) { break; }
+
+		const AABBTreeNode& node = treeNodes[entry.second];
+		if (node.nChild[0] == -1)
+		{
+			float fDistance = distanceSquared(node.nUserData);
+			if (fDistance <= fBest)
+			{
+				fBest = fDistance;
+				nBest = node.nUserData;
+			}
+			continue;
+		}
+		for (int k = 0; k < 2; k++)
+		{
+			float fDistance = BoxDistanceSquared(node.nChild[k], vPoint);
+			if (fDistance <= fBest)
+			{
+				queue.push_back({ fDistance, node.nChild[k] });
+				std::push_heap(queue.begin(), queue.end(), compare);
+			}
+		}
+	}
+	if (squaredDistance) { *squaredDistance = fBest; }
+	return nBest;
+}
+
+// Visit the proxies whose boxes are hit by a ray
+template<typename HitFunction>
+void AABBTree::RayCast(const olc::vf2d& vOrigin, const olc::vf2d& vDirection, float fMaxT, HitFunction hit) const
+{
+	if (nRoot == -1) { return; }
+	stack.clear();
+	stack.push_back(nRoot);
+	while (!stack.empty())
+	{
+		int32_t n = stack.back();
+		stack.pop_back();
+		if (!IsBoxHitByRay(n, vOrigin, vDirection, fMaxT)) { continue; }
+
+		const AABBTreeNode& node = treeNodes[n];
+		if (node.nChild[0] == -1)
+		{
+			fMaxT = hit(node.nUserData, fMaxT);
+		}
+		else
+		{
+			stack.push_back(node.nChild[0]);
+			stack.push_back(node.nChild[1]);
+		}
+	}
+}
+
+
+#endif // AABB_TREE_H
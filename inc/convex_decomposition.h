@@ -0,0 +1,44 @@
+#ifndef CONVEX_DECOMPOSITION_H
+#define CONVEX_DECOMPOSITION_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+#include "obstacles.h"
+
+
+// Convex part of a solid obstacle
+struct ConvexPiece
+{
+	std::vector<int> nodes; // Counter-clockwise node indices
+	int nObstacle = -1;     // Obstacle the piece belongs to
+	olc::vf2d vMin, vMax;   // Bounding box
+};
+
+// Triangulate a counter-clockwise polygon by ear clipping. Node indices may repeat along hole bridges.
+std::vector<std::array<int, 3>> TriangulatePolygon(const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon);
+
+// Decompose every solid obstacle (including its holes) into convex pieces with Hertel-Mehlhorn. A hole that cannot be
+// bridged to the outer boundary without crossing a segment, which only happens for self-intersecting geometry, leaves
+// its whole obstacle without pieces. Such obstacles are listed in "failedObstacles".
+std::vector<ConvexPiece> DecomposeObstacles(const std::vector<olc::vf2d>& nodes, const std::vector<Obstacle>& obstacles,
+	                                        std::vector<int>* failedObstacles = nullptr);
+
+// Check if the point is inside the convex piece, the bounding box is checked first
+bool IsPointInConvexPiece(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece);
+
+// Find the convex piece that contains the point. Returns -1 if the point is not inside any piece.
+int FindConvexPieceContainingPoint(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<ConvexPiece>& pieces);
+
+// Separating axis test between two convex pieces
+bool DoConvexPiecesOverlap(const std::vector<olc::vf2d>& nodes, const ConvexPiece& pieceA, const ConvexPiece& pieceB);
+
+// Separating axis test between a circle and a convex piece
+bool DoesCircleOverlapConvexPiece(const olc::vf2d& vCenter, const float& fRadius, const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece);
+
+// Find the two tangent vertices of a convex piece as seen from an outside observer. These are the only vertices
+// of the piece that can cast shadow boundaries. Returns "false" if the observer is inside the piece.
+bool FindSilhouetteVertices(const olc::vf2d& vObserver, const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece,
+	                        int* i_nodeLeft, int* i_nodeRight);
+
+
+#endif // CONVEX_DECOMPOSITION_H
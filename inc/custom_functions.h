@@ -19,18 +19,10 @@ float EuclideanDistanceToLineSquared(const olc::vf2d& vStart, const olc::vf2d& v
 // Euclidean distance from a point to a line segment
 float EuclideanDistanceToLine(const olc::vf2d& vStart, const olc::vf2d& vEnd, const olc::vf2d& vPoint);
 
-// Find the closest node to point
-int FindClosestNode(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, float* squaredDistance);
-
-// Find the closest line segment to point
-int FindClosestLineSegment(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes,
-	                       const std::vector<std::array<int, 2>>& segments, float* squaredDistance);
-
-// Find all the segments that are connected to the selected node
-std::vector<int> FindConnectedSegments(const int& i_node, const std::vector<std::array<int, 2>>& segments);
-
-// Check if the segment already exists
-bool DoesSegmentExist(const std::array<int, 2>& segment, const std::vector<std::array<int, 2>>& segments);
+// Build a compressed (CSR) node-to-segment adjacency. Segments touching node "i" are
+// stored in adjacentSegments[offsets[i]] ... adjacentSegments[offsets[i + 1] - 1].
+void BuildNodeAdjacency(const int& nNodes, const std::vector<std::array<int, 2>>& segments,
+	                    std::vector<int>* offsets, std::vector<int>* adjacentSegments);
 
 // If two line segments intersect, function returns "true" and the intersection point. Otherwise "false" is returned.
 bool SegmentToSegmentIntersection(const olc::vf2d& vA_start, const olc::vf2d& vA_end,
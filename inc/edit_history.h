@@ -0,0 +1,117 @@
+#ifndef EDIT_HISTORY_H
+#define EDIT_HISTORY_H
+
+#include "olcPixelGameEngine.h"
+#include "geometry_transaction.h"
+
+#include <deque>
+#include <unordered_map>
+
+
+// Compact delta of one edit, 28 bytes. Nodes and segments are stored as slot and generation.
+struct HistoryRecord
+{
+	GeometryEditType nType;
+	int32_t nSlot;
+	uint32_t nGeneration;
+	union
+	{
+		float fPositions[4];       // Old and new position of a node (x, y, x, y)
+		uint32_t nSegmentNodes[4]; // Slot and generation of the start and the end node of a segment
+	};
+};
+
+
+// Undo and redo history. Every undo step is a group of delta records that lives in a ring buffer with a fixed
+// memory budget, the oldest steps are evicted when it is full. Undoing or redoing a step costs O(step size).
+// Nodes and segments that are re-created by undo or redo get new handles, older records are forwarded to them.
+class EditHistory
+{
+public:
+	EditHistory(const size_t& nMemoryBudget = 8 * 1024 * 1024);
+
+	// Store the edits of one user action as an undo step. With "bMerge" they extend the previous step and repeated
+	// moves of the same node collapse into one record, so a whole drag is undone at once. Clears the redo steps.
+	void Push(const std::vector<GeometryEdit>& edits, const bool& bMerge = false);
+
+	// Undo or redo one step, the optional edits are the ones that were made to the geometry.
+	// Returns "false" if there is nothing to undo or redo.
+	bool Undo(GeometryStore* geometry, std::vector<GeometryEdit>* edits = nullptr);
+	bool Redo(GeometryStore* geometry, std::vector<GeometryEdit>* edits = nullptr);
+
+	// Check if a step can be undone or redone
+	bool CanUndo() const;
+	bool CanRedo() const;
+
+	// Remove all steps
+	void Clear();
+
+	// Translate the stored handles after the geometry store was compacted
+	void Remap(const std::vector<NodeHandle>& nodeRemap, const std::vector<SegmentHandle>& segmentRemap);
+
+	// Number of steps and memory used by the records in bytes
+	int GetUndoCount() const;
+	int GetRedoCount() const;
+	size_t GetMemoryUsage() const;
+
+private:
+	// Append a record to the open step, evicting the oldest steps if the buffer is full
+	bool Append(const HistoryRecord& record);
+
+	// Apply a record forwards (redo) or backwards (undo)
+	void Apply(GeometryTransaction* transaction, const HistoryRecord& record, const bool& bInverse);
+
+	// Count the generations a record uses while it is stored, or stop counting them when it is dropped
+	void Retain(const HistoryRecord& record);
+	void Release(const HistoryRecord& record);
+
+	// Drop the steps that can be redone
+	void DropRedoSteps();
+
+	// Current handle of a node or segment, following the forwarding of re-created ones
+	NodeHandle ResolveNode(const int32_t& nSlot, const uint32_t& nGeneration) const;
+	SegmentHandle ResolveSegment(const int32_t& nSlot, const uint32_t& nGeneration) const;
+
+	// Generations that stored records use, each forwarded straight to the newest handle of its node or segment,
+	// so resolving takes one lookup. Entries are removed with the last record that uses them.
+	template<typename Handle>
+	struct HandleForwarding
+	{
+		std::unordered_map<uint32_t, uint32_t> references;         // Generation to the number of records using it
+		std::unordered_map<uint32_t, Handle> forward;              // Generation to the newest handle
+		std::unordered_map<uint32_t, std::vector<uint32_t>> keys;  // Newest generation to the generations forwarded to it
+
+		void AddReference(const uint32_t& nGeneration);
+		void RemoveReference(const uint32_t& nGeneration);
+		Handle Resolve(const Handle& hHandle) const;
+
+		// Forward every generation that refers to "hOld" to its re-created copy "hNew"
+		void Recreate(const Handle& hOld, const Handle& hNew);
+
+		void Clear();
+	};
+
+private:
+	// Ring buffer of records, allocated on the first push
+	std::vector<HistoryRecord> records;
+	size_t nCapacity;
+	size_t nStart = 0;
+	size_t nUndoRecords = 0;
+	size_t nRedoRecords = 0;
+
+	// Number of records of every step, undo steps first
+	std::deque<size_t> steps;
+	int nUndoSteps = 0;
+
+	// Open step that merged pushes extend, with the record of every node moved in it
+	bool bMergeOpen = false;
+	bool bOverflow = false;
+	std::unordered_map<uint32_t, size_t> mergedMoves;
+
+	// Handles of re-created nodes and segments
+	HandleForwarding<NodeHandle> nodeForwarding;
+	HandleForwarding<SegmentHandle> segmentForwarding;
+};
+
+
+#endif // EDIT_HISTORY_H
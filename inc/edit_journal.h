@@ -0,0 +1,143 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include "olcPixelGameEngine.h"
+#include "geometry_transaction.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+// Journal format, little-endian. Snapshot "N" is a scene file ("<path>.N.snapshot"), journal "N"
+// ("<path>.N.journal") holds the edits made after it:
+//   header              JournalHeader
+//   generations         uint32_t[nNodes] node generations, uint32_t[nSegments] segment generations, in the packed
+//                       order of the snapshot
+//   batches             uint32_t nRecords, uint32_t nChecksum, JournalRecord[nRecords]
+// Nodes and segments are identified by their generation, which is unique and survives "Compact". A snapshot is
+// only used together with its journal, which is written after it, so a crash during compaction falls back to the
+// previous pair. A torn batch at the end of a journal fails its checksum and is ignored.
+const uint32_t nJournalVersion = 1;
+
+struct JournalHeader
+{
+	char sMagic[8];              // "SC2DJRN" followed by a zero
+	uint32_t nVersion;
+	uint32_t nReserved;
+	uint64_t nNodes;
+	uint64_t nSegments;
+};
+static_assert(sizeof(JournalHeader) == 32, "JournalHeader must not contain padding");
+
+// One edit, 16 bytes. Moves and added nodes store the new position, added segments their node generations.
+struct JournalRecord
+{
+	GeometryEditType nType;
+	uint8_t nReserved[3];
+	uint32_t nGeneration;
+	union
+	{
+		float fPosition[2];
+		uint32_t nSegmentNodes[2];
+	};
+};
+static_assert(sizeof(JournalRecord) == 16, "JournalRecord must not contain padding");
+
+
+// Crash-safe autosave. Edits are appended to a journal that a background thread writes and syncs to disk in
+// batches, so recording an edit never waits for the disk. Snapshots of the whole geometry are written by the same
+// thread and replace the journal, which keeps replay on startup short.
+class EditJournal
+{
+public:
+	EditJournal() = default;
+	~EditJournal();
+	EditJournal(const EditJournal&) = delete;
+	EditJournal& operator = (const EditJournal&) = delete;
+
+	// Restore the geometry from the latest snapshot and its journal if there are any, then start a new snapshot
+	// of the restored geometry and the background thread. Returns the number of replayed edits or -1 if nothing
+	// was restored.
+	int Open(const std::string& sPath, GeometryStore* geometry);
+
+	// Write everything that is recorded and stop the background thread
+	void Close();
+
+	bool IsOpen() const;
+
+	// Append edits, e.g. of a transaction or of an undo step
+	void Record(const std::vector<GeometryEdit>& edits);
+
+	// Replace the journal with a snapshot of the geometry, needed after the geometry was replaced as a whole
+	void Snapshot(GeometryStore* geometry);
+
+	// Check whether the journal has grown enough since the last snapshot that a new snapshot pays off
+	bool IsSnapshotDue() const;
+
+	// Time between syncs of the journal in seconds, edits are lost at most this long after they were made
+	void SetFlushInterval(const float& fSeconds);
+
+	// Block until everything recorded so far is on disk
+	void Flush();
+
+private:
+	// Geometry of a snapshot, copied so that the geometry can be edited while it is written
+	struct SnapshotData
+	{
+		std::vector<olc::vf2d> nodes;
+		std::vector<std::array<int, 2>> segments;
+		std::vector<uint32_t> nodeGenerations;
+		std::vector<uint32_t> segmentGenerations;
+	};
+
+	// Records followed by an optional snapshot, in the order they were recorded
+	struct JournalWork
+	{
+		std::vector<JournalRecord> records;
+		std::unique_ptr<SnapshotData> snapshot;
+	};
+
+	// File names of snapshot and journal "N"
+	std::string SnapshotPath(const uint64_t& nSequence) const;
+	std::string JournalPath(const uint64_t& nSequence) const;
+
+	// Load snapshot "N" and apply its journal, returns the number of applied edits or -1
+	int Replay(const uint64_t& nSequence, GeometryStore* geometry) const;
+
+	// Write and sync queued work until the journal is closed
+	void WriterThread();
+
+	// Append one batch of records to the open journal
+	void WriteBatch(const std::vector<JournalRecord>& records);
+
+	// Write snapshot "N + 1" with its empty journal and remove pair "N"
+	void WriteSnapshot(const SnapshotData& snapshot);
+
+private:
+	std::string sPath;
+	float fFlushInterval = 0.5f;
+
+	// Used by the recording thread only
+	uint64_t nRecordedBytes = 0;
+	uint64_t nSnapshotBytes = 0;
+
+	// Used by the writer thread only
+	uint64_t nSequence = 0;
+	std::FILE* journalFile = nullptr;
+
+	// Shared with the writer thread
+	std::mutex mutex;
+	std::condition_variable wakeWriter;
+	std::condition_variable workDone;
+	std::deque<JournalWork> queue;
+	uint64_t nQueued = 0;
+	uint64_t nWritten = 0;
+	bool bFlush = false;
+	bool bStop = false;
+	std::thread writer;
+};
+
+
+#endif // EDIT_JOURNAL_H
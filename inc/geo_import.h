@@ -0,0 +1,37 @@
+#ifndef GEO_IMPORT_H
+#define GEO_IMPORT_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+#include "geometry_transaction.h"
+
+
+// Settings of the GeoJSON and WKT importer
+struct GeoImportOptions
+{
+	bool bGeographic = true;      // Coordinates are longitude and latitude in degrees and are projected to metres
+	bool bAutoOrigin = true;      // Use the center of the bounding box of the input as the origin
+	olc::vd2d vOrigin;            // Origin of the local frame in input coordinates if "bAutoOrigin" is off
+	float fWeldDistance = 1e-3f;  // Vertices that fall into the same cell of this size in the local frame share one node
+	int nThreads = 0;             // Number of worker threads, 0 uses all hardware threads
+};
+
+// Counts of an import
+struct GeoImportStats
+{
+	int nFeatures = 0;
+	int nNodes = 0;
+	int nSegments = 0;
+	olc::vd2d vOrigin; // Origin of the local frame that was used
+};
+
+
+// Import the line geometry of a GeoJSON file or of a WKT dump. LineString, MultiLineString, Polygon and
+// MultiPolygon geometries are imported, everything else is skipped. The input is split into chunks at feature
+// boundaries that are parsed in parallel, the coordinates are moved into a local frame around a double-precision
+// origin before they are rounded to float, and the vertices are welded in parallel before they are added to the
+// transaction. Returns "false" if the file cannot be read.
+bool ImportGeo(const std::string& sPath, GeometryTransaction* transaction, const GeoImportOptions& options = GeoImportOptions(), GeoImportStats* stats = nullptr);
+
+
+#endif // GEO_IMPORT_H
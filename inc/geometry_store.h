@@ -0,0 +1,225 @@
+#ifndef GEOMETRY_STORE_H
+#define GEOMETRY_STORE_H
+
+#include "olcPixelGameEngine.h"
+#include "node_grid.h"
+#include "aabb_tree.h"
+
+#include <unordered_map>
+
+
+// Generational handle to a node. It stays valid until the node is deleted or the store is compacted.
+struct NodeHandle
+{
+	int32_t nSlot = -1;
+	uint32_t nGeneration = 0;
+	bool operator == (const NodeHandle& rhs) const { return nSlot == rhs.nSlot && nGeneration == rhs.nGeneration; }
+	bool operator != (const NodeHandle& rhs) const { return !(*this == rhs); }
+};
+
+// Generational handle to a segment. It stays valid until the segment or one of its nodes is deleted.
+struct SegmentHandle
+{
+	int32_t nSlot = -1;
+	uint32_t nGeneration = 0;
+	bool operator == (const SegmentHandle& rhs) const { return nSlot == rhs.nSlot && nGeneration == rhs.nGeneration; }
+	bool operator != (const SegmentHandle& rhs) const { return !(*this == rhs); }
+};
+
+
+class GeometryTransaction;
+
+
+// Node and segment storage with stable handles and O(1) deletion. Deleted slots are recycled through free lists.
+// Every node keeps an intrusive list of its connected segments, so topology queries cost O(degree), and
+// segments are indexed by their node pair, so duplicate checks cost O(1). Nodes are also kept in a spatial
+// grid and segments in a dynamic AABB tree, both updated with every edit, so picking does not depend on the
+// total number of nodes or segments.
+// Algorithms that work on plain "nodes" and "segments" vectors use the packed views, which are rebuilt lazily
+// after nodes or segments were added or deleted. Batched edits ("Assign" and transactions) defer
+// the spatial index updates and apply them once at the end, so spatial queries do not see an open batch.
+// Every edit increases a version counter and grows a dirty region, so derived data can tell cheaply whether and
+// where it is stale.
+class GeometryStore
+{
+	friend class GeometryTransaction;
+
+public:
+	// Add a node
+	NodeHandle AddNode(const olc::vf2d& vPosition);
+
+	// Move a node. Returns "false" if the handle is no longer valid.
+	bool MoveNode(const NodeHandle& hNode, const olc::vf2d& vPosition);
+
+	// Delete a node together with its connected segments, O(degree)
+	bool DeleteNode(const NodeHandle& hNode);
+
+	// Add a segment between two different nodes. Returns an invalid handle if the nodes are already connected.
+	SegmentHandle AddSegment(const NodeHandle& hStart, const NodeHandle& hEnd);
+
+	// Add many segments at once, skipping invalid ones and duplicates (also within the batch).
+	// Returns the number of added segments, the optional handles are invalid for skipped segments.
+	int AddSegments(const std::vector<std::array<NodeHandle, 2>>& newSegments, std::vector<SegmentHandle>* handles = nullptr);
+
+	// Find the segment that connects two nodes in either direction. Returns an invalid handle if there is none.
+	SegmentHandle FindSegment(const NodeHandle& hStart, const NodeHandle& hEnd) const;
+
+	// Delete a segment. Returns "false" if the handle is no longer valid.
+	bool DeleteSegment(const SegmentHandle& hSegment);
+
+	// Replace the whole geometry
+	void Assign(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments);
+
+	// Delete all nodes and segments
+	void Clear();
+
+	// Reserve memory for nodes and segments
+	void Reserve(const int& nNodes, const int& nSegments);
+
+	// Check if a handle refers to an existing node or segment
+	bool IsValid(const NodeHandle& hNode) const;
+	bool IsValid(const SegmentHandle& hSegment) const;
+
+	// Access nodes and segments by handle
+	const olc::vf2d& GetNodePosition(const NodeHandle& hNode) const;
+	std::array<NodeHandle, 2> GetSegmentNodes(const SegmentHandle& hSegment) const;
+
+	// Number of segments connected to a node, 0 for an invalid handle
+	int GetNodeDegree(const NodeHandle& hNode) const;
+
+	// Segments connected to a node and the nodes at their other end, in O(degree). Empty for an invalid handle.
+	void GetConnectedSegments(const NodeHandle& hNode, std::vector<SegmentHandle>* connectedSegments) const;
+	void GetNeighbourNodes(const NodeHandle& hNode, std::vector<NodeHandle>* neighbourNodes) const;
+
+	// Find the closest node within "fMaxDistance". Returns an invalid handle if there is none.
+	NodeHandle FindNearestNode(const olc::vf2d& vPoint, const float& fMaxDistance, float* squaredDistance = nullptr) const;
+
+	// Find all nodes within a radius or inside an axis aligned box
+	void FindNodesInRadius(const olc::vf2d& vPoint, const float& fRadius, std::vector<NodeHandle>* foundNodes) const;
+	void FindNodesInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<NodeHandle>* foundNodes) const;
+
+	// Find the closest segment within "fMaxDistance". Returns an invalid handle if there is none.
+	SegmentHandle FindNearestSegment(const olc::vf2d& vPoint, const float& fMaxDistance, float* squaredDistance = nullptr) const;
+
+	// Number of existing nodes and segments
+	int GetNodeCount() const;
+	int GetSegmentCount() const;
+
+	// Ratio of free slots to all slots
+	float GetFragmentation() const;
+
+	// Move all nodes and segments to the front of their storage. Handles change, the optional remap tables
+	// translate old slots into new handles.
+	void Compact(std::vector<NodeHandle>* nodeRemap = nullptr, std::vector<SegmentHandle>* segmentRemap = nullptr);
+
+	// Versions that increase with every change of the nodes or of the segments. Moving a node changes the
+	// geometry of its segments but only the node version, so caches of segment geometry compare both.
+	uint64_t GetNodeVersion() const;
+	uint64_t GetSegmentVersion() const;
+
+	// Bounding box of everything that changed since the last reset, including the old positions of moved and
+	// deleted geometry. Returns "false" if nothing changed. After "Clear" the region is unbounded.
+	bool GetDirtyRegion(olc::vf2d* vMin, olc::vf2d* vMax) const;
+	void ResetDirtyRegion();
+
+	// Packed views of the geometry, indices refer to positions in these vectors
+	const std::vector<olc::vf2d>& GetNodes();
+	const std::vector<std::array<int, 2>>& GetSegments();
+
+	// Conversion between packed indices and handles
+	NodeHandle GetNodeHandle(const int& i_node);
+	SegmentHandle GetSegmentHandle(const int& i_segment);
+	int GetNodeIndex(const NodeHandle& hNode);
+	int GetSegmentIndex(const SegmentHandle& hSegment);
+
+private:
+	// Rebuild the packed views if nodes or segments were added or deleted
+	void UpdatePackedViews();
+
+	// Allocate a slot from the free list or at the end of the storage
+	static int32_t AllocateSlot(std::vector<int32_t>* freeSlots, const int32_t& nSlotCount);
+
+	// Insert or remove a segment slot in the connection lists of its nodes
+	void LinkSegment(const int32_t& nSegmentSlot);
+	void UnlinkSegment(const int32_t& nSegmentSlot);
+
+	// Release a segment slot that is already unlinked
+	void ReleaseSegment(const int32_t& nSegmentSlot);
+
+	// Insert a segment slot into the segment tree or refit its box
+	void InsertSegmentProxy(const int32_t& nSegmentSlot);
+	void UpdateSegmentProxy(const int32_t& nSegmentSlot);
+
+	// Defer the spatial index updates until the outermost batch ends
+	void BeginDeferredIndexing();
+	void EndDeferredIndexing();
+
+	// Fit the cell size of the node grid to the nodes when their number changed a lot
+	void FitNodeGrid();
+
+	// Take a node or segment out of the spatial index until the batch ends
+	void MarkNodeDirty(const int32_t& nNodeSlot);
+	void MarkSegmentDirty(const int32_t& nSegmentSlot);
+
+	// Grow the dirty region by a point or make it unbounded
+	void ExpandDirtyRegion(const olc::vf2d& vPoint);
+	void ExpandDirtyRegionToAll();
+
+	// Direction independent key of a node pair
+	static uint64_t SegmentKey(const int32_t& nStartSlot, const int32_t& nEndSlot);
+
+private:
+	// Nodes, one entry per slot
+	std::vector<olc::vf2d> nodePositions;
+	std::vector<uint32_t> nodeGenerations;
+	std::vector<uint8_t> nodeAlive;
+	std::vector<int32_t> nodeFirstSegment; // Head of the connection list, -1 if the node has no segments
+	std::vector<int32_t> nodeFreeSlots;
+	int nNodeCount = 0;
+
+	// Segments, one entry per slot
+	std::vector<std::array<NodeHandle, 2>> segmentNodes;
+	std::vector<uint32_t> segmentGenerations;
+	std::vector<uint8_t> segmentAlive;
+	std::vector<std::array<int32_t, 2>> segmentNextSegment; // Next segment in the connection list of each end node
+	std::vector<int32_t> segmentFreeSlots;
+	std::unordered_map<uint64_t, int32_t> segmentLookup; // Node pair key to segment slot
+	int nSegmentCount = 0;
+
+	// Spatial index of the nodes, the query buffer is reused between queries
+	NodeGrid nodeGrid;
+	int32_t nNodeGridFitCount = 0; // Number of nodes at the last fit of the cell size
+	mutable std::vector<int32_t> querySlots;
+
+	// Spatial index of the segments, one proxy per segment slot
+	AABBTree segmentTree;
+	std::vector<int32_t> segmentProxy; // -1 while the segment is not in the tree
+
+	// Slots that are left out of the spatial indices until the current batch ends
+	int nDeferredDepth = 0;
+	std::vector<uint8_t> nodeIndexDirty;
+	std::vector<int32_t> dirtyNodes;
+	std::vector<uint8_t> segmentIndexDirty;
+	std::vector<int32_t> dirtySegments;
+
+	// Change tracking
+	uint64_t nNodeVersion = 0;
+	uint64_t nSegmentVersion = 0;
+	bool bDirty = false;
+	olc::vf2d vDirtyMin, vDirtyMax;
+
+	// Every allocation gets a new generation, so handles are never reused
+	uint32_t nNextGeneration = 1;
+
+	// Packed views
+	bool bPackedDirty = false;
+	std::vector<olc::vf2d> packedNodes;
+	std::vector<std::array<int, 2>> packedSegments;
+	std::vector<int32_t> packedNodeSlots;
+	std::vector<int32_t> packedSegmentSlots;
+	std::vector<int32_t> nodeSlotToPacked;
+	std::vector<int32_t> segmentSlotToPacked;
+};
+
+
+#endif // GEOMETRY_STORE_H
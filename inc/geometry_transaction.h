@@ -0,0 +1,69 @@
+#ifndef GEOMETRY_TRANSACTION_H
+#define GEOMETRY_TRANSACTION_H
+
+#include "olcPixelGameEngine.h"
+#include "geometry_store.h"
+
+
+// Type of a recorded edit
+enum class GeometryEditType : uint8_t
+{
+	AddNode,
+	MoveNode,
+	DeleteNode,
+	AddSegment,
+	DeleteSegment,
+};
+
+// One recorded edit. Deleting a node records the deletion of each connected segment first.
+struct GeometryEdit
+{
+	GeometryEditType nType;
+	NodeHandle hNode;
+	SegmentHandle hSegment;
+	std::array<NodeHandle, 2> segmentNodes;
+	olc::vf2d vOldPosition;
+	olc::vf2d vNewPosition;
+};
+
+
+// Batch of edits on a geometry store. Edits change the nodes and segments immediately, so new handles can be
+// used right away, while the spatial indices are updated once on "Commit" for every node and segment that was
+// touched. The transaction commits itself when it goes out of scope.
+class GeometryTransaction
+{
+public:
+	GeometryTransaction(GeometryStore* geometry);
+	~GeometryTransaction();
+
+	// Edits, same behaviour as the geometry store functions
+	NodeHandle AddNode(const olc::vf2d& vPosition);
+	bool MoveNode(const NodeHandle& hNode, const olc::vf2d& vPosition);
+	bool DeleteNode(const NodeHandle& hNode);
+	SegmentHandle AddSegment(const NodeHandle& hStart, const NodeHandle& hEnd);
+	bool DeleteSegment(const SegmentHandle& hSegment);
+
+	// Translate, rotate or delete many nodes, invalid handles are skipped
+	void TranslateNodes(const std::vector<NodeHandle>& hNodes, const olc::vf2d& vOffset);
+	void RotateNodes(const std::vector<NodeHandle>& hNodes, const float& fAngle, const olc::vf2d& vRotationCenter);
+	int DeleteNodes(const std::vector<NodeHandle>& hNodes);
+
+	// Update the spatial indices. Further edits start a new batch.
+	void Commit();
+
+	// Edits recorded since the transaction was created
+	const std::vector<GeometryEdit>& GetEdits() const;
+
+private:
+	// Start a batch if none is open
+	void Open();
+
+private:
+	GeometryStore* geometry;
+	bool bOpen = false;
+	std::vector<GeometryEdit> edits;
+	std::vector<SegmentHandle> connectedSegments;
+};
+
+
+#endif // GEOMETRY_TRANSACTION_H
@@ -0,0 +1,54 @@
+#ifndef NODE_GRID_H
+#define NODE_GRID_H
+
+#include "olcPixelGameEngine.h"
+
+#include <unordered_map>
+
+
+// Uniform hash grid over node slots. Only occupied cells are stored, queries do not allocate memory
+// (apart from growing the output vectors) and moving a node only touches the cells it leaves and enters.
+// The cell size is fitted to the stored nodes with "Fit", queries that would visit more empty cells than
+// there are occupied ones visit the occupied cells instead.
+class NodeGrid
+{
+public:
+	NodeGrid(const float& fCellSize = 10.0f);
+
+	// Remove all nodes and optionally change the cell size
+	void Clear();
+	void Clear(const float& fCellSize);
+
+	// Insert, remove or move a node slot
+	void Insert(const int32_t& nSlot, const olc::vf2d& vPosition);
+	void Remove(const int32_t& nSlot, const olc::vf2d& vPosition);
+	void Move(const int32_t& nSlot, const olc::vf2d& vOldPosition, const olc::vf2d& vNewPosition);
+
+	// Choose the cell size from the stored nodes, so that an occupied cell holds a few nodes, and re-bucket them
+	void Fit(const std::vector<olc::vf2d>& positions);
+
+	// Number of stored nodes and the current cell size
+	int32_t GetCount() const;
+	float GetCellSize() const;
+
+	// Find the closest node within "fMaxDistance". Returns -1 if there is none.
+	int32_t FindNearest(const olc::vf2d& vPoint, const float& fMaxDistance, const std::vector<olc::vf2d>& positions, float* squaredDistance) const;
+
+	// Find all nodes within a radius or inside an axis aligned box
+	void FindInRadius(const olc::vf2d& vPoint, const float& fRadius, const std::vector<olc::vf2d>& positions, std::vector<int32_t>* slots) const;
+	void FindInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, const std::vector<olc::vf2d>& positions, std::vector<int32_t>* slots) const;
+
+private:
+	// Cell coordinate of a position and the hash key of a cell
+	int32_t CellCoordinate(const float& fValue) const;
+	static uint64_t CellKey(const int32_t& nX, const int32_t& nY);
+
+private:
+	float fCellSize;
+	float fInverseCellSize;
+	int32_t nCount = 0;
+	std::unordered_map<uint64_t, std::vector<int32_t>> cells;
+};
+
+
+#endif // NODE_GRID_H
@@ -0,0 +1,42 @@
+#ifndef OBSTACLES_H
+#define OBSTACLES_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+
+
+// Closed loop of segments. Loops at an even nesting depth are solid, loops at an odd depth are holes in their parent.
+struct Obstacle
+{
+	std::vector<int> nodes;    // Loop nodes in traversal order, the first node is not repeated
+	std::vector<int> segments; // Segment "i" connects nodes[i] and nodes[i + 1]
+	bool bCounterClockwise = true;
+	bool bSolid = true;
+	int nParent = -1;          // Innermost loop that encloses this one
+	int nDepth = 0;            // Number of loops that enclose this one
+	float fArea = 0.0f;
+	olc::vf2d vMin, vMax;      // Bounding box
+};
+
+// Signed area of a polygon given by node indices, positive for counter-clockwise polygons
+float PolygonSignedArea(const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon);
+
+// Even-odd point in polygon test
+bool IsPointInPolygon(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon);
+
+// Find all bounded faces of the segment graph and classify them as solids or holes. Nodes may have any number of
+// segments, faces are walked by picking the next segment by angle at every node.
+std::vector<Obstacle> FindObstacles(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments);
+
+// Find the innermost loop that contains the point. Returns -1 if the point is not inside any loop.
+int FindEnclosingObstacle(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<Obstacle>& obstacles);
+
+// Check if the point lies inside solid material
+bool IsPointInsideSolid(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<Obstacle>& obstacles);
+
+// Flag the loop segments whose solid side faces the observer. They can never be the first hit of a ray from the observer.
+std::vector<bool> FindBackFacingSegments(const olc::vf2d& vObserver, const std::vector<olc::vf2d>& nodes,
+	                                     const std::vector<std::array<int, 2>>& segments, const std::vector<Obstacle>& obstacles);
+
+
+#endif // OBSTACLES_H
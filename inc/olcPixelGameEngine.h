@@ -703,6 +703,11 @@ namespace olc
 	struct ResourceBuffer : public std::streambuf
 	{
 		ResourceBuffer(std::ifstream& ifs, uint32_t offset, uint32_t size);
+		// View of memory owned by a mapped pack, nothing is copied
+		ResourceBuffer(const char* data, uint32_t size);
+		// Contents of the file, either "vMemory" or the view
+		const char* Data() const;
+		size_t Size() const;
 		std::vector<char> vMemory;
 	};
 
@@ -713,6 +718,8 @@ namespace olc
 		~ResourcePack();
 		bool AddFile(const std::string& sFile);
 		bool LoadPack(const std::string& sFile, const std::string& sKey);
+		// Memory-map the pack and descramble only its index, file buffers are then views into the mapping
+		bool MapPack(const std::string& sFile, const std::string& sKey);
 		bool SavePack(const std::string& sFile, const std::string& sKey);
 		ResourceBuffer GetFileBuffer(const std::string& sFile);
 		bool Loaded();
@@ -720,6 +727,12 @@ namespace olc
 		struct sResourceFile { uint32_t nSize; uint32_t nOffset; };
 		std::map<std::string, sResourceFile> mapFiles;
 		std::ifstream baseFile;
+		const char* pMapping = nullptr;
+		size_t nMappingSize = 0;
+		bool bMapped = false;
+		std::vector<char> vMappingFallback; // Pack contents where memory mapping is not available
+		bool readindex(const std::vector<char>& decoded, size_t nFileSize);
+		void unmap();
 		std::vector<char> scramble(const std::vector<char>& data, const std::string& key);
 		std::string makeposix(const std::string& path);
 	};
@@ -1236,6 +1249,15 @@ namespace olc
 #ifdef OLC_PGE_APPLICATION
 #undef OLC_PGE_APPLICATION
 
+// Memory-mapped resource packs
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OLC_RESOURCE_PACK_MMAP
+#endif
+
 // O------------------------------------------------------------------------------O
 // | olcPixelGameEngine INTERFACE IMPLEMENTATION (CORE)                           |
 // | Note: The core implementation is platform independent                        |
@@ -1569,8 +1591,18 @@ namespace olc
 		setg(vMemory.data(), vMemory.data(), vMemory.data() + size);
 	}
 
+	ResourceBuffer::ResourceBuffer(const char* data, uint32_t size)
+	{
+		// The get area is never written to, putting back a different character fails
+		char* p = const_cast<char*>(data);
+		setg(p, p, p + size);
+	}
+
+	const char* ResourceBuffer::Data() const { return eback(); }
+	size_t ResourceBuffer::Size() const { return size_t(egptr() - eback()); }
+
 	ResourcePack::ResourcePack() { }
-	ResourcePack::~ResourcePack() { baseFile.close(); }
+	ResourcePack::~ResourcePack() { baseFile.close(); unmap(); }
 
 	bool ResourcePack::AddFile(const std::string& sFile)
 	{
@@ -1590,6 +1622,7 @@ namespace olc
 	bool ResourcePack::LoadPack(const std::string& sFile, const std::string& sKey)
 	{
 		// Open the resource file
+		unmap();
 		baseFile.open(sFile, std::ifstream::binary);
 		if (!baseFile.is_open()) return false;
 
@@ -1601,38 +1634,94 @@ namespace olc
 		for (uint32_t j = 0; j < nIndexSize; j++)
 			buffer[j] = baseFile.get();
 
+		// 2) Read Map
 		std::vector<char> decoded = scramble(buffer, sKey);
+		if (!readindex(decoded, size_t(-1))) { baseFile.close(); return false; }
+
+		// Don't close base file! we will provide a stream
+		// pointer when the file is requested
+		return true;
+	}
+
+	bool ResourcePack::MapPack(const std::string& sFile, const std::string& sKey)
+	{
+		baseFile.close();
+		unmap();
+		mapFiles.clear();
+
+#ifdef OLC_RESOURCE_PACK_MMAP
+		int fd = open(sFile.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size <= 0) { close(fd); return false; }
+		void* pView = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd); // The mapping keeps the file open
+		if (pView == MAP_FAILED) return false;
+		pMapping = (const char*)pView;
+		nMappingSize = size_t(info.st_size);
+		bMapped = true;
+#else
+		// Read once, file buffers are still views
+		std::ifstream ifs(sFile, std::ifstream::binary | std::ifstream::ate);
+		if (!ifs.is_open()) return false;
+		vMappingFallback.resize(size_t(ifs.tellg()));
+		ifs.seekg(0);
+		if (vMappingFallback.empty() || !ifs.read(vMappingFallback.data(), vMappingFallback.size())) { vMappingFallback.clear(); return false; }
+		pMapping = vMappingFallback.data();
+		nMappingSize = vMappingFallback.size();
+#endif
+
+		// Only the index is scrambled, the file data is stored as it is
+		uint32_t nIndexSize = 0;
+		if (nMappingSize >= sizeof(uint32_t)) memcpy(&nIndexSize, pMapping, sizeof(uint32_t));
+		if (nMappingSize < sizeof(uint32_t) || nIndexSize > nMappingSize - sizeof(uint32_t)) { unmap(); return false; }
+		std::vector<char> buffer(pMapping + sizeof(uint32_t), pMapping + sizeof(uint32_t) + nIndexSize);
+		if (!readindex(scramble(buffer, sKey), nMappingSize)) { unmap(); mapFiles.clear(); return false; }
+		return true;
+	}
+
+	bool ResourcePack::readindex(const std::vector<char>& decoded, size_t nFileSize)
+	{
 		size_t pos = 0;
 		auto read = [&decoded, &pos](char* dst, size_t size) {
+			if (size > decoded.size() - pos) return false;
 			memcpy((void*)dst, (const void*)(decoded.data() + pos), size);
 			pos += size;
+			return true;
 		};
 
-		auto get = [&read]() -> int { char c; read(&c, 1); return c; };
-
-		// 2) Read Map
 		uint32_t nMapEntries = 0;
-		read((char*)&nMapEntries, sizeof(uint32_t));
+		if (!read((char*)&nMapEntries, sizeof(uint32_t))) return false;
 		for (uint32_t i = 0; i < nMapEntries; i++)
 		{
 			uint32_t nFilePathSize = 0;
-			read((char*)&nFilePathSize, sizeof(uint32_t));
+			if (!read((char*)&nFilePathSize, sizeof(uint32_t))) return false;
 
 			std::string sFileName(nFilePathSize, ' ');
-			for (uint32_t j = 0; j < nFilePathSize; j++)
-				sFileName[j] = get();
+			if (!read(&sFileName[0], nFilePathSize)) return false;
 
 			sResourceFile e;
-			read((char*)&e.nSize, sizeof(uint32_t));
-			read((char*)&e.nOffset, sizeof(uint32_t));
+			if (!read((char*)&e.nSize, sizeof(uint32_t)) || !read((char*)&e.nOffset, sizeof(uint32_t))) return false;
+
+			// Views must not reach past the end of the pack
+			if (size_t(e.nOffset) + size_t(e.nSize) > nFileSize) return false;
 			mapFiles[sFileName] = e;
 		}
-
-		// Don't close base file! we will provide a stream
-		// pointer when the file is requested
 		return true;
 	}
 
+	void ResourcePack::unmap()
+	{
+#ifdef OLC_RESOURCE_PACK_MMAP
+		if (bMapped) munmap((void*)pMapping, nMappingSize);
+#endif
+		vMappingFallback.clear();
+		vMappingFallback.shrink_to_fit();
+		pMapping = nullptr;
+		nMappingSize = 0;
+		bMapped = false;
+	}
+
 	bool ResourcePack::SavePack(const std::string& sFile, const std::string& sKey)
 	{
 		// Create/Overwrite the resource file
@@ -1709,12 +1798,15 @@ namespace olc
 
 	ResourceBuffer ResourcePack::GetFileBuffer(const std::string& sFile)
 	{
-		return ResourceBuffer(baseFile, mapFiles[sFile].nOffset, mapFiles[sFile].nSize);
+		auto it = mapFiles.find(sFile);
+		if (it == mapFiles.end()) return ResourceBuffer(nullptr, 0);
+		if (pMapping != nullptr) return ResourceBuffer(pMapping + it->second.nOffset, it->second.nSize);
+		return ResourceBuffer(baseFile, it->second.nOffset, it->second.nSize);
 	}
 
 	bool ResourcePack::Loaded()
 	{
-		return baseFile.is_open();
+		return baseFile.is_open() || pMapping != nullptr;
 	}
 
 	std::vector<char> ResourcePack::scramble(const std::vector<char>& data, const std::string& key)
@@ -4494,7 +4586,7 @@ namespace olc
 			{
 				// Load sprite from input stream
 				ResourceBuffer rb = pack->GetFileBuffer(sImageFile);
-				bmp = Gdiplus::Bitmap::FromStream(SHCreateMemStream((BYTE*)rb.vMemory.data(), UINT(rb.vMemory.size())));
+				bmp = Gdiplus::Bitmap::FromStream(SHCreateMemStream((const BYTE*)rb.Data(), UINT(rb.Size())));
 			}
 			else
 			{
@@ -4692,7 +4784,7 @@ namespace olc
 			if (pack != nullptr)
 			{
 				ResourceBuffer rb = pack->GetFileBuffer(sImageFile);
-				bytes = stbi_load_from_memory((unsigned char*)rb.vMemory.data(), rb.vMemory.size(), &w, &h, &cmp, 4);
+				bytes = stbi_load_from_memory((const unsigned char*)rb.Data(), int(rb.Size()), &w, &h, &cmp, 4);
 			}
 			else
 			{
@@ -0,0 +1,30 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+// Run a function for every index on the worker threads, thread "t" takes the indices t, t + nThreads, ...
+template<typename Function>
+void ParallelFor(const int& nCount, const int& nThreads, Function function)
+{
+	if (nThreads <= 1 || nCount <= 1)
+	{
+		for (int i = 0; i < nCount; i++) { function(i); }
+		return;
+	}
+	std::vector<std::thread> workers;
+	for (int t = 0; t < std::min(nThreads, nCount); t++)
+	{
+		workers.emplace_back([&, t]()
+		{
+			for (int i = t; i < nCount; i += nThreads) { function(i); }
+		});
+	}
+	for (std::thread& worker : workers) { worker.join(); }
+}
+
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,80 @@
+#ifndef PREFABS_H
+#define PREFABS_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+#include "aabb_tree.h"
+
+
+// Shared geometry of a prefab in its local space, with its own segment tree (bottom level)
+struct Prefab
+{
+	std::vector<olc::vf2d> nodes;
+	std::vector<std::array<int, 2>> segments;
+	AABBTree segmentTree = AABBTree(0.0f);
+	olc::vf2d vMin, vMax;
+};
+
+// Placement of a prefab. World = vPosition + rotation(fRotation) * fScale * local.
+struct PrefabInstance
+{
+	int nPrefab = -1;
+	olc::vf2d vPosition;
+	float fRotation = 0.0f;
+	float fScale = 1.0f;
+	int32_t nProxy = -1; // Proxy in the instance tree, -1 for removed instances
+};
+
+
+// Prefab definitions and their instances. Instances only store a transform and are kept in a tree of their world
+// boxes (top level). Queries transform points and rays into prefab space and continue in the prefab segment tree,
+// so the prefab geometry is never copied per instance.
+class PrefabScene
+{
+public:
+	// Add a prefab definition, returns its index
+	int AddPrefab(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments);
+
+	// Add, move or remove an instance. Instance indices are reused after removal.
+	int AddInstance(const int& nPrefab, const olc::vf2d& vPosition, const float& fRotation = 0.0f, const float& fScale = 1.0f);
+	bool MoveInstance(const int& i_instance, const olc::vf2d& vPosition, const float& fRotation);
+	bool RemoveInstance(const int& i_instance);
+
+	// Remove all prefabs and instances
+	void Clear();
+
+	// Access prefabs and instances
+	int GetPrefabCount() const;
+	int GetInstanceCount() const;
+	const Prefab& GetPrefab(const int& nPrefab) const;
+	const PrefabInstance& GetInstance(const int& i_instance) const;
+
+	// Transform between prefab space and world space
+	olc::vf2d ToWorld(const PrefabInstance& instance, const olc::vf2d& vLocal) const;
+	olc::vf2d ToLocal(const PrefabInstance& instance, const olc::vf2d& vWorld) const;
+
+	// Find the instances whose world box overlaps a box
+	void FindInstancesInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<int32_t>* foundInstances) const;
+
+	// Find the closest instance segment within "fMaxDistance". Returns the instance or -1.
+	int FindNearestSegment(const olc::vf2d& vPoint, const float& fMaxDistance, int* i_segment, float* squaredDistance) const;
+
+	// Closest hit of the ray from "vRayStart" through "vRayEnd". The hit is "vRayStart + fT * (vRayEnd - vRayStart)".
+	bool RayCast(const olc::vf2d& vRayStart, const olc::vf2d& vRayEnd, float* fT) const;
+
+	// Memory used by prefabs and instances in bytes
+	size_t GetMemoryUsage() const;
+
+private:
+	// World box of an instance
+	void InstanceBounds(const PrefabInstance& instance, olc::vf2d* vMin, olc::vf2d* vMax) const;
+
+private:
+	std::vector<Prefab> prefabs;
+	std::vector<PrefabInstance> instances;
+	std::vector<int> freeInstances;
+	AABBTree instanceTree;
+};
+
+
+#endif // PREFABS_H
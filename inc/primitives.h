@@ -0,0 +1,63 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+
+
+// Type of a solid primitive
+enum class PrimitiveType
+{
+	Rectangle,
+	Circle,
+	ConvexPolygon,
+};
+
+// Solid shape that is intersected analytically instead of as loose segments. Rectangles are also stored as their
+// four vertices, so they share the convex polygon code. The bounding box is cached when the primitive is made.
+struct Primitive
+{
+	PrimitiveType nType = PrimitiveType::ConvexPolygon;
+	olc::vf2d vCenter;               // Center of a rectangle or a circle
+	olc::vf2d vHalfSize;             // Half extents of a rectangle
+	float fRotation = 0.0f;          // Rotation of a rectangle
+	float fRadius = 0.0f;            // Radius of a circle
+	std::vector<olc::vf2d> vertices; // Counter-clockwise vertices of a rectangle or a convex polygon
+	olc::vf2d vMin, vMax;            // Bounding box
+};
+
+// Make a rotated rectangle
+Primitive MakeRectangle(const olc::vf2d& vCenter, const olc::vf2d& vHalfSize, const float& fRotation = 0.0f);
+
+// Make a circle
+Primitive MakeCircle(const olc::vf2d& vCenter, const float& fRadius);
+
+// Make a convex polygon from the convex hull of the points
+Primitive MakeConvexPolygon(const std::vector<olc::vf2d>& points);
+
+// Check if a point is inside a primitive, the bounding box is checked first
+bool IsPointInPrimitive(const olc::vf2d& vPoint, const Primitive& primitive);
+
+// Squared distance from a point to the outline of a primitive
+float PrimitiveDistanceSquared(const olc::vf2d& vPoint, const Primitive& primitive);
+
+// Find the primitive with the closest outline within "fMaxDistance". Primitives whose bounding box is further away
+// are skipped without looking at their outline. Returns -1 if there is none.
+int FindClosestPrimitive(const olc::vf2d& vPoint, const std::vector<Primitive>& primitives, const float& fMaxDistance, float* squaredDistance);
+
+// First hit of the ray from "vRayStart" through "vRayEnd" with the outline of a primitive. The hit is
+// "vRayStart + fT * (vRayEnd - vRayStart)". A ray that starts inside hits the outline on its way out.
+bool RayToPrimitiveIntersection(const olc::vf2d& vRayStart, const olc::vf2d& vRayEnd, const Primitive& primitive, float* fT);
+
+// All intersections of a line segment with the outline of a primitive
+void SegmentToPrimitiveIntersections(const olc::vf2d& vStart, const olc::vf2d& vEnd, const Primitive& primitive, std::vector<olc::vf2d>* points);
+
+// Points of the outline that can bound the visible region as seen from the observer: the vertices of the front-facing
+// edges of a polygon, or the tangent points and front-facing outline samples of a circle
+void FindPrimitiveSilhouette(const olc::vf2d& vObserver, const Primitive& primitive, std::vector<olc::vf2d>* points);
+
+// Outline of a primitive as a closed polyline, circles are approximated with "nCircleSegments" segments
+void GetPrimitiveOutline(const Primitive& primitive, const int& nCircleSegments, std::vector<olc::vf2d>* outline);
+
+
+#endif // PRIMITIVES_H
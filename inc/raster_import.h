@@ -0,0 +1,42 @@
+#ifndef RASTER_IMPORT_H
+#define RASTER_IMPORT_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+#include "geometry_transaction.h"
+
+
+// Settings of the raster floorplan importer
+struct RasterImportOptions
+{
+	float fPixelSize = 1.0f;                // Size of one pixel in world units
+	int nThreshold = 128;                   // Opaque pixels with a luminance below this are walls
+	float fTolerance = 1.0f;                // Largest distance in pixels between a traced stroke and its segments
+	int nMinStrokeLength = 6;               // Strokes with a free end that are shorter than this many pixels are dropped
+	int nTileSize = 256;                    // Pixels per side of the tiles that are processed in parallel
+	int nThreads = 0;                       // Number of worker threads, 0 uses all hardware threads
+	olc::ResourcePack* pack = nullptr;      // Read the image from this pack instead of the file system
+};
+
+// Counts of an import
+struct RasterImportStats
+{
+	int nWidth = 0;
+	int nHeight = 0;
+	int64_t nWallPixels = 0;
+	int64_t nSkeletonPixels = 0;
+	int nStrokes = 0;
+	int nNodes = 0;
+	int nSegments = 0;
+};
+
+
+// Vectorize a scanned floorplan into wall segments. The image is thresholded, the wall strokes are thinned to a
+// one pixel wide skeleton with Zhang-Suen, the skeleton is traced into strokes between its end-points and
+// junctions, and every stroke is fitted with Douglas-Peucker. All stages run on tiles in parallel, thinning only
+// revisits the tiles next to the last changes. The image is placed with its top-left corner at the origin and
+// its y-axis flipped. Returns "false" if the image cannot be loaded.
+bool ImportRaster(const std::string& sPath, GeometryTransaction* transaction, const RasterImportOptions& options = RasterImportOptions(), RasterImportStats* stats = nullptr);
+
+
+#endif // RASTER_IMPORT_H
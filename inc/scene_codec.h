@@ -0,0 +1,46 @@
+#ifndef SCENE_CODEC_H
+#define SCENE_CODEC_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+
+
+// Compressed scene format, little-endian. Node positions are quantized to a grid of "fQuantum" around the
+// origin. Segments are stored as directed chains in the order of the Morton code of their first node, so
+// consecutive positions are close. The stream holds one varint vertex count per chain, followed by its
+// vertices. Every vertex is a zigzag varint token: a node that was seen before is "(back-reference << 1) | 1",
+// counted back from the newest node, a new node is "zigzag(dx) << 1" followed by zigzag(dy), relative to the
+// previous vertex of the stream. Unconnected nodes are chains of one vertex. The stream is padded with
+// "nSceneCodecPadding" zero bytes, so the decoder can always read whole words.
+// The node and segment order and the exact positions are not kept.
+const uint32_t nSceneCodecVersion = 1;
+const size_t nSceneCodecPadding = 8;
+
+struct CompressedSceneHeader
+{
+	char sMagic[8];              // "SC2DZSC" followed by a zero
+	uint32_t nVersion;
+	uint32_t nReserved;
+	double fOriginX;
+	double fOriginY;
+	double fQuantum;
+	uint64_t nNodes;
+	uint64_t nSegments;
+	uint64_t nChains;
+	uint64_t nStreamBytes;
+};
+static_assert(sizeof(CompressedSceneHeader) == 72, "CompressedSceneHeader must not contain padding");
+
+
+// Compress a scene. The quantum grows if the scene is too large for 31-bit grid coordinates.
+void EncodeScene(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const float& fQuantum, std::vector<uint8_t>* data);
+
+// Decompress a scene. Returns "false" if the data is not a valid compressed scene.
+bool DecodeScene(const uint8_t* pData, const size_t& nSize, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments);
+
+// Write and read a compressed scene file
+bool SaveCompressedScene(const std::string& sPath, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const float& fQuantum = 1e-3f);
+bool LoadCompressedScene(const std::string& sPath, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments);
+
+
+#endif // SCENE_CODEC_H
@@ -0,0 +1,96 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+
+
+// Binary scene format, little-endian. The file starts with the header, every array starts at a multiple of
+// "nSceneAlignment" bytes from the start of the file, so a memory-mapped file can be used in place.
+//   node x, node y       float[nNodes]
+//   segment start, end   uint32_t[nSegments]
+//   optional grid        uint32_t[nGridWidth * nGridHeight + 1] cell offsets, uint32_t[nGridEntries] segments
+const uint32_t nSceneVersion = 1;
+const uint64_t nSceneAlignment = 64;
+const uint32_t nSceneFlagGrid = 1;
+
+struct SceneHeader
+{
+	char sMagic[8];              // "SC2DSCN" followed by a zero
+	uint32_t nVersion;
+	uint32_t nFlags;
+	uint64_t nNodes;
+	uint64_t nSegments;
+	uint64_t nNodeXOffset;
+	uint64_t nNodeYOffset;
+	uint64_t nSegmentStartOffset;
+	uint64_t nSegmentEndOffset;
+
+	// Uniform grid of the segments, every segment is listed in all cells its bounding box overlaps
+	float fGridMinX;
+	float fGridMinY;
+	float fGridCellSize;
+	uint32_t nGridWidth;
+	uint32_t nGridHeight;
+	uint32_t nReserved;
+	uint64_t nGridEntries;
+	uint64_t nGridCellOffset;
+	uint64_t nGridEntryOffset;
+};
+static_assert(sizeof(SceneHeader) == 112, "SceneHeader must not contain padding");
+
+
+// Read-only view of a scene file. On POSIX systems the file is memory-mapped, nothing is copied when it is opened
+// and processes that open the same file share its pages. Opening reads the grid once to check its cell offsets and
+// segment indices, the node and segment arrays are not read until they are used.
+class SceneFile
+{
+public:
+	SceneFile() = default;
+	~SceneFile();
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator = (const SceneFile&) = delete;
+
+	// Map a scene file and check its header. Returns "false" if the file cannot be read or is not a valid scene.
+	bool Open(const std::string& sPath);
+
+	// Unmap the file
+	void Close();
+
+	bool IsOpen() const;
+
+	// Arrays inside the mapped file
+	uint64_t GetNodeCount() const;
+	uint64_t GetSegmentCount() const;
+	const float* GetNodeX() const;
+	const float* GetNodeY() const;
+	const uint32_t* GetSegmentStart() const;
+	const uint32_t* GetSegmentEnd() const;
+
+	// Check if the file has a grid of the segments
+	bool HasGrid() const;
+
+	// Segments in the grid cells that overlap a box, each of them once. Returns "false" if the file has no grid.
+	bool FindSegmentsInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<uint32_t>* foundSegments) const;
+
+private:
+	// Check that an array lies inside the file and is aligned
+	bool IsArrayValid(const uint64_t& nOffset, const uint64_t& nCount, const uint64_t& nElementSize) const;
+
+private:
+	const uint8_t* pData = nullptr;
+	uint64_t nSize = 0;
+	const SceneHeader* pHeader = nullptr;
+	std::vector<uint64_t> buffer; // File contents where memory mapping is not available
+	bool bMapped = false;
+};
+
+
+// Write a scene file, optionally with a grid of the segments. Returns "false" if the file cannot be written.
+bool SaveScene(const std::string& sPath, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const bool& bGrid = true);
+
+// Copy the geometry of an open scene file. Returns "false" if a segment refers to a node that does not exist.
+bool LoadScene(const SceneFile& file, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments);
+
+
+#endif // SCENE_FILE_H
@@ -0,0 +1,61 @@
+#ifndef SCENE_RELOAD_H
+#define SCENE_RELOAD_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+#include "geometry_transaction.h"
+
+
+// Watches one file for changes made by other programs. On Linux the directory of the file is watched with
+// inotify, which also catches editors that save to a temporary file and rename it over the original. Elsewhere
+// the modification time is compared on every poll.
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	~FileWatcher();
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator = (const FileWatcher&) = delete;
+
+	// Start watching a file, it does not need to exist yet. Returns "false" if its directory cannot be watched.
+	bool Watch(const std::string& sPath);
+
+	// Stop watching
+	void Stop();
+
+	bool IsWatching() const;
+
+	// Check for changes without blocking. Returns "true" once after the file was written and closed, replaced or
+	// created, however many events arrived since the last poll.
+	bool Poll();
+
+private:
+	std::string sFilePath;
+	std::string sFileName;
+	bool bWatching = false;
+	int nDescriptor = -1;
+	int nWatch = -1;
+	int64_t nLastWriteTime = 0; // Modification time where inotify is not available
+};
+
+
+// Counts of the changes applied by a diff
+struct SceneDiffStats
+{
+	int nAddedNodes = 0;
+	int nMovedNodes = 0;
+	int nDeletedNodes = 0;
+	int nAddedSegments = 0;
+	int nDeletedSegments = 0;
+};
+
+
+// Turn the geometry into a new version of it with as few edits as possible. Nodes are matched by their exact
+// position, an unmatched node that shares a matched neighbour with an unmatched node of the new version is moved
+// instead of replaced, and segments are matched by their node pair. Only the differences go through the
+// transaction, so unchanged nodes and segments keep their handles and the dirty region covers the changes only.
+void ApplySceneDiff(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	                GeometryStore* geometry, GeometryTransaction* transaction, SceneDiffStats* stats = nullptr);
+
+
+#endif // SCENE_RELOAD_H
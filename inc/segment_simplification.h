@@ -0,0 +1,41 @@
+#ifndef SEGMENT_SIMPLIFICATION_H
+#define SEGMENT_SIMPLIFICATION_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+
+
+// Simplified copy of the geometry, valid for a given tolerance
+struct GeometryLOD
+{
+	float fTolerance = 0.0f;
+	std::vector<olc::vf2d> nodes;
+	std::vector<std::array<int, 2>> segments;
+};
+
+// Douglas-Peucker simplification of an open polyline. Returns the indices of the kept points.
+std::vector<int> DouglasPeucker(const std::vector<olc::vf2d>& polyline, const float& fTolerance);
+
+// Merge chains of collinear segments that are split at nodes with exactly two connections. Every dropped node stays
+// within "fTolerance" of the segment that replaces it.
+void MergeCollinearSegments(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	                        const float& fTolerance, std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut);
+
+// Simplify chains of segments with Douglas-Peucker, the result stays within "fTolerance" of the input
+void SimplifySegments(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	                  const float& fTolerance, std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut);
+
+// Simplify the geometry so that the error is at most "fPixelTolerance" pixels at the zoom level "fScale"
+void SimplifySegmentsForZoom(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	                         const float& fScale, const float& fPixelTolerance,
+	                         std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut);
+
+// Build "nLevels" levels of detail, each one with twice the tolerance of the previous one
+std::vector<GeometryLOD> BuildLevelsOfDetail(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	                                         const float& fBaseTolerance, const int& nLevels);
+
+// Select the coarsest level of detail that stays within "fPixelTolerance" pixels at the zoom level "fScale"
+const GeometryLOD& SelectLevelOfDetail(const std::vector<GeometryLOD>& levels, const float& fScale, const float& fPixelTolerance);
+
+
+#endif // SEGMENT_SIMPLIFICATION_H
@@ -0,0 +1,34 @@
+#ifndef SVG_IMPORT_H
+#define SVG_IMPORT_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+#include "geometry_transaction.h"
+
+
+// Settings of the SVG importer
+struct SvgImportOptions
+{
+	float fTolerance = 0.25f;    // Largest distance between a curve and its flattened segments
+	float fWeldDistance = 1e-3f; // Vertices closer than this share one node
+	size_t nChunkSize = 1 << 20; // Bytes read from the file at once
+};
+
+// Counts of an import
+struct SvgImportStats
+{
+	int nElements = 0;
+	int nNodes = 0;
+	int nSegments = 0;
+};
+
+
+// Import the outlines of the "path", "line", "polyline", "polygon" and "rect" elements of an SVG file. The file
+// is streamed through a tokenizer in chunks and the elements are flattened as soon as their tag is complete, so
+// only the current tag is ever held in memory. Transforms of the elements and their groups are applied and the
+// y-axis is flipped. Vertices that coincide within the weld distance share one node, also across elements.
+// Returns "false" if the file cannot be read.
+bool ImportSvg(const std::string& sPath, GeometryTransaction* transaction, const SvgImportOptions& options = SvgImportOptions(), SvgImportStats* stats = nullptr);
+
+
+#endif // SVG_IMPORT_H
@@ -0,0 +1,156 @@
+#ifndef TILED_WORLD_H
+#define TILED_WORLD_H
+
+#include "olcPixelGameEngine.h"
+#include "custom_functions.h"
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+
+// Tiled world format, little-endian. The header is followed by the chunks and by the chunk table at
+// "nTableOffset". A chunk is self-contained, it lists every node its segments use, so segments that cross chunk
+// borders are stored in every chunk they pass through. Nodes and segments keep their global index as id.
+//   chunk               uint32_t nNodes, uint32_t nSegments
+//                       { uint32_t id, float x, float y }[nNodes]
+//                       { uint32_t id, uint32_t start, uint32_t end }[nSegments], start and end index the chunk nodes
+//   table               WorldChunkEntry[nChunks]
+const uint32_t nWorldVersion = 1;
+
+struct WorldHeader
+{
+	char sMagic[8];              // "SC2DWLD" followed by a zero
+	uint32_t nVersion;
+	float fChunkSize;
+	uint64_t nChunks;
+	uint64_t nTableOffset;
+};
+static_assert(sizeof(WorldHeader) == 32, "WorldHeader must not contain padding");
+
+struct WorldChunkEntry
+{
+	int32_t nX;
+	int32_t nY;
+	uint64_t nOffset;
+	uint32_t nNodes;
+	uint32_t nSegments;
+};
+static_assert(sizeof(WorldChunkEntry) == 24, "WorldChunkEntry must not contain padding");
+
+// Geometry of one loaded chunk
+struct WorldChunk
+{
+	int32_t nEntry = -1;
+	std::vector<uint32_t> nodeIds;
+	std::vector<olc::vf2d> nodes;
+	std::vector<uint32_t> segmentIds;
+	std::vector<std::array<int, 2>> segments;
+};
+
+
+// World that is split into square chunks on disk. Chunks that are requested are read by a background thread,
+// chunks that were not requested for a while are dropped when the loaded chunks exceed the memory budget.
+// Requests and all queries are made from one thread, the loader thread only reads the file.
+class TiledWorld
+{
+public:
+	TiledWorld() = default;
+	~TiledWorld();
+	TiledWorld(const TiledWorld&) = delete;
+	TiledWorld& operator = (const TiledWorld&) = delete;
+
+	// Read the chunk table and start the loader thread. Returns "false" if the file is not a valid world.
+	bool Open(const std::string& sPath);
+
+	// Stop the loader thread and drop all chunks
+	void Close();
+
+	bool IsOpen() const;
+	float GetChunkSize() const;
+
+	// Maximum size of the loaded chunks in bytes, chunks requested since the last "Update" are never dropped
+	void SetMemoryBudget(const size_t& nBytes);
+
+	// Request the chunks that overlap a box grown by "fMargin" on every side, the closest chunks load first.
+	// Can be called for several regions, e.g. the screen and the regions of queries.
+	void RequestRegion(const olc::vf2d& vMin, const olc::vf2d& vMax, const float& fMargin);
+
+	// Take the chunks read by the loader thread, drop the least recently requested ones above the budget and
+	// pass the requests of this frame to the loader thread. Requests that were not repeated are cancelled.
+	void Update();
+
+	// Check whether all chunks that overlap a box are loaded
+	bool IsRegionLoaded(const olc::vf2d& vMin, const olc::vf2d& vMax) const;
+
+	// Loaded chunks that overlap a box
+	void FindLoadedChunks(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<const WorldChunk*>* chunks) const;
+
+	// Merge the loaded geometry that overlaps a box into one node and segment list, nodes and segments that are
+	// stored in several chunks appear once
+	void GatherRegion(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments) const;
+
+	// Find the closest loaded node within "fMaxDistance". Returns its id or -1.
+	int64_t FindNearestNode(const olc::vf2d& vPoint, const float& fMaxDistance, olc::vf2d* vPosition) const;
+
+	// Statistics
+	int GetLoadedChunkCount() const;
+	size_t GetLoadedBytes() const;
+	int GetPendingChunkCount() const;
+
+private:
+	// Chunk coordinates and the table key of a chunk
+	int32_t ChunkCoordinate(const float& fValue) const;
+	static uint64_t ChunkKey(const int32_t& nX, const int32_t& nY);
+
+	// Read chunks until the world is closed
+	void LoaderThread();
+
+	// Bytes a loaded chunk takes
+	static size_t ChunkBytes(const WorldChunk& chunk);
+
+	// Drop a loaded chunk
+	void Evict(const int32_t& nEntry);
+
+private:
+	// Chunk table, not changed while the loader thread runs
+	std::string sPath;
+	float fChunkSize = 1.0f;
+	float fInverseChunkSize = 1.0f;
+	std::vector<WorldChunkEntry> entries;
+	std::unordered_map<uint64_t, int32_t> entryByKey;
+
+	// Loaded chunks, the front of the list is the most recently requested chunk
+	struct ResidentChunk
+	{
+		std::unique_ptr<WorldChunk> chunk;
+		std::list<int32_t>::iterator itRecent;
+		uint64_t nLastFrame = 0;
+	};
+	std::unordered_map<int32_t, ResidentChunk> resident;
+	std::list<int32_t> recent;
+	size_t nLoadedBytes = 0;
+	size_t nMemoryBudget = size_t(256) << 20;
+	uint64_t nFrame = 1;
+
+	// Chunks requested this frame with their squared distance to the center of their region
+	std::vector<std::pair<float, int32_t>> requested;
+
+	// Shared with the loader thread
+	mutable std::mutex mutex;
+	std::condition_variable wakeLoader;
+	std::vector<int32_t> queue;         // Chunks to read, the next one at the back
+	int32_t nLoading = -1;              // Chunk the loader thread is reading
+	std::vector<std::unique_ptr<WorldChunk>> loaded;
+	bool bStop = false;
+	std::thread loader;
+};
+
+
+// Split geometry into square chunks and write it as a tiled world. Chunks are built one at a time from records
+// sorted by chunk, records that do not fit in memory are sorted in runs in the file "sPath" + ".tmp".
+bool SaveTiledWorld(const std::string& sPath, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const float& fChunkSize);
+
+
+#endif // TILED_WORLD_H
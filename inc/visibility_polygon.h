@@ -3,8 +3,18 @@
 
 #include "olcPixelGameEngine.h"
 #include "custom_functions.h"
+#include "prefabs.h"
+#include "primitives.h"
 
+// Flag the nodes that can cast a shadow boundary as seen from the observer. These are open end-points and nodes
+// whose connected segments all lie on the same side of the ray through the node. Unconnected nodes are never flagged.
+std::vector<bool> FindSilhouetteNodes(const olc::vf2d& vObserver, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments);
+
+// Compute the polygon visible from "vMP_W" within the screen bounding box. Optional prefab instances also block
+// the view, they are tested in prefab space and only the instances inside the screen add rays. Optional primitives
+// are culled with their bounding box against the screen and against every ray before their outline is tested.
 std::vector<olc::vf2d> VisibilityPolygon(const olc::vf2d& vMP_W, const olc::vf2d& vTL_W, const olc::vf2d& vTR_W, const olc::vf2d& vBR_W, const olc::vf2d& vBL_W,
-	const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const std::vector<olc::vf2d>& intersections);
+	const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const std::vector<olc::vf2d>& intersections,
+	const PrefabScene* prefabs = nullptr, const std::vector<Primitive>* primitives = nullptr);
 
 #endif // VISIBILITY_POLYGON_H
\ No newline at end of file
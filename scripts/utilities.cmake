@@ -13,6 +13,18 @@ function(link target)
 endfunction()
 
 
+# Link a target binary that never opens a window to all specified libraries
+function(link_headless target)
+    if (TARGET ${target})
+        list(REMOVE_ITEM ARGV ${target})
+        target_link_libraries(${target} PUBLIC ${ARGV} PRIVATE -lpthread -lstdc++fs)
+        set_target_properties(${target} PROPERTIES INSTALL_RPATH_USE_LINK_PATH TRUE)
+    else()
+        message(SEND_ERROR "${target} is not linked because it is not a target!")
+    endif()
+endfunction()
+
+
 # Copy a target binary to a destination directory
 function(build_time_copy_target target destination)
     set_target_properties(${target} PROPERTIES RUNTIME_OUTPUT_DIRECTORY "${destination}")
@@ -0,0 +1,299 @@
+#include "olcPixelGameEngine.h"
+#include "aabb_tree.h"
+
+
+// Perimeter of a box, the cost measure used to choose where leaves are inserted
+static float Perimeter(const olc::vf2d& vMin, const olc::vf2d& vMax)
+{
+	return 2.0f * ((vMax.x - vMin.x) + (vMax.y - vMin.y));
+}
+
+
+AABBTree::AABBTree(const float& fMargin)
+{
+	this->fMargin = fMargin;
+}
+
+// Node allocation from the free list
+int32_t AABBTree::AllocateNode()
+{
+	if (nFreeNode == -1)
+	{
+		treeNodes.push_back(AABBTreeNode());
+		return int32_t(treeNodes.size()) - 1;
+	}
+	int32_t n = nFreeNode;
+	nFreeNode = treeNodes[n].nParent;
+	treeNodes[n] = AABBTreeNode();
+	return n;
+}
+
+// Return a node to the free list
+void AABBTree::FreeNode(const int32_t& n)
+{
+	treeNodes[n].nParent = nFreeNode;
+	treeNodes[n].nHeight = -1;
+	nFreeNode = n;
+}
+
+// Insert a box and return its proxy
+int32_t AABBTree::Insert(const olc::vf2d& vMin, const olc::vf2d& vMax, const int32_t& nUserData)
+{
+	int32_t nProxy = AllocateNode();
+	treeNodes[nProxy].vMin = vMin - olc::vf2d{ fMargin, fMargin };
+	treeNodes[nProxy].vMax = vMax + olc::vf2d{ fMargin, fMargin };
+	treeNodes[nProxy].nUserData = nUserData;
+	treeNodes[nProxy].nHeight = 0;
+	InsertLeaf(nProxy);
+	return nProxy;
+}
+
+// Remove a proxy
+void AABBTree::Remove(const int32_t& nProxy)
+{
+	RemoveLeaf(nProxy);
+	FreeNode(nProxy);
+}
+
+// Update the box of a proxy, nothing changes while the box stays inside the fat box
+bool AABBTree::Update(const int32_t& nProxy, const olc::vf2d& vMin, const olc::vf2d& vMax)
+{
+	AABBTreeNode& node = treeNodes[nProxy];
+	if (vMin.x >= node.vMin.x && vMin.y >= node.vMin.y && vMax.x <= node.vMax.x && vMax.y <= node.vMax.y)
+	{
+		return false;
+	}
+	RemoveLeaf(nProxy);
+	node.vMin = vMin - olc::vf2d{ fMargin, fMargin };
+	node.vMax = vMax + olc::vf2d{ fMargin, fMargin };
+	InsertLeaf(nProxy);
+	return true;
+}
+
+// Remove all proxies
+void AABBTree::Clear()
+{
+	treeNodes.clear();
+	nRoot = -1;
+	nFreeNode = -1;
+}
+
+// User data of a proxy
+int32_t AABBTree::GetUserData(const int32_t& nProxy) const
+{
+	return treeNodes[nProxy].nUserData;
+}
+
+// Fat box of a proxy
+const AABBTreeNode& AABBTree::GetNode(const int32_t& nProxy) const
+{
+	return treeNodes[nProxy];
+}
+
+// Squared distance from a point to the box of a node
+float AABBTree::BoxDistanceSquared(const int32_t& n, const olc::vf2d& vPoint) const
+{
+	const AABBTreeNode& node = treeNodes[n];
+	float dx = std::max(std::max(node.vMin.x - vPoint.x, vPoint.x - node.vMax.x), 0.0f);
+	float dy = std::max(std::max(node.vMin.y - vPoint.y, vPoint.y - node.vMax.y), 0.0f);
+	return dx * dx + dy * dy;
+}
+
+// Check if a ray segment hits the box of a node (slab test)
+bool AABBTree::IsBoxHitByRay(const int32_t& n, const olc::vf2d& vOrigin, const olc::vf2d& vDirection, const float& fMaxT) const
+{
+	const AABBTreeNode& node = treeNodes[n];
+	float fEnter = 0.0f;
+	float fExit = fMaxT;
+	for (int k = 0; k < 2; k++)
+	{
+		float fOrigin = k == 0 ? vOrigin.x : vOrigin.y;
+		float fDirection = k == 0 ? vDirection.x : vDirection.y;
+		float fMin = k == 0 ? node.vMin.x : node.vMin.y;
+		float fMax = k == 0 ? node.vMax.x : node.vMax.y;
+		if (std::abs(fDirection) < 1e-12f)
+		{
+			if (fOrigin < fMin || fOrigin > fMax) { return false; }
+			continue;
+		}
+		float t1 = (fMin - fOrigin) / fDirection;
+		float t2 = (fMax - fOrigin) / fDirection;
+		fEnter = std::max(fEnter, std::min(t1, t2));
+		fExit = std::min(fExit, std::max(t1, t2));
+		if (fEnter > fExit) { return false; }
+	}
+	return true;
+}
+
+// Find the user data of all proxies that overlap a box
+void AABBTree::QueryBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<int32_t>* userData) const
+{
+	userData->clear();
+	if (nRoot == -1) { return; }
+	stack.clear();
+	stack.push_back(nRoot);
+	while (!stack.empty())
+	{
+		const AABBTreeNode& node = treeNodes[stack.back()];
+		stack.pop_back();
+		if (node.vMax.x < vMin.x || node.vMax.y < vMin.y || node.vMin.x > vMax.x || node.vMin.y > vMax.y) { continue; }
+		if (node.nChild[0] == -1)
+		{
+			userData->push_back(node.nUserData);
+		}
+		else
+		{
+			stack.push_back(node.nChild[0]);
+			stack.push_back(node.nChild[1]);
+		}
+	}
+}
+
+// Recompute the box and height of an internal node from its children
+void AABBTree::Refit(const int32_t& n)
+{
+	AABBTreeNode& node = treeNodes[n];
+	const AABBTreeNode& child1 = treeNodes[node.nChild[0]];
+	const AABBTreeNode& child2 = treeNodes[node.nChild[1]];
+	node.vMin = child1.vMin.min(child2.vMin);
+	node.vMax = child1.vMax.max(child2.vMax);
+	node.nHeight = 1 + std::max(child1.nHeight, child2.nHeight);
+}
+
+// Insert a leaf next to the sibling that increases the total perimeter the least
+void AABBTree::InsertLeaf(const int32_t& nLeaf)
+{
+	if (nRoot == -1)
+	{
+		nRoot = nLeaf;
+		treeNodes[nLeaf].nParent = -1;
+		return;
+	}
+
+	// Descend towards the cheapest sibling
+	olc::vf2d vLeafMin = treeNodes[nLeaf].vMin;
+	olc::vf2d vLeafMax = treeNodes[nLeaf].vMax;
+	int32_t n = nRoot;
+	while (treeNodes[n].nChild[0] != -1)
+	{
+		const AABBTreeNode& node = treeNodes[n];
+		float fArea = Perimeter(node.vMin, node.vMax);
+		float fCombinedArea = Perimeter(node.vMin.min(vLeafMin), node.vMax.max(vLeafMax));
+
+		// Cost of making a new parent for this node and the leaf, and the cost pushed down to the children
+		float fCost = 2.0f * fCombinedArea;
+		float fInheritanceCost = 2.0f * (fCombinedArea - fArea);
+
+		float fChildCost[2];
+		for (int k = 0; k < 2; k++)
+		{
+			const AABBTreeNode& child = treeNodes[node.nChild[k]];
+			float fChildArea = Perimeter(child.vMin.min(vLeafMin), child.vMax.max(vLeafMax));
+			if (child.nChild[0] != -1) { fChildArea -= Perimeter(child.vMin, child.vMax); }
+			fChildCost[k] = fChildArea + fInheritanceCost;
+		}
+
+		if (fCost < fChildCost[0] && fCost < fChildCost[1]) { break; }
+		n = fChildCost[0] < fChildCost[1] ? node.nChild[0] : node.nChild[1];
+	}
+
+	// Create a new parent for the sibling and the leaf
+	int32_t nSibling = n;
+	int32_t nNewParent = AllocateNode();
+	int32_t nOldParent = treeNodes[nSibling].nParent;
+	treeNodes[nNewParent].nParent = nOldParent;
+	treeNodes[nNewParent].nChild[0] = nSibling;
+	treeNodes[nNewParent].nChild[1] = nLeaf;
+	treeNodes[nSibling].nParent = nNewParent;
+	treeNodes[nLeaf].nParent = nNewParent;
+	if (nOldParent == -1)
+	{
+		nRoot = nNewParent;
+	}
+	else
+	{
+		int k = treeNodes[nOldParent].nChild[0] == nSibling ? 0 : 1;
+		treeNodes[nOldParent].nChild[k] = nNewParent;
+	}
+
+	// Walk back up and restore the boxes and the balance
+	for (n = nNewParent; n != -1; n = treeNodes[n].nParent)
+	{
+		n = Balance(n);
+		Refit(n);
+	}
+}
+
+// Remove a leaf and replace its parent with its sibling
+void AABBTree::RemoveLeaf(const int32_t& nLeaf)
+{
+	if (nLeaf == nRoot)
+	{
+		nRoot = -1;
+		return;
+	}
+
+	int32_t nParent = treeNodes[nLeaf].nParent;
+	int32_t nGrandParent = treeNodes[nParent].nParent;
+	int32_t nSibling = treeNodes[nParent].nChild[0] == nLeaf ? treeNodes[nParent].nChild[1] : treeNodes[nParent].nChild[0];
+	FreeNode(nParent);
+
+	if (nGrandParent == -1)
+	{
+		nRoot = nSibling;
+		treeNodes[nSibling].nParent = -1;
+		return;
+	}
+
+	int k = treeNodes[nGrandParent].nChild[0] == nParent ? 0 : 1;
+	treeNodes[nGrandParent].nChild[k] = nSibling;
+	treeNodes[nSibling].nParent = nGrandParent;
+	for (int32_t n = nGrandParent; n != -1; n = treeNodes[n].nParent)
+	{
+		n = Balance(n);
+		Refit(n);
+	}
+}
+
+// Rotate the subtree at "n" if the heights of its children differ by more than one
+int32_t AABBTree::Balance(const int32_t& n)
+{
+	int32_t iA = n;
+	if (treeNodes[iA].nChild[0] == -1 || treeNodes[iA].nHeight < 2) { return iA; }
+
+	int32_t iB = treeNodes[iA].nChild[0];
+	int32_t iC = treeNodes[iA].nChild[1];
+	int nBalance = treeNodes[iC].nHeight - treeNodes[iB].nHeight;
+	if (nBalance >= -1 && nBalance <= 1) { return iA; }
+
+	// The higher child moves up and takes the place of "A"
+	int kUp = nBalance > 1 ? 1 : 0;
+	int32_t iUp = treeNodes[iA].nChild[kUp];
+	int32_t iF = treeNodes[iUp].nChild[0];
+	int32_t iG = treeNodes[iUp].nChild[1];
+
+	treeNodes[iUp].nChild[0] = iA;
+	treeNodes[iUp].nParent = treeNodes[iA].nParent;
+	treeNodes[iA].nParent = iUp;
+	if (treeNodes[iUp].nParent == -1)
+	{
+		nRoot = iUp;
+	}
+	else
+	{
+		int32_t iParent = treeNodes[iUp].nParent;
+		int k = treeNodes[iParent].nChild[0] == iA ? 0 : 1;
+		treeNodes[iParent].nChild[k] = iUp;
+	}
+
+	// The higher grandchild stays with the node that moved up, the other one goes to "A"
+	int32_t iKeep = treeNodes[iF].nHeight > treeNodes[iG].nHeight ? iF : iG;
+	int32_t iGive = iKeep == iF ? iG : iF;
+	treeNodes[iUp].nChild[1] = iKeep;
+	treeNodes[iA].nChild[kUp] = iGive;
+	treeNodes[iGive].nParent = iA;
+
+	Refit(iA);
+	Refit(iUp);
+	return iUp;
+}
@@ -0,0 +1,413 @@
+#include "olcPixelGameEngine.h"
+#include "convex_decomposition.h"
+
+#include <unordered_map>
+
+
+// Twice the signed area of the triangle, positive if the triangle is counter-clockwise
+static float Orientation(const olc::vf2d& vA, const olc::vf2d& vB, const olc::vf2d& vC)
+{
+	return (vB - vA).cross(vC - vA);
+}
+
+// Check if the point lies inside or on the boundary of a counter-clockwise triangle
+static bool IsPointInTriangle(const olc::vf2d& vPoint, const olc::vf2d& vA, const olc::vf2d& vB, const olc::vf2d& vC)
+{
+	return Orientation(vA, vB, vPoint) >= 0.0f && Orientation(vB, vC, vPoint) >= 0.0f && Orientation(vC, vA, vPoint) >= 0.0f;
+}
+
+// Check if the direction "vDirection" lies inside the interior wedge of a counter-clockwise polygon at "vP"
+static bool IsDirectionInWedge(const olc::vf2d& vPrev, const olc::vf2d& vP, const olc::vf2d& vNext, const olc::vf2d& vDirection)
+{
+	const float f2Pi = 6.28318530718f;
+	float fStart = std::atan2(vNext.y - vP.y, vNext.x - vP.x);
+	float fWedge = std::atan2(vPrev.y - vP.y, vPrev.x - vP.x) - fStart;
+	float fAngle = std::atan2(vDirection.y, vDirection.x) - fStart;
+	if (fWedge <= 0.0f) { fWedge += f2Pi; }
+	if (fAngle < 0.0f) { fAngle += f2Pi; }
+	return fAngle <= fWedge;
+}
+
+// Check if the segment properly crosses any edge of the closed polygon
+static bool DoesSegmentCrossPolygon(const olc::vf2d& vStart, const olc::vf2d& vEnd, const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon)
+{
+	olc::vf2d vIntersectionPoint;
+	for (int i = 0, j = int(polygon.size()) - 1; i < polygon.size(); j = i++)
+	{
+		if (SegmentToSegmentIntersection(vStart, vEnd, nodes[polygon[j]], nodes[polygon[i]], &vIntersectionPoint))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Cut the holes open and connect them to the outer boundary with a bridge, resulting in a single counter-clockwise polygon.
+// Returns "false" if a hole cannot be connected without crossing a boundary.
+static bool BridgeHoles(const std::vector<olc::vf2d>& nodes, std::vector<int> outer, std::vector<std::vector<int>> holes, std::vector<int>* polygon)
+{
+	// Connect the holes from right to left, so that earlier bridges do not block later ones
+	auto rightmost = [&](const std::vector<int>& hole)
+	{
+		int i_max = 0;
+		for (int i = 1; i < hole.size(); i++)
+		{
+			if (nodes[hole[i]].x > nodes[hole[i_max]].x) { i_max = i; }
+		}
+		return i_max;
+	};
+	std::sort(holes.begin(), holes.end(), [&](const std::vector<int>& a, const std::vector<int>& b)
+		{ return nodes[a[rightmost(a)]].x > nodes[b[rightmost(b)]].x; });
+
+	for (int h = 0; h < holes.size(); h++)
+	{
+		const std::vector<int>& hole = holes[h];
+		int i_hole = rightmost(hole);
+		const olc::vf2d& vM = nodes[hole[i_hole]];
+
+		// Closest outer vertex that can be connected without crossing any boundary
+		int i_bridge = -1;
+		float fMinDistance = std::numeric_limits<float>::max();
+		for (int i = 0; i < outer.size(); i++)
+		{
+			const olc::vf2d& vP = nodes[outer[i]];
+			float fDistance = EuclideanDistanceSquared(vM, vP);
+			if (fDistance >= fMinDistance) { continue; }
+
+			const olc::vf2d& vPrev = nodes[outer[(i + outer.size() - 1) % outer.size()]];
+			const olc::vf2d& vNext = nodes[outer[(i + 1) % outer.size()]];
+			if (!IsDirectionInWedge(vPrev, vP, vNext, vM - vP)) { continue; }
+			if (DoesSegmentCrossPolygon(vM, vP, nodes, outer)) { continue; }
+
+			bool bBlocked = false;
+			for (int k = h; k < holes.size() && !bBlocked; k++)
+			{
+				bBlocked = DoesSegmentCrossPolygon(vM, vP, nodes, holes[k]);
+			}
+			if (bBlocked) { continue; }
+
+			fMinDistance = fDistance;
+			i_bridge = i;
+		}
+		if (i_bridge == -1) { return false; }
+
+		// Insert the hole after the bridge vertex: P, M, ..., M, P
+		std::vector<int> merged;
+		merged.reserve(outer.size() + hole.size() + 2);
+		merged.insert(merged.end(), outer.begin(), outer.begin() + i_bridge + 1);
+		for (int i = 0; i <= hole.size(); i++)
+		{
+			merged.push_back(hole[(i_hole + i) % hole.size()]);
+		}
+		merged.insert(merged.end(), outer.begin() + i_bridge, outer.end());
+		outer = std::move(merged);
+	}
+	*polygon = std::move(outer);
+	return true;
+}
+
+
+// Triangulate a counter-clockwise polygon by ear clipping. Node indices may repeat along hole bridges.
+std::vector<std::array<int, 3>> TriangulatePolygon(const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon)
+{
+	std::vector<std::array<int, 3>> triangles;
+	int n = int(polygon.size());
+	if (n < 3) { return triangles; }
+	triangles.reserve(n - 2);
+
+	// Doubly linked list over the polygon vertices
+	std::vector<int> prev(n), next(n);
+	for (int i = 0; i < n; i++)
+	{
+		prev[i] = (i + n - 1) % n;
+		next[i] = (i + 1) % n;
+	}
+	auto position = [&](int i) -> const olc::vf2d& { return nodes[polygon[i]]; };
+
+	// An ear is convex and has no other polygon vertex inside
+	auto isEar = [&](int i)
+	{
+		const olc::vf2d& vA = position(prev[i]);
+		const olc::vf2d& vB = position(i);
+		const olc::vf2d& vC = position(next[i]);
+		if (Orientation(vA, vB, vC) <= 0.0f) { return false; }
+		for (int j = next[next[i]]; j != prev[i]; j = next[j])
+		{
+			const olc::vf2d& vP = position(j);
+			if (vP == vA || vP == vB || vP == vC) { continue; }
+			if (Orientation(position(prev[j]), vP, position(next[j])) > 0.0f) { continue; } // Only reflex vertices can be inside
+			if (IsPointInTriangle(vP, vA, vB, vC)) { return false; }
+		}
+		return true;
+	};
+
+	int i = 0;
+	int nRemaining = n;
+	int nAttempts = 0;
+	while (nRemaining > 3)
+	{
+		bool bClip = isEar(i);
+
+		// No ear left due to collinear or numerically degenerate vertices, clip the flattest vertex
+		if (!bClip && nAttempts > nRemaining)
+		{
+			float fMinArea = std::numeric_limits<float>::max();
+			for (int j = next[i], k = 0; k < nRemaining; j = next[j], k++)
+			{
+				float fArea = std::abs(Orientation(position(prev[j]), position(j), position(next[j])));
+				if (fArea < fMinArea) { fMinArea = fArea; i = j; }
+			}
+			bClip = true;
+		}
+		if (!bClip)
+		{
+			i = next[i];
+			nAttempts += 1;
+			continue;
+		}
+
+		// Zero-area triangles are dropped
+		if (Orientation(position(prev[i]), position(i), position(next[i])) > 0.0f)
+		{
+			triangles.push_back({ polygon[prev[i]], polygon[i], polygon[next[i]] });
+		}
+		next[prev[i]] = next[i];
+		prev[next[i]] = prev[i];
+		i = prev[i];
+		nRemaining -= 1;
+		nAttempts = 0;
+	}
+	if (Orientation(position(prev[i]), position(i), position(next[i])) > 0.0f)
+	{
+		triangles.push_back({ polygon[prev[i]], polygon[i], polygon[next[i]] });
+	}
+	return triangles;
+}
+
+// Decompose every solid obstacle (including its holes) into convex pieces with Hertel-Mehlhorn
+std::vector<ConvexPiece> DecomposeObstacles(const std::vector<olc::vf2d>& nodes, const std::vector<Obstacle>& obstacles, std::vector<int>* failedObstacles)
+{
+	if (failedObstacles) { failedObstacles->clear(); }
+	std::vector<ConvexPiece> pieces;
+	for (int o = 0; o < obstacles.size(); o++)
+	{
+		if (!obstacles[o].bSolid) { continue; }
+
+		// Counter-clockwise outer boundary with clockwise holes
+		std::vector<int> outer = obstacles[o].nodes;
+		if (!obstacles[o].bCounterClockwise) { std::reverse(outer.begin(), outer.end()); }
+		std::vector<std::vector<int>> holes;
+		for (int h = 0; h < obstacles.size(); h++)
+		{
+			if (obstacles[h].nParent != o) { continue; }
+			holes.push_back(obstacles[h].nodes);
+			if (obstacles[h].bCounterClockwise) { std::reverse(holes.back().begin(), holes.back().end()); }
+		}
+		// Without the bridge the hole would be filled, the obstacle is left out instead
+		std::vector<int> polygon;
+		if (!BridgeHoles(nodes, std::move(outer), std::move(holes), &polygon))
+		{
+			if (failedObstacles) { failedObstacles->push_back(o); }
+			continue;
+		}
+
+		// Start from a triangulation
+		std::vector<std::array<int, 3>> triangles = TriangulatePolygon(nodes, polygon);
+		std::vector<std::vector<int>> parts(triangles.size());
+		std::vector<bool> alive(triangles.size(), true);
+		std::unordered_map<int64_t, int> edgeOwner;
+		auto key = [](int a, int b) { return (int64_t(a) << 32) | int64_t(uint32_t(b)); };
+		for (int t = 0; t < triangles.size(); t++)
+		{
+			parts[t] = { triangles[t][0], triangles[t][1], triangles[t][2] };
+			for (int k = 0; k < 3; k++)
+			{
+				edgeOwner[key(triangles[t][k], triangles[t][(k + 1) % 3])] = t;
+			}
+		}
+
+		// Remove diagonals whose removal keeps both end-points convex
+		for (int t = 0; t < triangles.size(); t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				int u = triangles[t][k];
+				int v = triangles[t][(k + 1) % 3];
+				auto itP = edgeOwner.find(key(u, v));
+				auto itQ = edgeOwner.find(key(v, u));
+				if (u > v || itP == edgeOwner.end() || itQ == edgeOwner.end()) { continue; }
+				int p = itP->second;
+				int q = itQ->second;
+				if (p == q || !alive[p] || !alive[q]) { continue; }
+
+				// P = [..., u, v, ...] and Q = [..., v, u, ...]
+				const std::vector<int>& P = parts[p];
+				const std::vector<int>& Q = parts[q];
+				int iu_P = int(std::find(P.begin(), P.end(), u) - P.begin());
+				int iv_P = (iu_P + 1) % P.size();
+				int iv_Q = int(std::find(Q.begin(), Q.end(), v) - Q.begin());
+				int iu_Q = (iv_Q + 1) % Q.size();
+				if (P[iv_P] != v || Q[iu_Q] != u) { continue; }
+
+				int u_prev = P[(iu_P + P.size() - 1) % P.size()];
+				int u_next = Q[(iu_Q + 1) % Q.size()];
+				int v_prev = Q[(iv_Q + Q.size() - 1) % Q.size()];
+				int v_next = P[(iv_P + 1) % P.size()];
+				if (Orientation(nodes[u_prev], nodes[u], nodes[u_next]) < 0.0f) { continue; }
+				if (Orientation(nodes[v_prev], nodes[v], nodes[v_next]) < 0.0f) { continue; }
+
+				// Merged = [v, ..., u] from P followed by the rest of Q
+				std::vector<int> merged;
+				merged.reserve(P.size() + Q.size() - 2);
+				for (int j = 0; j < P.size(); j++) { merged.push_back(P[(iv_P + j) % P.size()]); }
+				for (int j = 1; j + 1 < Q.size(); j++) { merged.push_back(Q[(iu_Q + j) % Q.size()]); }
+
+				edgeOwner.erase(key(u, v));
+				edgeOwner.erase(key(v, u));
+				for (int j = 0; j < Q.size(); j++)
+				{
+					auto it = edgeOwner.find(key(Q[j], Q[(j + 1) % Q.size()]));
+					if (it != edgeOwner.end() && it->second == q) { it->second = p; }
+				}
+				parts[p] = std::move(merged);
+				parts[q].clear();
+				alive[q] = false;
+			}
+		}
+
+		// Store the pieces with their bounding boxes
+		for (int t = 0; t < parts.size(); t++)
+		{
+			if (!alive[t]) { continue; }
+			ConvexPiece piece;
+			piece.nodes = std::move(parts[t]);
+			piece.nObstacle = o;
+			piece.vMin = nodes[piece.nodes[0]];
+			piece.vMax = nodes[piece.nodes[0]];
+			for (int j = 1; j < piece.nodes.size(); j++)
+			{
+				piece.vMin = piece.vMin.min(nodes[piece.nodes[j]]);
+				piece.vMax = piece.vMax.max(nodes[piece.nodes[j]]);
+			}
+			pieces.push_back(std::move(piece));
+		}
+	}
+	return pieces;
+}
+
+// Check if the point is inside the convex piece, the bounding box is checked first
+bool IsPointInConvexPiece(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece)
+{
+	if (vPoint.x < piece.vMin.x || vPoint.y < piece.vMin.y || vPoint.x > piece.vMax.x || vPoint.y > piece.vMax.y)
+	{
+		return false;
+	}
+	for (int i = 0, j = int(piece.nodes.size()) - 1; i < piece.nodes.size(); j = i++)
+	{
+		if (Orientation(nodes[piece.nodes[j]], nodes[piece.nodes[i]], vPoint) < 0.0f) { return false; }
+	}
+	return true;
+}
+
+// Find the convex piece that contains the point. Returns -1 if the point is not inside any piece.
+int FindConvexPieceContainingPoint(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<ConvexPiece>& pieces)
+{
+	for (int i = 0; i < pieces.size(); i++)
+	{
+		if (IsPointInConvexPiece(vPoint, nodes, pieces[i])) { return i; }
+	}
+	return -1;
+}
+
+// Project a convex piece onto an axis
+static void ProjectConvexPiece(const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece, const olc::vf2d& vAxis, float* fMin, float* fMax)
+{
+	*fMin = std::numeric_limits<float>::max();
+	*fMax = -std::numeric_limits<float>::max();
+	for (int i = 0; i < piece.nodes.size(); i++)
+	{
+		float fProjection = vAxis.dot(nodes[piece.nodes[i]]);
+		*fMin = std::min(*fMin, fProjection);
+		*fMax = std::max(*fMax, fProjection);
+	}
+}
+
+// Separating axis test between two convex pieces
+bool DoConvexPiecesOverlap(const std::vector<olc::vf2d>& nodes, const ConvexPiece& pieceA, const ConvexPiece& pieceB)
+{
+	// Bounding boxes first
+	if (pieceA.vMax.x < pieceB.vMin.x || pieceB.vMax.x < pieceA.vMin.x ||
+		pieceA.vMax.y < pieceB.vMin.y || pieceB.vMax.y < pieceA.vMin.y)
+	{
+		return false;
+	}
+	// Edge normals of both pieces are the candidate separating axes
+	const ConvexPiece* pieces[2] = { &pieceA, &pieceB };
+	for (int p = 0; p < 2; p++)
+	{
+		const ConvexPiece& piece = *pieces[p];
+		for (int i = 0, j = int(piece.nodes.size()) - 1; i < piece.nodes.size(); j = i++)
+		{
+			olc::vf2d vAxis = (nodes[piece.nodes[i]] - nodes[piece.nodes[j]]).perp();
+			float fMinA, fMaxA, fMinB, fMaxB;
+			ProjectConvexPiece(nodes, pieceA, vAxis, &fMinA, &fMaxA);
+			ProjectConvexPiece(nodes, pieceB, vAxis, &fMinB, &fMaxB);
+			if (fMaxA < fMinB || fMaxB < fMinA) { return false; }
+		}
+	}
+	return true;
+}
+
+// Separating axis test between a circle and a convex piece
+bool DoesCircleOverlapConvexPiece(const olc::vf2d& vCenter, const float& fRadius, const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece)
+{
+	// Bounding boxes first
+	if (vCenter.x + fRadius < piece.vMin.x || vCenter.x - fRadius > piece.vMax.x ||
+		vCenter.y + fRadius < piece.vMin.y || vCenter.y - fRadius > piece.vMax.y)
+	{
+		return false;
+	}
+	// Edge normals and the axis towards the closest vertex are the candidate separating axes
+	int i_closest = 0;
+	for (int i = 1; i < piece.nodes.size(); i++)
+	{
+		if (EuclideanDistanceSquared(vCenter, nodes[piece.nodes[i]]) < EuclideanDistanceSquared(vCenter, nodes[piece.nodes[i_closest]]))
+		{
+			i_closest = i;
+		}
+	}
+	for (int i = 0, j = int(piece.nodes.size()) - 1; i <= piece.nodes.size(); j = i++)
+	{
+		olc::vf2d vAxis = (i < piece.nodes.size()) ? (nodes[piece.nodes[i]] - nodes[piece.nodes[j]]).perp() : nodes[piece.nodes[i_closest]] - vCenter;
+		float fLength = vAxis.mag();
+		if (fLength == 0.0f) { continue; }
+		vAxis /= fLength;
+
+		float fMin, fMax;
+		ProjectConvexPiece(nodes, piece, vAxis, &fMin, &fMax);
+		float fProjection = vAxis.dot(vCenter);
+		if (fProjection + fRadius < fMin || fProjection - fRadius > fMax) { return false; }
+	}
+	return true;
+}
+
+// Find the two tangent vertices of a convex piece as seen from an outside observer
+bool FindSilhouetteVertices(const olc::vf2d& vObserver, const std::vector<olc::vf2d>& nodes, const ConvexPiece& piece,
+	int* i_nodeLeft, int* i_nodeRight)
+{
+	// Edges of a counter-clockwise piece face the observer if it lies on their right side
+	int n = int(piece.nodes.size());
+	auto isFrontFacing = [&](int i) { return Orientation(nodes[piece.nodes[i]], nodes[piece.nodes[(i + 1) % n]], vObserver) < 0.0f; };
+
+	*i_nodeLeft = -1;
+	*i_nodeRight = -1;
+	bool bPreviousFront = isFrontFacing(n - 1);
+	for (int i = 0; i < n; i++)
+	{
+		bool bFront = isFrontFacing(i);
+		if (!bPreviousFront && bFront) { *i_nodeLeft = piece.nodes[i]; }
+		if (bPreviousFront && !bFront) { *i_nodeRight = piece.nodes[i]; }
+		bPreviousFront = bFront;
+	}
+	return *i_nodeLeft != -1 && *i_nodeRight != -1;
+}
@@ -58,75 +58,30 @@ float EuclideanDistanceToLine(const olc::vf2d& vStart, const olc::vf2d& vEnd, co
 	return sqrt(EuclideanDistanceToLineSquared(vStart, vEnd, vPoint));
 }
 
-// Find the closest node to point
-int FindClosestNode(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, float* squaredDistance)
+// Build a compressed (CSR) node-to-segment adjacency
+void BuildNodeAdjacency(const int& nNodes, const std::vector<std::array<int, 2>>& segments,
+	std::vector<int>* offsets, std::vector<int>* adjacentSegments)
 {
-	// Initialize a vector of lenghts
-	std::vector<float> distances(nodes.size());
-
-	// Loop over all nodes
-	for (int i = 0; i < nodes.size(); i++)
-	{
-		distances[i] = EuclideanDistanceSquared(vPoint, nodes[i]);
-	}
-	int min_index = std::min_element(distances.begin(), distances.end()) - distances.begin();
-	*squaredDistance = distances[min_index];
-	return min_index;
-}
-
-// Find the closest line segment to point
-int FindClosestLineSegment(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes,
-	const std::vector<std::array<int, 2>>& segments, float* squaredDistance)
-{
-	// Initialize a vector of lenghts
-	std::vector<float> distances(segments.size());
-
-	// Loop over all nodes
+	// Count the degree of each node
+	offsets->assign(nNodes + 1, 0);
 	for (int i = 0; i < segments.size(); i++)
 	{
-		olc::vf2d vStart = nodes[segments[i][0]];
-		olc::vf2d vEnd = nodes[segments[i][1]];
-
-		distances[i] = EuclideanDistanceToLineSquared(vStart, vEnd, vPoint);
+		(*offsets)[segments[i][0] + 1] += 1;
+		(*offsets)[segments[i][1] + 1] += 1;
 	}
-	int min_index = std::min_element(distances.begin(), distances.end()) - distances.begin();
-	*squaredDistance = distances[min_index];
-	return min_index;
-}
-
-// Find all the segments that are connected to the selected node
-std::vector<int> FindConnectedSegments(const int& i_node, const std::vector<std::array<int, 2>>& segments)
-{
-	std::vector<int> segment_index;
-	segment_index.reserve(segments.size());
-	for (int i = 0; i < segments.size(); i++)
+	// Prefix sum of degrees
+	for (int i = 0; i < nNodes; i++)
 	{
-		if (i_node == segments[i][0] || i_node == segments[i][1])
-		{
-			segment_index.push_back(i);
-		}
+		(*offsets)[i + 1] += (*offsets)[i];
 	}
-	segment_index.resize(segment_index.size());
-	return segment_index;
-}
-
-// Check if the segment already exists
-bool DoesSegmentExist(const std::array<int, 2>& segment, const std::vector<std::array<int, 2>>& segments)
-{
+	// Scatter the segment indices
+	std::vector<int> fill(offsets->begin(), offsets->end() - 1);
+	adjacentSegments->resize(offsets->back());
 	for (int i = 0; i < segments.size(); i++)
 	{
-		// If start and end are the same
-		if (segment[0] == segments[i][0] && segment[1] == segments[i][1])
-		{
-			return true;
-		}
-		// If start and end are the same,in the opposite direction
-		if (segment[0] == segments[i][1] && segment[1] == segments[i][0])
-		{
-			return true;
-		}
+		(*adjacentSegments)[fill[segments[i][0]]++] = i;
+		(*adjacentSegments)[fill[segments[i][1]]++] = i;
 	}
-	return false;
 }
 
 // If two line segments intersect, function returns "true" and the intersection point. Otherwise "false" is returned.
@@ -0,0 +1,397 @@
+#include "olcPixelGameEngine.h"
+#include "edit_history.h"
+
+
+EditHistory::EditHistory(const size_t& nMemoryBudget)
+{
+	nCapacity = std::max(nMemoryBudget / sizeof(HistoryRecord), size_t(1));
+}
+
+// Store the edits of one user action as an undo step
+void EditHistory::Push(const std::vector<GeometryEdit>& edits, const bool& bMerge)
+{
+	if (edits.empty()) { return; }
+	if (records.empty()) { records.resize(nCapacity); }
+
+	// A new action makes the redo steps unreachable
+	DropRedoSteps();
+
+	// Start a new step unless the previous one is extended
+	if (!bMerge || !bMergeOpen)
+	{
+		steps.push_back(0);
+		nUndoSteps += 1;
+		mergedMoves.clear();
+		bMergeOpen = true;
+		bOverflow = false;
+	}
+	if (bOverflow) { return; }
+
+	for (int i = 0; i < edits.size(); i++)
+	{
+		const GeometryEdit& edit = edits[i];
+		HistoryRecord record;
+		record.nType = edit.nType;
+		if (edit.nType == GeometryEditType::AddSegment || edit.nType == GeometryEditType::DeleteSegment)
+		{
+			record.nSlot = edit.hSegment.nSlot;
+			record.nGeneration = edit.hSegment.nGeneration;
+			record.nSegmentNodes[0] = uint32_t(edit.segmentNodes[0].nSlot);
+			record.nSegmentNodes[1] = edit.segmentNodes[0].nGeneration;
+			record.nSegmentNodes[2] = uint32_t(edit.segmentNodes[1].nSlot);
+			record.nSegmentNodes[3] = edit.segmentNodes[1].nGeneration;
+		}
+		else
+		{
+			record.nSlot = edit.hNode.nSlot;
+			record.nGeneration = edit.hNode.nGeneration;
+			record.fPositions[0] = edit.vOldPosition.x;
+			record.fPositions[1] = edit.vOldPosition.y;
+			record.fPositions[2] = edit.vNewPosition.x;
+			record.fPositions[3] = edit.vNewPosition.y;
+		}
+
+		// Repeated moves of a node within the step only update the target position
+		if (edit.nType == GeometryEditType::MoveNode)
+		{
+			auto it = mergedMoves.find(record.nGeneration);
+			if (it != mergedMoves.end())
+			{
+				records[it->second].fPositions[2] = record.fPositions[2];
+				records[it->second].fPositions[3] = record.fPositions[3];
+				continue;
+			}
+		}
+		if (!Append(record))
+		{
+			bOverflow = true;
+			return;
+		}
+		if (edit.nType == GeometryEditType::MoveNode)
+		{
+			mergedMoves[record.nGeneration] = (nStart + nUndoRecords - 1) % nCapacity;
+		}
+	}
+}
+
+// Append a record to the open step, evicting the oldest steps if the buffer is full
+bool EditHistory::Append(const HistoryRecord& record)
+{
+	while (nUndoRecords == nCapacity)
+	{
+		// A single step larger than the whole budget cannot be undone. The merge stays open as overflowed, so the
+		// rest of a drag does not start a step that only holds its tail.
+		if (steps.size() == 1)
+		{
+			Clear();
+			bMergeOpen = true;
+			bOverflow = true;
+			return false;
+		}
+		for (size_t i = 0; i < steps.front(); i++)
+		{
+			Release(records[(nStart + i) % nCapacity]);
+		}
+		nStart = (nStart + steps.front()) % nCapacity;
+		nUndoRecords -= steps.front();
+		steps.pop_front();
+		nUndoSteps -= 1;
+	}
+	records[(nStart + nUndoRecords) % nCapacity] = record;
+	Retain(record);
+	nUndoRecords += 1;
+	steps.back() += 1;
+	return true;
+}
+
+// Undo one step, the records are applied backwards in reverse order
+bool EditHistory::Undo(GeometryStore* geometry, std::vector<GeometryEdit>* edits)
+{
+	if (nUndoSteps == 0) { return false; }
+	size_t nLength = steps[nUndoSteps - 1];
+	size_t nFirst = nUndoRecords - nLength;
+	{
+		GeometryTransaction transaction(geometry);
+		for (size_t i = nLength; i > 0; i--)
+		{
+			Apply(&transaction, records[(nStart + nFirst + i - 1) % nCapacity], true);
+		}
+		if (edits) { *edits = transaction.GetEdits(); }
+	}
+	nUndoSteps -= 1;
+	nUndoRecords -= nLength;
+	nRedoRecords += nLength;
+	bMergeOpen = false;
+	return true;
+}
+
+// Redo one step
+bool EditHistory::Redo(GeometryStore* geometry, std::vector<GeometryEdit>* edits)
+{
+	if (nUndoSteps == steps.size()) { return false; }
+	size_t nLength = steps[nUndoSteps];
+	{
+		GeometryTransaction transaction(geometry);
+		for (size_t i = 0; i < nLength; i++)
+		{
+			Apply(&transaction, records[(nStart + nUndoRecords + i) % nCapacity], false);
+		}
+		if (edits) { *edits = transaction.GetEdits(); }
+	}
+	nUndoSteps += 1;
+	nUndoRecords += nLength;
+	nRedoRecords -= nLength;
+	bMergeOpen = false;
+	return true;
+}
+
+// Apply a record forwards (redo) or backwards (undo)
+void EditHistory::Apply(GeometryTransaction* transaction, const HistoryRecord& record, const bool& bInverse)
+{
+	GeometryEditType nType = record.nType;
+	if (bInverse)
+	{
+		if      (nType == GeometryEditType::AddNode)       { nType = GeometryEditType::DeleteNode; }
+		else if (nType == GeometryEditType::DeleteNode)    { nType = GeometryEditType::AddNode; }
+		else if (nType == GeometryEditType::AddSegment)    { nType = GeometryEditType::DeleteSegment; }
+		else if (nType == GeometryEditType::DeleteSegment) { nType = GeometryEditType::AddSegment; }
+	}
+
+	switch (nType)
+	{
+	case GeometryEditType::AddNode:
+	{
+		NodeHandle hOld = ResolveNode(record.nSlot, record.nGeneration);
+		NodeHandle hNew = transaction->AddNode({ record.fPositions[2], record.fPositions[3] });
+		nodeForwarding.Recreate(hOld, hNew);
+		break;
+	}
+	case GeometryEditType::DeleteNode:
+		transaction->DeleteNode(ResolveNode(record.nSlot, record.nGeneration));
+		break;
+	case GeometryEditType::MoveNode:
+		transaction->MoveNode(ResolveNode(record.nSlot, record.nGeneration),
+			bInverse ? olc::vf2d{ record.fPositions[0], record.fPositions[1] } : olc::vf2d{ record.fPositions[2], record.fPositions[3] });
+		break;
+	case GeometryEditType::AddSegment:
+	{
+		SegmentHandle hOld = ResolveSegment(record.nSlot, record.nGeneration);
+		NodeHandle hStart = ResolveNode(int32_t(record.nSegmentNodes[0]), record.nSegmentNodes[1]);
+		NodeHandle hEnd = ResolveNode(int32_t(record.nSegmentNodes[2]), record.nSegmentNodes[3]);
+		SegmentHandle hNew = transaction->AddSegment(hStart, hEnd);
+		if (hNew.nSlot != -1) { segmentForwarding.Recreate(hOld, hNew); }
+		break;
+	}
+	case GeometryEditType::DeleteSegment:
+		transaction->DeleteSegment(ResolveSegment(record.nSlot, record.nGeneration));
+		break;
+	}
+}
+
+// Count the generations a record uses while it is stored
+void EditHistory::Retain(const HistoryRecord& record)
+{
+	if (record.nType == GeometryEditType::AddSegment || record.nType == GeometryEditType::DeleteSegment)
+	{
+		segmentForwarding.AddReference(record.nGeneration);
+		nodeForwarding.AddReference(record.nSegmentNodes[1]);
+		nodeForwarding.AddReference(record.nSegmentNodes[3]);
+	}
+	else
+	{
+		nodeForwarding.AddReference(record.nGeneration);
+	}
+}
+
+// Stop counting the generations of a dropped record
+void EditHistory::Release(const HistoryRecord& record)
+{
+	if (record.nType == GeometryEditType::AddSegment || record.nType == GeometryEditType::DeleteSegment)
+	{
+		segmentForwarding.RemoveReference(record.nGeneration);
+		nodeForwarding.RemoveReference(record.nSegmentNodes[1]);
+		nodeForwarding.RemoveReference(record.nSegmentNodes[3]);
+	}
+	else
+	{
+		nodeForwarding.RemoveReference(record.nGeneration);
+	}
+}
+
+// Drop the steps that can be redone
+void EditHistory::DropRedoSteps()
+{
+	for (size_t i = 0; i < nRedoRecords; i++)
+	{
+		Release(records[(nStart + nUndoRecords + i) % nCapacity]);
+	}
+	steps.resize(nUndoSteps);
+	nRedoRecords = 0;
+}
+
+// Current handle of a node, following the forwarding of re-created ones
+NodeHandle EditHistory::ResolveNode(const int32_t& nSlot, const uint32_t& nGeneration) const
+{
+	return nodeForwarding.Resolve({ nSlot, nGeneration });
+}
+
+// Current handle of a segment, following the forwarding of re-created ones
+SegmentHandle EditHistory::ResolveSegment(const int32_t& nSlot, const uint32_t& nGeneration) const
+{
+	return segmentForwarding.Resolve({ nSlot, nGeneration });
+}
+
+// Count a record that uses a generation
+template<typename Handle>
+void EditHistory::HandleForwarding<Handle>::AddReference(const uint32_t& nGeneration)
+{
+	references[nGeneration] += 1;
+}
+
+// Uncount a record that used a generation, its forwarding is removed with the last one
+template<typename Handle>
+void EditHistory::HandleForwarding<Handle>::RemoveReference(const uint32_t& nGeneration)
+{
+	auto it = references.find(nGeneration);
+	if (it == references.end() || --it->second > 0) { return; }
+	references.erase(it);
+	auto itForward = forward.find(nGeneration);
+	if (itForward == forward.end()) { return; }
+	auto itKeys = keys.find(itForward->second.nGeneration);
+	if (itKeys != keys.end())
+	{
+		std::vector<uint32_t>& forwarded = itKeys->second;
+		auto itKey = std::find(forwarded.begin(), forwarded.end(), nGeneration);
+		if (itKey != forwarded.end())
+		{
+			*itKey = forwarded.back();
+			forwarded.pop_back();
+		}
+		if (forwarded.empty()) { keys.erase(itKeys); }
+	}
+	forward.erase(itForward);
+}
+
+// Newest handle of a generation
+template<typename Handle>
+Handle EditHistory::HandleForwarding<Handle>::Resolve(const Handle& hHandle) const
+{
+	auto it = forward.find(hHandle.nGeneration);
+	return it == forward.end() ? hHandle : it->second;
+}
+
+// Forward every generation that refers to "hOld" to its re-created copy "hNew"
+template<typename Handle>
+void EditHistory::HandleForwarding<Handle>::Recreate(const Handle& hOld, const Handle& hNew)
+{
+	std::vector<uint32_t> forwarded;
+	auto itKeys = keys.find(hOld.nGeneration);
+	if (itKeys != keys.end())
+	{
+		forwarded = std::move(itKeys->second);
+		keys.erase(itKeys);
+	}
+	// The old handle itself is only forwarded while records use it
+	if (references.count(hOld.nGeneration) != 0) { forwarded.push_back(hOld.nGeneration); }
+	if (forwarded.empty()) { return; }
+	for (uint32_t nGeneration : forwarded)
+	{
+		forward[nGeneration] = hNew;
+	}
+	keys[hNew.nGeneration] = std::move(forwarded);
+}
+
+template<typename Handle>
+void EditHistory::HandleForwarding<Handle>::Clear()
+{
+	references.clear();
+	forward.clear();
+	keys.clear();
+}
+
+// Check if a step can be undone
+bool EditHistory::CanUndo() const
+{
+	return nUndoSteps > 0;
+}
+
+// Check if a step can be redone
+bool EditHistory::CanRedo() const
+{
+	return nUndoSteps < steps.size();
+}
+
+// Remove all steps
+void EditHistory::Clear()
+{
+	nStart = 0;
+	nUndoRecords = 0;
+	nRedoRecords = 0;
+	steps.clear();
+	nUndoSteps = 0;
+	bMergeOpen = false;
+	bOverflow = false;
+	mergedMoves.clear();
+	nodeForwarding.Clear();
+	segmentForwarding.Clear();
+}
+
+// Translate the stored handles after the geometry store was compacted. Generations survive compaction,
+// so a stored handle refers to a remapped node or segment only if the generations match.
+void EditHistory::Remap(const std::vector<NodeHandle>& nodeRemap, const std::vector<SegmentHandle>& segmentRemap)
+{
+	auto remapNode = [&](int32_t nSlot, uint32_t nGeneration)
+	{
+		if (nSlot >= 0 && nSlot < nodeRemap.size() && nodeRemap[nSlot].nGeneration == nGeneration) { return nodeRemap[nSlot].nSlot; }
+		return nSlot;
+	};
+	auto remapSegment = [&](int32_t nSlot, uint32_t nGeneration)
+	{
+		if (nSlot >= 0 && nSlot < segmentRemap.size() && segmentRemap[nSlot].nGeneration == nGeneration) { return segmentRemap[nSlot].nSlot; }
+		return nSlot;
+	};
+
+	for (size_t i = 0; i < nUndoRecords + nRedoRecords; i++)
+	{
+		HistoryRecord& record = records[(nStart + i) % nCapacity];
+		if (record.nType == GeometryEditType::AddSegment || record.nType == GeometryEditType::DeleteSegment)
+		{
+			record.nSlot = remapSegment(record.nSlot, record.nGeneration);
+			record.nSegmentNodes[0] = uint32_t(remapNode(int32_t(record.nSegmentNodes[0]), record.nSegmentNodes[1]));
+			record.nSegmentNodes[2] = uint32_t(remapNode(int32_t(record.nSegmentNodes[2]), record.nSegmentNodes[3]));
+		}
+		else
+		{
+			record.nSlot = remapNode(record.nSlot, record.nGeneration);
+		}
+	}
+	for (auto& forward : nodeForwarding.forward)
+	{
+		forward.second.nSlot = remapNode(forward.second.nSlot, forward.second.nGeneration);
+	}
+	for (auto& forward : segmentForwarding.forward)
+	{
+		forward.second.nSlot = remapSegment(forward.second.nSlot, forward.second.nGeneration);
+	}
+}
+
+// Number of steps that can be undone
+int EditHistory::GetUndoCount() const
+{
+	return nUndoSteps;
+}
+
+// Number of steps that can be redone
+int EditHistory::GetRedoCount() const
+{
+	return int(steps.size()) - nUndoSteps;
+}
+
+// Memory used by the records in bytes
+size_t EditHistory::GetMemoryUsage() const
+{
+	size_t nReferences = nodeForwarding.references.size() + segmentForwarding.references.size();
+	size_t nForwards = nodeForwarding.forward.size() + segmentForwarding.forward.size();
+	return records.size() * sizeof(HistoryRecord) + steps.size() * sizeof(size_t) +
+		nReferences * 2 * sizeof(uint32_t) + nForwards * (2 * sizeof(uint32_t) + sizeof(NodeHandle));
+}
@@ -0,0 +1,415 @@
+#include "olcPixelGameEngine.h"
+#include "edit_journal.h"
+#include "scene_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define EDIT_JOURNAL_FSYNC
+#endif
+
+
+// Magic bytes at the start of a journal
+static const char sJournalMagic[8] = { 'S', 'C', '2', 'D', 'J', 'R', 'N', '\0' };
+
+// Journals smaller than this never trigger a snapshot
+static const uint64_t nMinSnapshotBytes = 4 << 20;
+
+
+// FNV-1a checksum of a batch
+static uint32_t Checksum(const void* pData, const size_t& nBytes)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	uint32_t nHash = 2166136261u;
+	for (size_t i = 0; i < nBytes; i++)
+	{
+		nHash = (nHash ^ pBytes[i]) * 16777619u;
+	}
+	return nHash;
+}
+
+// Make the contents of a written file durable
+static void SyncFile(const std::string& sPath)
+{
+#ifdef EDIT_JOURNAL_FSYNC
+	int fd = open(sPath.c_str(), O_RDONLY);
+	if (fd == -1) { return; }
+	fsync(fd);
+	close(fd);
+#endif
+}
+
+// Make a rename durable by syncing the directory that contains the file
+static void SyncDirectory(const std::string& sPath)
+{
+	size_t nSlash = sPath.find_last_of('/');
+	SyncFile(nSlash == std::string::npos ? std::string(".") : sPath.substr(0, nSlash + 1));
+}
+
+EditJournal::~EditJournal()
+{
+	Close();
+}
+
+// File names of snapshot and journal "N"
+std::string EditJournal::SnapshotPath(const uint64_t& nSequence) const
+{
+	return sPath + "." + std::to_string(nSequence) + ".snapshot";
+}
+
+std::string EditJournal::JournalPath(const uint64_t& nSequence) const
+{
+	return sPath + "." + std::to_string(nSequence) + ".journal";
+}
+
+// Restore the geometry and start journaling
+int EditJournal::Open(const std::string& sPath, GeometryStore* geometry)
+{
+	Close();
+	this->sPath = sPath;
+
+	// At most two pairs exist, a complete one and possibly a newer one that was interrupted, so the newest pair
+	// that can be read wins
+	std::vector<uint64_t> sequences;
+	std::filesystem::path path(sPath);
+	std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+	std::string sPrefix = path.filename().string() + ".";
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+	{
+		std::string sName = it->path().filename().string();
+		const std::string sSuffix = ".journal";
+		if (sName.size() <= sPrefix.size() + sSuffix.size() || sName.compare(0, sPrefix.size(), sPrefix) != 0 ||
+			sName.compare(sName.size() - sSuffix.size(), sSuffix.size(), sSuffix) != 0)
+		{
+			continue;
+		}
+		std::string sNumber = sName.substr(sPrefix.size(), sName.size() - sPrefix.size() - sSuffix.size());
+		if (sNumber.find_first_not_of("0123456789") == std::string::npos) { sequences.push_back(std::stoull(sNumber)); }
+	}
+	std::sort(sequences.begin(), sequences.end());
+	int nReplayed = -1;
+	nSequence = sequences.empty() ? 0 : sequences.back();
+	for (int i = int(sequences.size()) - 1; i >= 0 && nReplayed == -1; i--)
+	{
+		nReplayed = Replay(sequences[i], geometry);
+		if (nReplayed == -1) { continue; }
+
+		// Continue from the pair that was loaded, the next snapshot replaces the newer pairs that cannot be read
+		nSequence = sequences[i];
+		for (int j = i + 1; j < sequences.size(); j++)
+		{
+			std::remove(JournalPath(sequences[j]).c_str());
+			std::remove(SnapshotPath(sequences[j]).c_str());
+		}
+	}
+
+	// A new snapshot of the restored geometry keeps the next replay short
+	nRecordedBytes = 0;
+	bStop = false;
+	bFlush = false;
+	nQueued = 0;
+	nWritten = 0;
+	writer = std::thread(&EditJournal::WriterThread, this);
+	Snapshot(geometry);
+	return nReplayed;
+}
+
+// Load snapshot "N" and apply its journal
+int EditJournal::Replay(const uint64_t& nSequence, GeometryStore* geometry) const
+{
+	SceneFile scene;
+	std::vector<olc::vf2d> nodes;
+	std::vector<std::array<int, 2>> segments;
+	if (!scene.Open(SnapshotPath(nSequence)) || !LoadScene(scene, &nodes, &segments)) { return -1; }
+	scene.Close();
+
+	std::FILE* file = std::fopen(JournalPath(nSequence).c_str(), "rb");
+	if (!file) { return -1; }
+	JournalHeader header;
+	bool bValid = std::fread(&header, sizeof(JournalHeader), 1, file) == 1 &&
+		std::memcmp(header.sMagic, sJournalMagic, sizeof(sJournalMagic)) == 0 && header.nVersion == nJournalVersion &&
+		header.nNodes == nodes.size() && header.nSegments == segments.size();
+	std::vector<uint32_t> nodeGenerations(nodes.size());
+	std::vector<uint32_t> segmentGenerations(segments.size());
+	bValid = bValid && (nodes.empty() || std::fread(nodeGenerations.data(), sizeof(uint32_t), nodes.size(), file) == nodes.size());
+	bValid = bValid && (segments.empty() || std::fread(segmentGenerations.data(), sizeof(uint32_t), segments.size(), file) == segments.size());
+	if (!bValid)
+	{
+		std::fclose(file);
+		return -1;
+	}
+
+	// The recorded generations refer to the geometry of the session that wrote the journal
+	geometry->Assign(nodes, segments);
+	std::unordered_map<uint32_t, NodeHandle> nodeHandles;
+	std::unordered_map<uint32_t, SegmentHandle> segmentHandles;
+	nodeHandles.reserve(nodes.size());
+	segmentHandles.reserve(segments.size());
+	std::vector<NodeHandle> nodesByIndex(nodes.size());
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		nodesByIndex[i] = geometry->GetNodeHandle(i);
+		nodeHandles[nodeGenerations[i]] = nodesByIndex[i];
+	}
+	for (int i = 0; i < segments.size(); i++)
+	{
+		segmentHandles[segmentGenerations[i]] = geometry->FindSegment(nodesByIndex[segments[i][0]], nodesByIndex[segments[i][1]]);
+	}
+	auto findNode = [&](const uint32_t& nGeneration)
+	{
+		auto it = nodeHandles.find(nGeneration);
+		return it == nodeHandles.end() ? NodeHandle() : it->second;
+	};
+	auto findSegment = [&](const uint32_t& nGeneration)
+	{
+		auto it = segmentHandles.find(nGeneration);
+		return it == segmentHandles.end() ? SegmentHandle() : it->second;
+	};
+
+	// Apply the batches up to the first one that is incomplete or damaged
+	int nReplayed = 0;
+	GeometryTransaction transaction(geometry);
+	std::vector<JournalRecord> records;
+	uint32_t batch[2];
+	while (std::fread(batch, sizeof(batch), 1, file) == 1)
+	{
+		records.resize(batch[0]);
+		if (!records.empty() && std::fread(records.data(), sizeof(JournalRecord), records.size(), file) != records.size()) { break; }
+		if (Checksum(records.data(), records.size() * sizeof(JournalRecord)) != batch[1]) { break; }
+		for (const JournalRecord& record : records)
+		{
+			switch (record.nType)
+			{
+			case GeometryEditType::AddNode:
+				nodeHandles[record.nGeneration] = transaction.AddNode({ record.fPosition[0], record.fPosition[1] });
+				break;
+			case GeometryEditType::MoveNode:
+				transaction.MoveNode(findNode(record.nGeneration), { record.fPosition[0], record.fPosition[1] });
+				break;
+			case GeometryEditType::DeleteNode:
+				transaction.DeleteNode(findNode(record.nGeneration));
+				nodeHandles.erase(record.nGeneration);
+				break;
+			case GeometryEditType::AddSegment:
+				segmentHandles[record.nGeneration] = transaction.AddSegment(findNode(record.nSegmentNodes[0]), findNode(record.nSegmentNodes[1]));
+				break;
+			case GeometryEditType::DeleteSegment:
+				transaction.DeleteSegment(findSegment(record.nGeneration));
+				segmentHandles.erase(record.nGeneration);
+				break;
+			}
+			nReplayed += 1;
+		}
+	}
+	transaction.Commit();
+	std::fclose(file);
+	return nReplayed;
+}
+
+// Write everything that is recorded and stop the background thread
+void EditJournal::Close()
+{
+	if (writer.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bStop = true;
+		}
+		wakeWriter.notify_one();
+		writer.join();
+	}
+	queue.clear();
+	sPath.clear();
+}
+
+bool EditJournal::IsOpen() const
+{
+	return !sPath.empty();
+}
+
+// Append edits
+void EditJournal::Record(const std::vector<GeometryEdit>& edits)
+{
+	if (!IsOpen() || edits.empty()) { return; }
+	std::vector<JournalRecord> records(edits.size());
+	for (int i = 0; i < edits.size(); i++)
+	{
+		const GeometryEdit& edit = edits[i];
+		JournalRecord& record = records[i];
+		std::memset(&record, 0, sizeof(JournalRecord));
+		record.nType = edit.nType;
+		if (edit.nType == GeometryEditType::AddSegment || edit.nType == GeometryEditType::DeleteSegment)
+		{
+			record.nGeneration = edit.hSegment.nGeneration;
+			record.nSegmentNodes[0] = edit.segmentNodes[0].nGeneration;
+			record.nSegmentNodes[1] = edit.segmentNodes[1].nGeneration;
+		}
+		else
+		{
+			record.nGeneration = edit.hNode.nGeneration;
+			record.fPosition[0] = edit.vNewPosition.x;
+			record.fPosition[1] = edit.vNewPosition.y;
+		}
+	}
+	nRecordedBytes += records.size() * sizeof(JournalRecord);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (queue.empty() || queue.back().snapshot) { queue.emplace_back(); }
+	std::vector<JournalRecord>& queued = queue.back().records;
+	queued.insert(queued.end(), records.begin(), records.end());
+	nQueued += 1;
+}
+
+// Replace the journal with a snapshot of the geometry
+void EditJournal::Snapshot(GeometryStore* geometry)
+{
+	if (!IsOpen()) { return; }
+	std::unique_ptr<SnapshotData> snapshot(new SnapshotData());
+	snapshot->nodes = geometry->GetNodes();
+	snapshot->segments = geometry->GetSegments();
+	snapshot->nodeGenerations.resize(snapshot->nodes.size());
+	snapshot->segmentGenerations.resize(snapshot->segments.size());
+	for (int i = 0; i < snapshot->nodes.size(); i++)
+	{
+		snapshot->nodeGenerations[i] = geometry->GetNodeHandle(i).nGeneration;
+	}
+	for (int i = 0; i < snapshot->segments.size(); i++)
+	{
+		snapshot->segmentGenerations[i] = geometry->GetSegmentHandle(i).nGeneration;
+	}
+	nRecordedBytes = 0;
+	nSnapshotBytes = snapshot->nodes.size() * 12 + snapshot->segments.size() * 12;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (queue.empty() || queue.back().snapshot) { queue.emplace_back(); }
+	queue.back().snapshot = std::move(snapshot);
+	nQueued += 1;
+	wakeWriter.notify_one();
+}
+
+// Check whether a new snapshot pays off
+bool EditJournal::IsSnapshotDue() const
+{
+	return IsOpen() && nRecordedBytes > std::max(nMinSnapshotBytes, nSnapshotBytes);
+}
+
+// Time between syncs of the journal
+void EditJournal::SetFlushInterval(const float& fSeconds)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	fFlushInterval = fSeconds;
+}
+
+// Block until everything recorded so far is on disk
+void EditJournal::Flush()
+{
+	if (!IsOpen()) { return; }
+	std::unique_lock<std::mutex> lock(mutex);
+	uint64_t nTarget = nQueued;
+	bFlush = true;
+	wakeWriter.notify_one();
+	workDone.wait(lock, [&]() { return nWritten >= nTarget; });
+}
+
+// Write and sync queued work until the journal is closed
+void EditJournal::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		// Records wait for the next sync, snapshots, flushes and closing are handled right away
+		bool bSnapshot = false;
+		for (const JournalWork& work : queue) { bSnapshot = bSnapshot || work.snapshot; }
+		if (!bStop && !bFlush && !bSnapshot)
+		{
+			wakeWriter.wait_for(lock, std::chrono::duration<float>(fFlushInterval));
+		}
+		std::deque<JournalWork> work;
+		work.swap(queue);
+		uint64_t nTarget = nQueued;
+		bool bLast = bStop;
+		bFlush = false;
+		lock.unlock();
+
+		for (JournalWork& item : work)
+		{
+			WriteBatch(item.records);
+			if (item.snapshot) { WriteSnapshot(*item.snapshot); }
+		}
+#ifdef EDIT_JOURNAL_FSYNC
+		if (journalFile) { fsync(fileno(journalFile)); }
+#endif
+
+		lock.lock();
+		nWritten = nTarget;
+		workDone.notify_all();
+		if (bLast && queue.empty()) { break; }
+	}
+	lock.unlock();
+	if (journalFile)
+	{
+		std::fclose(journalFile);
+		journalFile = nullptr;
+	}
+}
+
+// Append one batch of records to the open journal
+void EditJournal::WriteBatch(const std::vector<JournalRecord>& records)
+{
+	if (!journalFile || records.empty()) { return; }
+	uint32_t batch[2] = { uint32_t(records.size()), Checksum(records.data(), records.size() * sizeof(JournalRecord)) };
+	std::fwrite(batch, sizeof(batch), 1, journalFile);
+	std::fwrite(records.data(), sizeof(JournalRecord), records.size(), journalFile);
+	std::fflush(journalFile);
+}
+
+// Write snapshot "N + 1" with its empty journal and remove pair "N"
+void EditJournal::WriteSnapshot(const SnapshotData& snapshot)
+{
+	// Journal "N" stays complete until pair "N + 1" exists
+	if (journalFile)
+	{
+		std::fflush(journalFile);
+#ifdef EDIT_JOURNAL_FSYNC
+		fsync(fileno(journalFile));
+#endif
+	}
+
+	// Both files are written under temporary names and renamed when they are durable, the journal last
+	std::string sSnapshotPath = SnapshotPath(nSequence + 1);
+	std::string sJournalPath = JournalPath(nSequence + 1);
+	if (!SaveScene(sSnapshotPath + ".tmp", snapshot.nodes, snapshot.segments, false)) { return; }
+	SyncFile(sSnapshotPath + ".tmp");
+	if (std::rename((sSnapshotPath + ".tmp").c_str(), sSnapshotPath.c_str()) != 0) { return; }
+
+	std::FILE* file = std::fopen((sJournalPath + ".tmp").c_str(), "wb");
+	if (!file) { return; }
+	JournalHeader header = {};
+	std::memcpy(header.sMagic, sJournalMagic, sizeof(sJournalMagic));
+	header.nVersion = nJournalVersion;
+	header.nNodes = snapshot.nodes.size();
+	header.nSegments = snapshot.segments.size();
+	std::fwrite(&header, sizeof(JournalHeader), 1, file);
+	if (!snapshot.nodeGenerations.empty()) { std::fwrite(snapshot.nodeGenerations.data(), sizeof(uint32_t), snapshot.nodeGenerations.size(), file); }
+	if (!snapshot.segmentGenerations.empty()) { std::fwrite(snapshot.segmentGenerations.data(), sizeof(uint32_t), snapshot.segmentGenerations.size(), file); }
+	bool bWritten = std::fflush(file) == 0;
+#ifdef EDIT_JOURNAL_FSYNC
+	bWritten = bWritten && fsync(fileno(file)) == 0;
+#endif
+	std::fclose(file);
+	if (!bWritten || std::rename((sJournalPath + ".tmp").c_str(), sJournalPath.c_str()) != 0) { return; }
+	SyncDirectory(sJournalPath);
+
+	// Switch to the new journal and remove the old pair
+	if (journalFile) { std::fclose(journalFile); }
+	journalFile = std::fopen(sJournalPath.c_str(), "ab");
+	std::remove(JournalPath(nSequence).c_str());
+	std::remove(SnapshotPath(nSequence).c_str());
+	nSequence += 1;
+}
@@ -0,0 +1,536 @@
+#include "olcPixelGameEngine.h"
+#include "geo_import.h"
+#include "parallel_for.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+
+// Number of buckets of the parallel weld, fixed so the result does not depend on the number of threads
+static const int nWeldBuckets = 64;
+
+// Mean radius of the earth in metres
+static const double fEarthRadius = 6371008.8;
+
+
+// Polylines parsed from one chunk, in input coordinates
+struct GeoChunk
+{
+	std::vector<olc::vd2d> points;
+	std::vector<uint32_t> polylineStarts; // First point of each polyline, followed by the total number of points
+	std::vector<uint8_t> polylineClosed;
+	int nFeatures = 0;
+	olc::vd2d vMin = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+	olc::vd2d vMax = { -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() };
+
+	// Polylines and points in the local frame, filled after all chunks are parsed
+	std::vector<olc::vf2d> localPoints;
+	std::vector<int32_t> pointNodes;
+
+	void AddPoint(const olc::vd2d& vPoint)
+	{
+		points.push_back(vPoint);
+		vMin = vMin.min(vPoint);
+		vMax = vMax.max(vPoint);
+	}
+
+	void BeginPolyline()
+	{
+		polylineStarts.push_back(uint32_t(points.size()));
+	}
+
+	// Drop polylines with less than two points
+	void EndPolyline(const bool& bClosed)
+	{
+		if (points.size() - polylineStarts.back() < 2)
+		{
+			points.resize(polylineStarts.back());
+			polylineStarts.pop_back();
+			return;
+		}
+		polylineClosed.push_back(bClosed);
+	}
+};
+
+
+// Skip white space
+static const char* SkipSpace(const char* p, const char* pEnd)
+{
+	while (p < pEnd && std::isspace(static_cast<unsigned char>(*p))) { p++; }
+	return p;
+}
+
+// Read a number, the chunk must be followed by a character that ends a number
+static bool ReadNumber(const char** p, const char* pEnd, double* fValue)
+{
+	const char* pStart = SkipSpace(*p, pEnd);
+	char* pNumberEnd = nullptr;
+	*fValue = std::strtod(pStart, &pNumberEnd);
+	if (pNumberEnd == pStart || pNumberEnd > pEnd) { return false; }
+	*p = pNumberEnd;
+	return true;
+}
+
+// Skip a JSON string starting at its opening quote, returns the position after the closing quote
+static const char* SkipString(const char* p, const char* pEnd)
+{
+	for (p++; p < pEnd; p++)
+	{
+		if (*p == '\\') { p++; }
+		else if (*p == '"') { return p + 1; }
+	}
+	return pEnd;
+}
+
+
+// O------------------------------------------------------------------------------O
+// | GEOJSON                                                                      |
+// O------------------------------------------------------------------------------O
+
+// Parse a GeoJSON coordinate array. Every innermost array of positions becomes one polyline.
+static const char* ParseCoordinates(const char* p, const char* pEnd, GeoChunk* chunk)
+{
+	// Depth of the nesting below the outermost bracket, positions are at depth 1
+	int nLevel = 0;
+	int nMaxLevel = 0;
+	bool bInPolyline = false;
+	while (p < pEnd)
+	{
+		p = SkipSpace(p, pEnd);
+		if (p >= pEnd) { break; }
+		char c = *p;
+		if (c == '[')
+		{
+			nLevel++;
+			nMaxLevel = std::max(nMaxLevel, nLevel);
+			p++;
+		}
+		else if (c == ']')
+		{
+			nLevel--;
+			p++;
+			if (bInPolyline && nLevel < nMaxLevel - 1)
+			{
+				chunk->EndPolyline(false);
+				bInPolyline = false;
+			}
+			if (nLevel == 0) { break; }
+		}
+		else if (c == ',')
+		{
+			p++;
+		}
+		else
+		{
+			// A position, extra ordinates such as the altitude are skipped
+			olc::vd2d vPoint;
+			if (!ReadNumber(&p, pEnd, &vPoint.x)) { break; }
+			p = SkipSpace(p, pEnd);
+			if (p < pEnd && *p == ',') { p++; }
+			if (!ReadNumber(&p, pEnd, &vPoint.y)) { break; }
+			while (p < pEnd && *p != ']')
+			{
+				double fExtra;
+				p = SkipSpace(p, pEnd);
+				if (p < pEnd && *p == ',') { p++; }
+				if (!ReadNumber(&p, pEnd, &fExtra)) { break; }
+			}
+			if (!bInPolyline)
+			{
+				chunk->BeginPolyline();
+				bInPolyline = true;
+			}
+			chunk->AddPoint(vPoint);
+			nMaxLevel = nLevel;
+		}
+	}
+	if (bInPolyline) { chunk->EndPolyline(false); }
+	return p;
+}
+
+// Parse the geometries of a GeoJSON chunk. The objects are tracked with a stack, so the keys of a geometry can
+// come in any order and chunks can start in the middle of a feature.
+static void ParseGeoJsonChunk(const char* p, const char* pEnd, GeoChunk* chunk)
+{
+	struct JsonObject
+	{
+		std::string sType;
+		size_t nPolylineStart = 0;
+		bool bHasCoordinates = false;
+	};
+	std::vector<JsonObject> objects;
+
+	while (p < pEnd)
+	{
+		char c = *p;
+		if (c == '{')
+		{
+			objects.push_back(JsonObject());
+			p++;
+		}
+		else if (c == '}')
+		{
+			// A closed geometry keeps its polylines, lines stay open and rings are closed by their last point
+			if (!objects.empty())
+			{
+				JsonObject& object = objects.back();
+				bool bLines = object.sType == "LineString" || object.sType == "MultiLineString";
+				bool bRings = object.sType == "Polygon" || object.sType == "MultiPolygon";
+				if (object.bHasCoordinates && !bLines && !bRings)
+				{
+					// Points and unknown geometries are removed again
+					chunk->points.resize(object.nPolylineStart == chunk->polylineStarts.size() ? chunk->points.size() : chunk->polylineStarts[object.nPolylineStart]);
+					chunk->polylineStarts.resize(object.nPolylineStart);
+					chunk->polylineClosed.resize(object.nPolylineStart);
+				}
+				else if (object.bHasCoordinates)
+				{
+					chunk->nFeatures += 1;
+				}
+				objects.pop_back();
+			}
+			p++;
+		}
+		else if (c == '"')
+		{
+			const char* pKeyEnd = SkipString(p, pEnd);
+			std::string sKey(p + 1, pKeyEnd > p + 1 ? pKeyEnd - 1 : p + 1);
+			const char* q = SkipSpace(pKeyEnd, pEnd);
+			p = pKeyEnd;
+			if (q >= pEnd || *q != ':' || objects.empty()) { continue; }
+			q = SkipSpace(q + 1, pEnd);
+			if (sKey == "type" && q < pEnd && *q == '"')
+			{
+				const char* pValueEnd = SkipString(q, pEnd);
+				objects.back().sType.assign(q + 1, pValueEnd > q + 1 ? pValueEnd - 1 : q + 1);
+				p = pValueEnd;
+			}
+			else if (sKey == "coordinates" && q < pEnd && *q == '[')
+			{
+				JsonObject& object = objects.back();
+				object.nPolylineStart = chunk->polylineStarts.size();
+				p = ParseCoordinates(q, pEnd, chunk);
+				object.bHasCoordinates = true;
+			}
+		}
+		else
+		{
+			p++;
+		}
+	}
+}
+
+// Chunk boundaries at the starts of features, the first feature after each of the evenly spaced target positions.
+// A feature starts with a "{" outside of strings whose container is the top-level array, either the root or the
+// "features" array of the root object. Braces inside strings, e.g. in the properties, are never chosen.
+static void FindGeoJsonBoundaries(const std::string& data, const int& nTargetChunks, std::vector<size_t>* boundaries)
+{
+	std::vector<char> containers;
+	int nNext = 1;
+	size_t nTarget = data.size() / size_t(nTargetChunks);
+	for (size_t i = 0; i < data.size() && nNext < nTargetChunks; i++)
+	{
+		char c = data[i];
+		if (c == '"')
+		{
+			// Skip the string, escaped characters included
+			for (i++; i < data.size() && data[i] != '"'; i++)
+			{
+				if (data[i] == '\\') { i++; }
+			}
+		}
+		else if (c == '{' || c == '[')
+		{
+			if (c == '{' && i >= nTarget && containers.size() <= 2 && !containers.empty() && containers.back() == '[')
+			{
+				boundaries->push_back(i);
+				while (nNext < nTargetChunks && nTarget <= i)
+				{
+					nNext += 1;
+					nTarget = data.size() / size_t(nTargetChunks) * size_t(nNext);
+				}
+			}
+			containers.push_back(c);
+		}
+		else if ((c == '}' || c == ']') && !containers.empty())
+		{
+			containers.pop_back();
+		}
+	}
+}
+
+// O------------------------------------------------------------------------------O
+// | WKT                                                                          |
+// O------------------------------------------------------------------------------O
+
+// Check for a keyword without regard to case
+static bool MatchKeyword(const char* p, const char* pEnd, const char* sKeyword)
+{
+	size_t nLength = std::strlen(sKeyword);
+	if (size_t(pEnd - p) < nLength) { return false; }
+	for (size_t i = 0; i < nLength; i++)
+	{
+		if (std::toupper(static_cast<unsigned char>(p[i])) != sKeyword[i]) { return false; }
+	}
+	return true;
+}
+
+// Parse the nested lists of a WKT geometry, every innermost list of coordinates becomes one polyline
+static const char* ParseWktLists(const char* p, const char* pEnd, GeoChunk* chunk, const bool& bClosed)
+{
+	int nLevel = 0;
+	bool bInPolyline = false;
+	while (p < pEnd)
+	{
+		p = SkipSpace(p, pEnd);
+		if (p >= pEnd) { break; }
+		char c = *p;
+		if (c == '(')
+		{
+			nLevel++;
+			p++;
+		}
+		else if (c == ')')
+		{
+			nLevel--;
+			p++;
+			if (bInPolyline)
+			{
+				chunk->EndPolyline(bClosed);
+				bInPolyline = false;
+			}
+			if (nLevel == 0) { break; }
+		}
+		else if (c == ',')
+		{
+			p++;
+		}
+		else if (nLevel == 0)
+		{
+			// "EMPTY" or a dimension such as "Z"
+			if (MatchKeyword(p, pEnd, "EMPTY")) { return p + 5; }
+			p++;
+		}
+		else
+		{
+			// A coordinate tuple, extra ordinates are skipped
+			olc::vd2d vPoint;
+			if (!ReadNumber(&p, pEnd, &vPoint.x) || !ReadNumber(&p, pEnd, &vPoint.y)) { break; }
+			double fExtra;
+			const char* q = p;
+			while (ReadNumber(&q, pEnd, &fExtra)) { p = q; }
+			if (!bInPolyline)
+			{
+				chunk->BeginPolyline();
+				bInPolyline = true;
+			}
+			chunk->AddPoint(vPoint);
+		}
+	}
+	if (bInPolyline) { chunk->EndPolyline(bClosed); }
+	return p;
+}
+
+// Parse the geometries of a WKT chunk
+static void ParseWktChunk(const char* p, const char* pEnd, GeoChunk* chunk)
+{
+	while (p < pEnd)
+	{
+		if (!std::isalpha(static_cast<unsigned char>(*p)))
+		{
+			p++;
+			continue;
+		}
+		// Polygon rings repeat their first point, so all polylines are stored open
+		size_t nPolylines = chunk->polylineStarts.size();
+		if (MatchKeyword(p, pEnd, "MULTILINESTRING"))   { p = ParseWktLists(p + 15, pEnd, chunk, false); }
+		else if (MatchKeyword(p, pEnd, "LINESTRING"))   { p = ParseWktLists(p + 10, pEnd, chunk, false); }
+		else if (MatchKeyword(p, pEnd, "MULTIPOLYGON")) { p = ParseWktLists(p + 12, pEnd, chunk, false); }
+		else if (MatchKeyword(p, pEnd, "POLYGON"))      { p = ParseWktLists(p + 7, pEnd, chunk, false); }
+		else
+		{
+			while (p < pEnd && std::isalpha(static_cast<unsigned char>(*p))) { p++; }
+		}
+		if (chunk->polylineStarts.size() > nPolylines) { chunk->nFeatures += 1; }
+	}
+}
+
+// Move a chunk boundary forward to the start of the next line
+static size_t FindWktBoundary(const std::string& data, size_t nPosition)
+{
+	size_t nLine = data.find('\n', nPosition);
+	return nLine == std::string::npos ? data.size() : nLine + 1;
+}
+
+
+// O------------------------------------------------------------------------------O
+// | IMPORT                                                                       |
+// O------------------------------------------------------------------------------O
+
+// Import the line geometry of a GeoJSON file or of a WKT dump
+bool ImportGeo(const std::string& sPath, GeometryTransaction* transaction, const GeoImportOptions& options, GeoImportStats* stats)
+{
+	// Read the file at once, the chunks are views into it
+	FILE* file = std::fopen(sPath.c_str(), "rb");
+	if (!file) { return false; }
+	std::string data;
+	std::fseek(file, 0, SEEK_END);
+	long nSize = std::ftell(file);
+	std::fseek(file, 0, SEEK_SET);
+	data.resize(nSize > 0 ? size_t(nSize) : 0);
+	size_t nRead = data.empty() ? 0 : std::fread(&data[0], 1, data.size(), file);
+	std::fclose(file);
+	if (nRead != data.size()) { return false; }
+
+	int nThreads = options.nThreads > 0 ? options.nThreads : std::max(int(std::thread::hardware_concurrency()), 1);
+	size_t nFirst = data.find_first_not_of(" \t\r\n");
+	bool bJson = nFirst != std::string::npos && (data[nFirst] == '{' || data[nFirst] == '[');
+
+	// Chunk boundaries at feature starts, a few chunks per thread balance the load
+	int nTargetChunks = std::max(1, std::min(nThreads * 4, int(data.size() / (1 << 16)) + 1));
+	std::vector<size_t> boundaries = { 0 };
+	if (bJson)
+	{
+		FindGeoJsonBoundaries(data, nTargetChunks, &boundaries);
+	}
+	for (int i = 1; i < nTargetChunks && !bJson; i++)
+	{
+		size_t nPosition = std::max(data.size() * i / nTargetChunks, boundaries.back());
+		nPosition = FindWktBoundary(data, nPosition);
+		if (nPosition > boundaries.back() && nPosition < data.size()) { boundaries.push_back(nPosition); }
+	}
+	boundaries.push_back(data.size());
+	int nChunks = int(boundaries.size()) - 1;
+
+	// Parse the chunks in parallel
+	std::vector<GeoChunk> chunks(nChunks);
+	ParallelFor(nChunks, nThreads, [&](int i)
+	{
+		const char* pStart = data.data() + boundaries[i];
+		const char* pEnd = data.data() + boundaries[i + 1];
+		if (bJson) { ParseGeoJsonChunk(pStart, pEnd, &chunks[i]); }
+		else       { ParseWktChunk(pStart, pEnd, &chunks[i]); }
+		chunks[i].polylineStarts.push_back(uint32_t(chunks[i].points.size()));
+	});
+	data.clear();
+	data.shrink_to_fit();
+
+	// The origin is kept in double precision, only the offsets from it are rounded to float
+	olc::vd2d vMin = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+	olc::vd2d vMax = -vMin;
+	for (int i = 0; i < nChunks; i++)
+	{
+		if (chunks[i].points.empty()) { continue; }
+		vMin = vMin.min(chunks[i].vMin);
+		vMax = vMax.max(chunks[i].vMax);
+	}
+	olc::vd2d vOrigin = options.vOrigin;
+	if (options.bAutoOrigin) { vOrigin = vMin.x <= vMax.x ? 0.5 * (vMin + vMax) : olc::vd2d{ 0.0, 0.0 }; }
+	double fMetresPerDegree = fEarthRadius * 3.14159265358979323846 / 180.0;
+	double fLongitudeScale = fMetresPerDegree * std::cos(vOrigin.y * 3.14159265358979323846 / 180.0);
+
+	// Project the points and compute their weld keys
+	float fInverseWeld = 1.0f / std::max(options.fWeldDistance, 1e-9f);
+	std::vector<std::vector<std::vector<std::pair<uint64_t, uint64_t>>>> bucketKeys(nChunks); // Per chunk and bucket: key, point
+	ParallelFor(nChunks, nThreads, [&](int i)
+	{
+		GeoChunk& chunk = chunks[i];
+		chunk.localPoints.resize(chunk.points.size());
+		bucketKeys[i].resize(nWeldBuckets);
+		for (size_t j = 0; j < chunk.points.size(); j++)
+		{
+			olc::vd2d vOffset = chunk.points[j] - vOrigin;
+			if (options.bGeographic) { vOffset = { vOffset.x * fLongitudeScale, vOffset.y * fMetresPerDegree }; }
+			olc::vf2d vLocal = { float(vOffset.x), float(vOffset.y) };
+			chunk.localPoints[j] = vLocal;
+			int64_t cx = int64_t(std::floor(vLocal.x * fInverseWeld));
+			int64_t cy = int64_t(std::floor(vLocal.y * fInverseWeld));
+			uint64_t nKey = (uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy));
+			uint64_t nHash = nKey * 0x9E3779B97F4A7C15ull;
+			bucketKeys[i][nHash >> 58].push_back({ nKey, (uint64_t(i) << 32) | uint64_t(j) });
+		}
+		std::vector<olc::vd2d>().swap(chunk.points);
+	});
+
+	// Weld each bucket on its own, the first point of every cell becomes the node
+	std::vector<std::vector<std::pair<uint64_t, uint64_t>>> buckets(nWeldBuckets);
+	std::vector<std::vector<uint64_t>> bucketNodes(nWeldBuckets); // Point of each node in the bucket
+	ParallelFor(nWeldBuckets, nThreads, [&](int b)
+	{
+		std::vector<std::pair<uint64_t, uint64_t>>& bucket = buckets[b];
+		for (int i = 0; i < nChunks; i++)
+		{
+			bucket.insert(bucket.end(), bucketKeys[i][b].begin(), bucketKeys[i][b].end());
+			std::vector<std::pair<uint64_t, uint64_t>>().swap(bucketKeys[i][b]);
+		}
+		std::sort(bucket.begin(), bucket.end());
+		for (size_t j = 0; j < bucket.size(); j++)
+		{
+			if (j == 0 || bucket[j].first != bucket[j - 1].first) { bucketNodes[b].push_back(bucket[j].second); }
+		}
+	});
+	std::vector<int32_t> bucketOffsets(nWeldBuckets + 1, 0);
+	for (int b = 0; b < nWeldBuckets; b++)
+	{
+		bucketOffsets[b + 1] = bucketOffsets[b] + int32_t(bucketNodes[b].size());
+	}
+	for (int i = 0; i < nChunks; i++)
+	{
+		chunks[i].pointNodes.resize(chunks[i].localPoints.size());
+	}
+	ParallelFor(nWeldBuckets, nThreads, [&](int b)
+	{
+		int32_t nNode = bucketOffsets[b] - 1;
+		for (size_t j = 0; j < buckets[b].size(); j++)
+		{
+			if (j == 0 || buckets[b][j].first != buckets[b][j - 1].first) { nNode += 1; }
+			uint64_t nPoint = buckets[b][j].second;
+			chunks[nPoint >> 32].pointNodes[nPoint & 0xFFFFFFFFull] = nNode;
+		}
+		std::vector<std::pair<uint64_t, uint64_t>>().swap(buckets[b]);
+	});
+
+	// Add the nodes and the segments, each segment once
+	std::vector<NodeHandle> nodeHandles(bucketOffsets.back());
+	for (int b = 0; b < nWeldBuckets; b++)
+	{
+		for (size_t j = 0; j < bucketNodes[b].size(); j++)
+		{
+			uint64_t nPoint = bucketNodes[b][j];
+			nodeHandles[bucketOffsets[b] + j] = transaction->AddNode(chunks[nPoint >> 32].localPoints[nPoint & 0xFFFFFFFFull]);
+		}
+	}
+	int nSegments = 0;
+	int nFeatures = 0;
+	for (int i = 0; i < nChunks; i++)
+	{
+		const GeoChunk& chunk = chunks[i];
+		nFeatures += chunk.nFeatures;
+		for (size_t k = 0; k + 1 < chunk.polylineStarts.size(); k++)
+		{
+			uint32_t nStart = chunk.polylineStarts[k];
+			uint32_t nEnd = chunk.polylineStarts[k + 1];
+			for (uint32_t j = nStart; j + 1 < nEnd; j++)
+			{
+				int32_t a = chunk.pointNodes[j];
+				int32_t b = chunk.pointNodes[j + 1];
+				if (a != b && transaction->AddSegment(nodeHandles[a], nodeHandles[b]).nSlot != -1) { nSegments += 1; }
+			}
+			int32_t a = chunk.pointNodes[nEnd - 1];
+			int32_t b = chunk.pointNodes[nStart];
+			if (chunk.polylineClosed[k] && a != b && transaction->AddSegment(nodeHandles[a], nodeHandles[b]).nSlot != -1) { nSegments += 1; }
+		}
+	}
+
+	if (stats)
+	{
+		stats->nFeatures = nFeatures;
+		stats->nNodes = int(nodeHandles.size());
+		stats->nSegments = nSegments;
+		stats->vOrigin = vOrigin;
+	}
+	return true;
+}
@@ -0,0 +1,740 @@
+#include "olcPixelGameEngine.h"
+#include "geometry_store.h"
+#include "custom_functions.h"
+
+
+// Grow the capacity to at least "nNeeded" elements, at least doubling it so that repeated batches stay linear
+template <typename T>
+static void GrowCapacity(std::vector<T>* storage, const size_t& nNeeded)
+{
+	if (nNeeded > storage->capacity())
+	{
+		storage->reserve(std::max(nNeeded, 2 * storage->capacity()));
+	}
+}
+
+// Allocate a slot from the free list or at the end of the storage
+int32_t GeometryStore::AllocateSlot(std::vector<int32_t>* freeSlots, const int32_t& nSlotCount)
+{
+	if (freeSlots->empty())
+	{
+		return nSlotCount;
+	}
+	int32_t nSlot = freeSlots->back();
+	freeSlots->pop_back();
+	return nSlot;
+}
+
+// Insert a segment slot in the connection lists of its nodes
+void GeometryStore::LinkSegment(const int32_t& nSegmentSlot)
+{
+	for (int k = 0; k < 2; k++)
+	{
+		int32_t nNodeSlot = segmentNodes[nSegmentSlot][k].nSlot;
+		segmentNextSegment[nSegmentSlot][k] = nodeFirstSegment[nNodeSlot];
+		nodeFirstSegment[nNodeSlot] = nSegmentSlot;
+	}
+}
+
+// Remove a segment slot from the connection lists of its nodes
+void GeometryStore::UnlinkSegment(const int32_t& nSegmentSlot)
+{
+	for (int k = 0; k < 2; k++)
+	{
+		int32_t nNodeSlot = segmentNodes[nSegmentSlot][k].nSlot;
+
+		// Walk the list of the node until the link that points to the segment
+		int32_t* pLink = &nodeFirstSegment[nNodeSlot];
+		while (*pLink != nSegmentSlot)
+		{
+			int32_t nCurrent = *pLink;
+			pLink = &segmentNextSegment[nCurrent][segmentNodes[nCurrent][0].nSlot == nNodeSlot ? 0 : 1];
+		}
+		*pLink = segmentNextSegment[nSegmentSlot][k];
+	}
+}
+
+// Direction independent key of a node pair
+uint64_t GeometryStore::SegmentKey(const int32_t& nStartSlot, const int32_t& nEndSlot)
+{
+	return (uint64_t(uint32_t(std::min(nStartSlot, nEndSlot))) << 32) | uint64_t(uint32_t(std::max(nStartSlot, nEndSlot)));
+}
+
+// Grow the dirty region by a point
+void GeometryStore::ExpandDirtyRegion(const olc::vf2d& vPoint)
+{
+	if (!bDirty)
+	{
+		vDirtyMin = vPoint;
+		vDirtyMax = vPoint;
+		bDirty = true;
+		return;
+	}
+	vDirtyMin = vDirtyMin.min(vPoint);
+	vDirtyMax = vDirtyMax.max(vPoint);
+}
+
+// Make the dirty region unbounded
+void GeometryStore::ExpandDirtyRegionToAll()
+{
+	vDirtyMin = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+	vDirtyMax = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	bDirty = true;
+}
+
+// Defer the spatial index updates until the outermost batch ends
+void GeometryStore::BeginDeferredIndexing()
+{
+	nDeferredDepth += 1;
+}
+
+// Insert every node and segment that changed during the batch, each of them once
+void GeometryStore::EndDeferredIndexing()
+{
+	nDeferredDepth -= 1;
+	if (nDeferredDepth > 0) { return; }
+
+	for (int32_t nSlot : dirtyNodes)
+	{
+		nodeIndexDirty[nSlot] = 0;
+		if (nodeAlive[nSlot]) { nodeGrid.Insert(nSlot, nodePositions[nSlot]); }
+	}
+	dirtyNodes.clear();
+	FitNodeGrid();
+
+	for (int32_t nSlot : dirtySegments)
+	{
+		segmentIndexDirty[nSlot] = 0;
+		if (segmentAlive[nSlot]) { InsertSegmentProxy(nSlot); }
+	}
+	dirtySegments.clear();
+}
+
+// Fit the cell size of the node grid again once the number of nodes has doubled or dropped to a quarter since
+// the last fit, which keeps the refits at a constant cost per insertion
+void GeometryStore::FitNodeGrid()
+{
+	int32_t nCount = nodeGrid.GetCount();
+	if (nCount < 2 * std::max(nNodeGridFitCount, 32) && 4 * nCount > nNodeGridFitCount) { return; }
+	nodeGrid.Fit(nodePositions);
+	nNodeGridFitCount = nCount;
+}
+
+// Take a node out of the spatial index until the batch ends
+void GeometryStore::MarkNodeDirty(const int32_t& nNodeSlot)
+{
+	if (nodeIndexDirty[nNodeSlot]) { return; }
+	nodeIndexDirty[nNodeSlot] = 1;
+	dirtyNodes.push_back(nNodeSlot);
+	if (nodeAlive[nNodeSlot]) { nodeGrid.Remove(nNodeSlot, nodePositions[nNodeSlot]); }
+}
+
+// Take a segment out of the spatial index until the batch ends
+void GeometryStore::MarkSegmentDirty(const int32_t& nSegmentSlot)
+{
+	if (segmentIndexDirty[nSegmentSlot]) { return; }
+	segmentIndexDirty[nSegmentSlot] = 1;
+	dirtySegments.push_back(nSegmentSlot);
+	if (segmentProxy[nSegmentSlot] != -1)
+	{
+		segmentTree.Remove(segmentProxy[nSegmentSlot]);
+		segmentProxy[nSegmentSlot] = -1;
+	}
+}
+
+// Insert a segment slot into the segment tree
+void GeometryStore::InsertSegmentProxy(const int32_t& nSegmentSlot)
+{
+	const olc::vf2d& vStart = nodePositions[segmentNodes[nSegmentSlot][0].nSlot];
+	const olc::vf2d& vEnd = nodePositions[segmentNodes[nSegmentSlot][1].nSlot];
+	segmentProxy[nSegmentSlot] = segmentTree.Insert(vStart.min(vEnd), vStart.max(vEnd), nSegmentSlot);
+}
+
+// Refit the box of a segment slot after one of its nodes moved
+void GeometryStore::UpdateSegmentProxy(const int32_t& nSegmentSlot)
+{
+	const olc::vf2d& vStart = nodePositions[segmentNodes[nSegmentSlot][0].nSlot];
+	const olc::vf2d& vEnd = nodePositions[segmentNodes[nSegmentSlot][1].nSlot];
+	segmentTree.Update(segmentProxy[nSegmentSlot], vStart.min(vEnd), vStart.max(vEnd));
+}
+
+// Release a segment slot that is already unlinked
+void GeometryStore::ReleaseSegment(const int32_t& nSegmentSlot)
+{
+	if (segmentProxy[nSegmentSlot] != -1)
+	{
+		segmentTree.Remove(segmentProxy[nSegmentSlot]);
+		segmentProxy[nSegmentSlot] = -1;
+	}
+	segmentLookup.erase(SegmentKey(segmentNodes[nSegmentSlot][0].nSlot, segmentNodes[nSegmentSlot][1].nSlot));
+	ExpandDirtyRegion(nodePositions[segmentNodes[nSegmentSlot][0].nSlot]);
+	ExpandDirtyRegion(nodePositions[segmentNodes[nSegmentSlot][1].nSlot]);
+	nSegmentVersion += 1;
+	segmentAlive[nSegmentSlot] = 0;
+	segmentFreeSlots.push_back(nSegmentSlot);
+	nSegmentCount -= 1;
+	bPackedDirty = true;
+}
+
+// Add a node
+NodeHandle GeometryStore::AddNode(const olc::vf2d& vPosition)
+{
+	int32_t nSlot = AllocateSlot(&nodeFreeSlots, int32_t(nodePositions.size()));
+	if (nSlot == nodePositions.size())
+	{
+		nodePositions.push_back(vPosition);
+		nodeGenerations.push_back(0);
+		nodeAlive.push_back(0);
+		nodeFirstSegment.push_back(-1);
+		nodeIndexDirty.push_back(0);
+	}
+	nodePositions[nSlot] = vPosition;
+	nodeGenerations[nSlot] = nNextGeneration++;
+	nodeFirstSegment[nSlot] = -1;
+	if (nDeferredDepth > 0)
+	{
+		MarkNodeDirty(nSlot);
+	}
+	else
+	{
+		nodeGrid.Insert(nSlot, vPosition);
+		FitNodeGrid();
+	}
+	nodeAlive[nSlot] = 1;
+	nNodeCount += 1;
+	nNodeVersion += 1;
+	ExpandDirtyRegion(vPosition);
+	bPackedDirty = true;
+	return { nSlot, nodeGenerations[nSlot] };
+}
+
+// Move a node
+bool GeometryStore::MoveNode(const NodeHandle& hNode, const olc::vf2d& vPosition)
+{
+	if (!IsValid(hNode)) { return false; }
+
+	// The old and the new position and the far ends of the connected segments are dirty
+	nNodeVersion += 1;
+	ExpandDirtyRegion(nodePositions[hNode.nSlot]);
+	ExpandDirtyRegion(vPosition);
+	for (int32_t s = nodeFirstSegment[hNode.nSlot]; s != -1; s = segmentNextSegment[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 0 : 1])
+	{
+		ExpandDirtyRegion(nodePositions[segmentNodes[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 1 : 0].nSlot]);
+	}
+
+	// Inside a batch the node and its segments leave the indices until the batch ends
+	if (nDeferredDepth > 0)
+	{
+		MarkNodeDirty(hNode.nSlot);
+		nodePositions[hNode.nSlot] = vPosition;
+		for (int32_t s = nodeFirstSegment[hNode.nSlot]; s != -1; s = segmentNextSegment[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 0 : 1])
+		{
+			MarkSegmentDirty(s);
+		}
+	}
+	else
+	{
+		// Connected segments only get a new box once they leave their fat box
+		nodeGrid.Move(hNode.nSlot, nodePositions[hNode.nSlot], vPosition);
+		nodePositions[hNode.nSlot] = vPosition;
+		for (int32_t s = nodeFirstSegment[hNode.nSlot]; s != -1; s = segmentNextSegment[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 0 : 1])
+		{
+			UpdateSegmentProxy(s);
+		}
+	}
+
+	// Moving does not change the topology, the packed view is patched in place
+	if (!bPackedDirty)
+	{
+		packedNodes[nodeSlotToPacked[hNode.nSlot]] = vPosition;
+	}
+	return true;
+}
+
+// Delete a node together with its connected segments
+bool GeometryStore::DeleteNode(const NodeHandle& hNode)
+{
+	if (!IsValid(hNode)) { return false; }
+	while (nodeFirstSegment[hNode.nSlot] != -1)
+	{
+		int32_t nSegmentSlot = nodeFirstSegment[hNode.nSlot];
+		UnlinkSegment(nSegmentSlot);
+		ReleaseSegment(nSegmentSlot);
+	}
+	if (!nodeIndexDirty[hNode.nSlot])
+	{
+		nodeGrid.Remove(hNode.nSlot, nodePositions[hNode.nSlot]);
+		FitNodeGrid();
+	}
+	nNodeVersion += 1;
+	ExpandDirtyRegion(nodePositions[hNode.nSlot]);
+	nodeAlive[hNode.nSlot] = 0;
+	nodeFreeSlots.push_back(hNode.nSlot);
+	nNodeCount -= 1;
+	bPackedDirty = true;
+	return true;
+}
+
+// Add a segment between two different nodes
+SegmentHandle GeometryStore::AddSegment(const NodeHandle& hStart, const NodeHandle& hEnd)
+{
+	if (!IsValid(hStart) || !IsValid(hEnd) || hStart == hEnd) { return {}; }
+
+	// The lookup insertion doubles as the duplicate check
+	auto inserted = segmentLookup.emplace(SegmentKey(hStart.nSlot, hEnd.nSlot), -1);
+	if (!inserted.second) { return {}; }
+
+	int32_t nSlot = AllocateSlot(&segmentFreeSlots, int32_t(segmentNodes.size()));
+	if (nSlot == segmentNodes.size())
+	{
+		segmentNodes.push_back({ hStart, hEnd });
+		segmentGenerations.push_back(0);
+		segmentAlive.push_back(0);
+		segmentNextSegment.push_back({ -1, -1 });
+		segmentProxy.push_back(-1);
+		segmentIndexDirty.push_back(0);
+	}
+	segmentNodes[nSlot] = { hStart, hEnd };
+	segmentGenerations[nSlot] = nNextGeneration++;
+	segmentAlive[nSlot] = 1;
+	LinkSegment(nSlot);
+	if (nDeferredDepth > 0)
+	{
+		MarkSegmentDirty(nSlot);
+	}
+	else
+	{
+		InsertSegmentProxy(nSlot);
+	}
+	inserted.first->second = nSlot;
+	nSegmentCount += 1;
+	nSegmentVersion += 1;
+	ExpandDirtyRegion(nodePositions[hStart.nSlot]);
+	ExpandDirtyRegion(nodePositions[hEnd.nSlot]);
+	bPackedDirty = true;
+	return { nSlot, segmentGenerations[nSlot] };
+}
+
+// Add many segments at once, skipping invalid ones and duplicates
+int GeometryStore::AddSegments(const std::vector<std::array<NodeHandle, 2>>& newSegments, std::vector<SegmentHandle>* handles)
+{
+	// Grow the storage and the lookup once for the whole batch
+	size_t nNeeded = segmentNodes.size() + newSegments.size();
+	GrowCapacity(&segmentNodes, nNeeded);
+	GrowCapacity(&segmentGenerations, nNeeded);
+	GrowCapacity(&segmentAlive, nNeeded);
+	GrowCapacity(&segmentNextSegment, nNeeded);
+	GrowCapacity(&segmentProxy, nNeeded);
+	GrowCapacity(&segmentIndexDirty, nNeeded);
+	size_t nLookupNeeded = segmentLookup.size() + newSegments.size();
+	if (float(nLookupNeeded) > segmentLookup.max_load_factor() * float(segmentLookup.bucket_count()))
+	{
+		segmentLookup.reserve(std::max(nLookupNeeded, 2 * segmentLookup.size()));
+	}
+	if (handles) { handles->resize(newSegments.size()); }
+
+	int nAdded = 0;
+	for (int i = 0; i < newSegments.size(); i++)
+	{
+		SegmentHandle hSegment = AddSegment(newSegments[i][0], newSegments[i][1]);
+		if (handles) { (*handles)[i] = hSegment; }
+		if (hSegment.nSlot != -1) { nAdded += 1; }
+	}
+	return nAdded;
+}
+
+// Find the segment that connects two nodes in either direction
+SegmentHandle GeometryStore::FindSegment(const NodeHandle& hStart, const NodeHandle& hEnd) const
+{
+	if (!IsValid(hStart) || !IsValid(hEnd)) { return {}; }
+	auto it = segmentLookup.find(SegmentKey(hStart.nSlot, hEnd.nSlot));
+	if (it == segmentLookup.end()) { return {}; }
+	return { it->second, segmentGenerations[it->second] };
+}
+
+// Delete a segment
+bool GeometryStore::DeleteSegment(const SegmentHandle& hSegment)
+{
+	if (!IsValid(hSegment)) { return false; }
+	UnlinkSegment(hSegment.nSlot);
+	ReleaseSegment(hSegment.nSlot);
+	return true;
+}
+
+// Replace the whole geometry
+void GeometryStore::Assign(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments)
+{
+	BeginDeferredIndexing();
+	Clear();
+	Reserve(int(nodes.size()), int(segments.size()));
+	std::vector<NodeHandle> handles(nodes.size());
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		handles[i] = AddNode(nodes[i]);
+	}
+	std::vector<std::array<NodeHandle, 2>> newSegments(segments.size());
+	for (int i = 0; i < segments.size(); i++)
+	{
+		newSegments[i] = { handles[segments[i][0]], handles[segments[i][1]] };
+	}
+	AddSegments(newSegments);
+	EndDeferredIndexing();
+}
+
+// Delete all nodes and segments
+void GeometryStore::Clear()
+{
+	nodePositions.clear();
+	nodeGenerations.clear();
+	nodeAlive.clear();
+	nodeFirstSegment.clear();
+	nodeFreeSlots.clear();
+	nodeGrid.Clear();
+	nNodeGridFitCount = 0;
+	nodeIndexDirty.clear();
+	dirtyNodes.clear();
+	nNodeCount = 0;
+
+	segmentNodes.clear();
+	segmentGenerations.clear();
+	segmentAlive.clear();
+	segmentNextSegment.clear();
+	segmentFreeSlots.clear();
+	segmentLookup.clear();
+	segmentTree.Clear();
+	segmentProxy.clear();
+	segmentIndexDirty.clear();
+	dirtySegments.clear();
+	nSegmentCount = 0;
+
+	nNodeVersion += 1;
+	nSegmentVersion += 1;
+	ExpandDirtyRegionToAll();
+	bPackedDirty = true;
+}
+
+// Reserve memory for nodes and segments
+void GeometryStore::Reserve(const int& nNodes, const int& nSegments)
+{
+	GrowCapacity(&nodePositions, size_t(nNodes));
+	GrowCapacity(&nodeGenerations, size_t(nNodes));
+	GrowCapacity(&nodeAlive, size_t(nNodes));
+	GrowCapacity(&nodeFirstSegment, size_t(nNodes));
+	GrowCapacity(&nodeIndexDirty, size_t(nNodes));
+	GrowCapacity(&packedNodes, size_t(nNodes));
+
+	GrowCapacity(&segmentNodes, size_t(nSegments));
+	GrowCapacity(&segmentGenerations, size_t(nSegments));
+	GrowCapacity(&segmentAlive, size_t(nSegments));
+	GrowCapacity(&segmentNextSegment, size_t(nSegments));
+	GrowCapacity(&segmentProxy, size_t(nSegments));
+	GrowCapacity(&segmentIndexDirty, size_t(nSegments));
+	GrowCapacity(&packedSegments, size_t(nSegments));
+}
+
+// Check if a handle refers to an existing node
+bool GeometryStore::IsValid(const NodeHandle& hNode) const
+{
+	return hNode.nSlot >= 0 && hNode.nSlot < nodePositions.size() &&
+		nodeAlive[hNode.nSlot] && nodeGenerations[hNode.nSlot] == hNode.nGeneration;
+}
+
+// Check if a handle refers to an existing segment
+bool GeometryStore::IsValid(const SegmentHandle& hSegment) const
+{
+	return hSegment.nSlot >= 0 && hSegment.nSlot < segmentNodes.size() &&
+		segmentAlive[hSegment.nSlot] && segmentGenerations[hSegment.nSlot] == hSegment.nGeneration;
+}
+
+// Position of a node
+const olc::vf2d& GeometryStore::GetNodePosition(const NodeHandle& hNode) const
+{
+	return nodePositions[hNode.nSlot];
+}
+
+// End nodes of a segment
+std::array<NodeHandle, 2> GeometryStore::GetSegmentNodes(const SegmentHandle& hSegment) const
+{
+	return segmentNodes[hSegment.nSlot];
+}
+
+// Number of segments connected to a node
+int GeometryStore::GetNodeDegree(const NodeHandle& hNode) const
+{
+	if (!IsValid(hNode)) { return 0; }
+	int nDegree = 0;
+	for (int32_t s = nodeFirstSegment[hNode.nSlot]; s != -1; s = segmentNextSegment[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 0 : 1])
+	{
+		nDegree += 1;
+	}
+	return nDegree;
+}
+
+// Segments connected to a node
+void GeometryStore::GetConnectedSegments(const NodeHandle& hNode, std::vector<SegmentHandle>* connectedSegments) const
+{
+	connectedSegments->clear();
+	if (!IsValid(hNode)) { return; }
+	for (int32_t s = nodeFirstSegment[hNode.nSlot]; s != -1; s = segmentNextSegment[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 0 : 1])
+	{
+		connectedSegments->push_back({ s, segmentGenerations[s] });
+	}
+}
+
+// Nodes at the other end of the connected segments
+void GeometryStore::GetNeighbourNodes(const NodeHandle& hNode, std::vector<NodeHandle>* neighbourNodes) const
+{
+	neighbourNodes->clear();
+	if (!IsValid(hNode)) { return; }
+	for (int32_t s = nodeFirstSegment[hNode.nSlot]; s != -1; s = segmentNextSegment[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 0 : 1])
+	{
+		neighbourNodes->push_back(segmentNodes[s][segmentNodes[s][0].nSlot == hNode.nSlot ? 1 : 0]);
+	}
+}
+
+// Find the closest node within "fMaxDistance"
+NodeHandle GeometryStore::FindNearestNode(const olc::vf2d& vPoint, const float& fMaxDistance, float* squaredDistance) const
+{
+	int32_t nSlot = nodeGrid.FindNearest(vPoint, fMaxDistance, nodePositions, squaredDistance);
+	if (nSlot == -1) { return {}; }
+	return { nSlot, nodeGenerations[nSlot] };
+}
+
+// Find all nodes within a radius
+void GeometryStore::FindNodesInRadius(const olc::vf2d& vPoint, const float& fRadius, std::vector<NodeHandle>* foundNodes) const
+{
+	nodeGrid.FindInRadius(vPoint, fRadius, nodePositions, &querySlots);
+	foundNodes->clear();
+	for (int32_t nSlot : querySlots)
+	{
+		foundNodes->push_back({ nSlot, nodeGenerations[nSlot] });
+	}
+}
+
+// Find all nodes inside an axis aligned box
+void GeometryStore::FindNodesInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<NodeHandle>* foundNodes) const
+{
+	nodeGrid.FindInBox(vMin, vMax, nodePositions, &querySlots);
+	foundNodes->clear();
+	for (int32_t nSlot : querySlots)
+	{
+		foundNodes->push_back({ nSlot, nodeGenerations[nSlot] });
+	}
+}
+
+// Find the closest segment within "fMaxDistance"
+SegmentHandle GeometryStore::FindNearestSegment(const olc::vf2d& vPoint, const float& fMaxDistance, float* squaredDistance) const
+{
+	auto distanceSquared = [&](const int32_t& nSlot)
+	{
+		return EuclideanDistanceToLineSquared(nodePositions[segmentNodes[nSlot][0].nSlot], nodePositions[segmentNodes[nSlot][1].nSlot], vPoint);
+	};
+	int32_t nSlot = segmentTree.FindNearest(vPoint, fMaxDistance, distanceSquared, squaredDistance);
+	if (nSlot == -1) { return {}; }
+	return { nSlot, segmentGenerations[nSlot] };
+}
+
+// Number of existing nodes
+int GeometryStore::GetNodeCount() const
+{
+	return nNodeCount;
+}
+
+// Number of existing segments
+int GeometryStore::GetSegmentCount() const
+{
+	return nSegmentCount;
+}
+
+// Ratio of free slots to all slots
+float GeometryStore::GetFragmentation() const
+{
+	size_t nSlots = nodePositions.size() + segmentNodes.size();
+	if (nSlots == 0) { return 0.0f; }
+	return float(nodeFreeSlots.size() + segmentFreeSlots.size()) / float(nSlots);
+}
+
+// Move all nodes and segments to the front of their storage
+void GeometryStore::Compact(std::vector<NodeHandle>* nodeRemap, std::vector<SegmentHandle>* segmentRemap)
+{
+	// Nodes keep their generation, so the new handles are still unique
+	std::vector<NodeHandle> nodeHandles(nodePositions.size());
+	int32_t nNodeSlots = 0;
+	for (int32_t i = 0; i < nodePositions.size(); i++)
+	{
+		if (!nodeAlive[i]) { continue; }
+		nodePositions[nNodeSlots] = nodePositions[i];
+		nodeGenerations[nNodeSlots] = nodeGenerations[i];
+		nodeAlive[nNodeSlots] = 1;
+		nodeHandles[i] = { nNodeSlots, nodeGenerations[i] };
+		nNodeSlots += 1;
+	}
+
+	// Segments keep their generation as well
+	std::vector<SegmentHandle> segmentHandles(segmentNodes.size());
+	int32_t nSegmentSlots = 0;
+	for (int32_t i = 0; i < segmentNodes.size(); i++)
+	{
+		if (!segmentAlive[i]) { continue; }
+		segmentNodes[nSegmentSlots] = { nodeHandles[segmentNodes[i][0].nSlot], nodeHandles[segmentNodes[i][1].nSlot] };
+		segmentGenerations[nSegmentSlots] = segmentGenerations[i];
+		segmentAlive[nSegmentSlots] = 1;
+		segmentHandles[i] = { nSegmentSlots, segmentGenerations[i] };
+		nSegmentSlots += 1;
+	}
+
+	// Release the unused memory
+	nodePositions.resize(nNodeSlots);
+	nodeGenerations.resize(nNodeSlots);
+	nodeAlive.resize(nNodeSlots);
+	nodeFirstSegment.resize(nNodeSlots);
+	nodeFreeSlots.clear();
+	nodePositions.shrink_to_fit();
+	nodeGenerations.shrink_to_fit();
+	nodeAlive.shrink_to_fit();
+	nodeFirstSegment.shrink_to_fit();
+
+	segmentNodes.resize(nSegmentSlots);
+	segmentGenerations.resize(nSegmentSlots);
+	segmentAlive.resize(nSegmentSlots);
+	segmentNextSegment.resize(nSegmentSlots);
+	segmentProxy.resize(nSegmentSlots);
+	segmentFreeSlots.clear();
+	segmentNodes.shrink_to_fit();
+	segmentGenerations.shrink_to_fit();
+	segmentAlive.shrink_to_fit();
+	segmentNextSegment.shrink_to_fit();
+	segmentProxy.shrink_to_fit();
+
+	// Rebuild the spatial indices for the new slots, this also completes any deferred update
+	nodeIndexDirty.assign(nNodeSlots, 0);
+	dirtyNodes.clear();
+	segmentIndexDirty.assign(nSegmentSlots, 0);
+	dirtySegments.clear();
+	nodeGrid.Clear();
+	for (int32_t i = 0; i < nNodeSlots; i++)
+	{
+		nodeGrid.Insert(i, nodePositions[i]);
+	}
+	FitNodeGrid();
+
+	// Rebuild the connection lists, the lookup and the segment tree for the new slots
+	std::fill(nodeFirstSegment.begin(), nodeFirstSegment.end(), -1);
+	segmentLookup.clear();
+	segmentTree.Clear();
+	for (int32_t i = 0; i < nSegmentSlots; i++)
+	{
+		LinkSegment(i);
+		InsertSegmentProxy(i);
+		segmentLookup[SegmentKey(segmentNodes[i][0].nSlot, segmentNodes[i][1].nSlot)] = i;
+	}
+
+	bPackedDirty = true;
+	if (nodeRemap) { *nodeRemap = std::move(nodeHandles); }
+	if (segmentRemap) { *segmentRemap = std::move(segmentHandles); }
+}
+
+// Version of the nodes
+uint64_t GeometryStore::GetNodeVersion() const
+{
+	return nNodeVersion;
+}
+
+// Version of the segments
+uint64_t GeometryStore::GetSegmentVersion() const
+{
+	return nSegmentVersion;
+}
+
+// Bounding box of everything that changed since the last reset
+bool GeometryStore::GetDirtyRegion(olc::vf2d* vMin, olc::vf2d* vMax) const
+{
+	if (!bDirty) { return false; }
+	*vMin = vDirtyMin;
+	*vMax = vDirtyMax;
+	return true;
+}
+
+// Start a new dirty region
+void GeometryStore::ResetDirtyRegion()
+{
+	bDirty = false;
+}
+
+// Packed view of the nodes
+const std::vector<olc::vf2d>& GeometryStore::GetNodes()
+{
+	UpdatePackedViews();
+	return packedNodes;
+}
+
+// Packed view of the segments
+const std::vector<std::array<int, 2>>& GeometryStore::GetSegments()
+{
+	UpdatePackedViews();
+	return packedSegments;
+}
+
+// Handle of a node in the packed view
+NodeHandle GeometryStore::GetNodeHandle(const int& i_node)
+{
+	UpdatePackedViews();
+	int32_t nSlot = packedNodeSlots[i_node];
+	return { nSlot, nodeGenerations[nSlot] };
+}
+
+// Handle of a segment in the packed view
+SegmentHandle GeometryStore::GetSegmentHandle(const int& i_segment)
+{
+	UpdatePackedViews();
+	int32_t nSlot = packedSegmentSlots[i_segment];
+	return { nSlot, segmentGenerations[nSlot] };
+}
+
+// Index of a node in the packed view, -1 for invalid handles
+int GeometryStore::GetNodeIndex(const NodeHandle& hNode)
+{
+	if (!IsValid(hNode)) { return -1; }
+	UpdatePackedViews();
+	return nodeSlotToPacked[hNode.nSlot];
+}
+
+// Index of a segment in the packed view, -1 for invalid handles
+int GeometryStore::GetSegmentIndex(const SegmentHandle& hSegment)
+{
+	if (!IsValid(hSegment)) { return -1; }
+	UpdatePackedViews();
+	return segmentSlotToPacked[hSegment.nSlot];
+}
+
+// Rebuild the packed views if nodes or segments were added or deleted
+void GeometryStore::UpdatePackedViews()
+{
+	if (!bPackedDirty) { return; }
+
+	// Nodes in slot order
+	packedNodes.clear();
+	packedNodeSlots.clear();
+	nodeSlotToPacked.assign(nodePositions.size(), -1);
+	for (int32_t i = 0; i < nodePositions.size(); i++)
+	{
+		if (!nodeAlive[i]) { continue; }
+		nodeSlotToPacked[i] = int32_t(packedNodes.size());
+		packedNodes.push_back(nodePositions[i]);
+		packedNodeSlots.push_back(i);
+	}
+
+	// Segments in slot order
+	packedSegments.clear();
+	packedSegmentSlots.clear();
+	segmentSlotToPacked.assign(segmentNodes.size(), -1);
+	for (int32_t i = 0; i < segmentNodes.size(); i++)
+	{
+		if (!segmentAlive[i]) { continue; }
+		segmentSlotToPacked[i] = int32_t(packedSegments.size());
+		packedSegments.push_back({ nodeSlotToPacked[segmentNodes[i][0].nSlot], nodeSlotToPacked[segmentNodes[i][1].nSlot] });
+		packedSegmentSlots.push_back(i);
+	}
+
+	bPackedDirty = false;
+}
@@ -0,0 +1,124 @@
+#include "olcPixelGameEngine.h"
+#include "geometry_transaction.h"
+#include "custom_functions.h"
+
+
+GeometryTransaction::GeometryTransaction(GeometryStore* geometry)
+{
+	this->geometry = geometry;
+}
+
+GeometryTransaction::~GeometryTransaction()
+{
+	Commit();
+}
+
+// Start a batch if none is open
+void GeometryTransaction::Open()
+{
+	if (bOpen) { return; }
+	geometry->BeginDeferredIndexing();
+	bOpen = true;
+}
+
+// Add a node
+NodeHandle GeometryTransaction::AddNode(const olc::vf2d& vPosition)
+{
+	Open();
+	NodeHandle hNode = geometry->AddNode(vPosition);
+	edits.push_back({ GeometryEditType::AddNode, hNode, {}, {}, vPosition, vPosition });
+	return hNode;
+}
+
+// Move a node
+bool GeometryTransaction::MoveNode(const NodeHandle& hNode, const olc::vf2d& vPosition)
+{
+	if (!geometry->IsValid(hNode)) { return false; }
+	Open();
+	olc::vf2d vOldPosition = geometry->GetNodePosition(hNode);
+	geometry->MoveNode(hNode, vPosition);
+	edits.push_back({ GeometryEditType::MoveNode, hNode, {}, {}, vOldPosition, vPosition });
+	return true;
+}
+
+// Delete a node together with its connected segments
+bool GeometryTransaction::DeleteNode(const NodeHandle& hNode)
+{
+	if (!geometry->IsValid(hNode)) { return false; }
+	Open();
+	geometry->GetConnectedSegments(hNode, &connectedSegments);
+	for (int i = 0; i < connectedSegments.size(); i++)
+	{
+		DeleteSegment(connectedSegments[i]);
+	}
+	olc::vf2d vPosition = geometry->GetNodePosition(hNode);
+	geometry->DeleteNode(hNode);
+	edits.push_back({ GeometryEditType::DeleteNode, hNode, {}, {}, vPosition, vPosition });
+	return true;
+}
+
+// Add a segment between two different nodes
+SegmentHandle GeometryTransaction::AddSegment(const NodeHandle& hStart, const NodeHandle& hEnd)
+{
+	Open();
+	SegmentHandle hSegment = geometry->AddSegment(hStart, hEnd);
+	if (hSegment.nSlot != -1)
+	{
+		edits.push_back({ GeometryEditType::AddSegment, {}, hSegment, { hStart, hEnd }, {}, {} });
+	}
+	return hSegment;
+}
+
+// Delete a segment
+bool GeometryTransaction::DeleteSegment(const SegmentHandle& hSegment)
+{
+	if (!geometry->IsValid(hSegment)) { return false; }
+	Open();
+	std::array<NodeHandle, 2> segmentNodes = geometry->GetSegmentNodes(hSegment);
+	geometry->DeleteSegment(hSegment);
+	edits.push_back({ GeometryEditType::DeleteSegment, {}, hSegment, segmentNodes, {}, {} });
+	return true;
+}
+
+// Translate many nodes
+void GeometryTransaction::TranslateNodes(const std::vector<NodeHandle>& hNodes, const olc::vf2d& vOffset)
+{
+	for (int i = 0; i < hNodes.size(); i++)
+	{
+		if (geometry->IsValid(hNodes[i])) { MoveNode(hNodes[i], geometry->GetNodePosition(hNodes[i]) + vOffset); }
+	}
+}
+
+// Rotate many nodes around a common center
+void GeometryTransaction::RotateNodes(const std::vector<NodeHandle>& hNodes, const float& fAngle, const olc::vf2d& vRotationCenter)
+{
+	for (int i = 0; i < hNodes.size(); i++)
+	{
+		if (geometry->IsValid(hNodes[i])) { MoveNode(hNodes[i], RotatePoint(geometry->GetNodePosition(hNodes[i]), fAngle, vRotationCenter)); }
+	}
+}
+
+// Delete many nodes
+int GeometryTransaction::DeleteNodes(const std::vector<NodeHandle>& hNodes)
+{
+	int nDeleted = 0;
+	for (int i = 0; i < hNodes.size(); i++)
+	{
+		if (DeleteNode(hNodes[i])) { nDeleted += 1; }
+	}
+	return nDeleted;
+}
+
+// Update the spatial indices
+void GeometryTransaction::Commit()
+{
+	if (!bOpen) { return; }
+	geometry->EndDeferredIndexing();
+	bOpen = false;
+}
+
+// Edits recorded since the transaction was created
+const std::vector<GeometryEdit>& GeometryTransaction::GetEdits() const
+{
+	return edits;
+}
@@ -0,0 +1,235 @@
+#include "olcPixelGameEngine.h"
+#include "node_grid.h"
+
+
+NodeGrid::NodeGrid(const float& fCellSize)
+{
+	Clear(fCellSize);
+}
+
+// Remove all nodes
+void NodeGrid::Clear()
+{
+	cells.clear();
+	nCount = 0;
+}
+
+// Remove all nodes and change the cell size
+void NodeGrid::Clear(const float& fCellSize)
+{
+	this->fCellSize = fCellSize;
+	fInverseCellSize = 1.0f / fCellSize;
+	cells.clear();
+	nCount = 0;
+}
+
+// Cell coordinate of a position. Positions beyond 2^30 cells share the outermost cells, which leaves room for the
+// ring search around them, and a position that is not a number falls into the lowest cell.
+int32_t NodeGrid::CellCoordinate(const float& fValue) const
+{
+	const double fLimit = double(1 << 30);
+	double fCell = std::floor(double(fValue) * double(fInverseCellSize));
+	if (!(fCell > -fLimit)) { return -(1 << 30); }
+	return int32_t(std::min(fCell, fLimit));
+}
+
+// Hash key of a cell
+uint64_t NodeGrid::CellKey(const int32_t& nX, const int32_t& nY)
+{
+	return (uint64_t(uint32_t(nX)) << 32) | uint64_t(uint32_t(nY));
+}
+
+// Insert a node slot
+void NodeGrid::Insert(const int32_t& nSlot, const olc::vf2d& vPosition)
+{
+	cells[CellKey(CellCoordinate(vPosition.x), CellCoordinate(vPosition.y))].push_back(nSlot);
+	nCount += 1;
+}
+
+// Remove a node slot, a cell is erased once it is empty. Dragging within a cell does not remove the node.
+void NodeGrid::Remove(const int32_t& nSlot, const olc::vf2d& vPosition)
+{
+	auto it = cells.find(CellKey(CellCoordinate(vPosition.x), CellCoordinate(vPosition.y)));
+	if (it == cells.end()) { return; }
+	std::vector<int32_t>& cell = it->second;
+	for (int i = 0; i < cell.size(); i++)
+	{
+		if (cell[i] == nSlot)
+		{
+			cell[i] = cell.back();
+			cell.pop_back();
+			if (cell.empty()) { cells.erase(it); }
+			nCount -= 1;
+			return;
+		}
+	}
+}
+
+// Move a node slot, nothing changes while it stays within its cell
+void NodeGrid::Move(const int32_t& nSlot, const olc::vf2d& vOldPosition, const olc::vf2d& vNewPosition)
+{
+	if (CellCoordinate(vOldPosition.x) == CellCoordinate(vNewPosition.x) &&
+		CellCoordinate(vOldPosition.y) == CellCoordinate(vNewPosition.y))
+	{
+		return;
+	}
+	Remove(nSlot, vOldPosition);
+	Insert(nSlot, vNewPosition);
+}
+
+// Choose the cell size from the stored nodes and re-bucket them
+void NodeGrid::Fit(const std::vector<olc::vf2d>& positions)
+{
+	if (nCount == 0) { return; }
+	std::vector<int32_t> slots;
+	slots.reserve(nCount);
+	olc::vf2d vMin = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	olc::vf2d vMax = -vMin;
+	for (const auto& cell : cells)
+	{
+		for (int32_t nSlot : cell.second)
+		{
+			slots.push_back(nSlot);
+			vMin = vMin.min(positions[nSlot]);
+			vMax = vMax.max(positions[nSlot]);
+		}
+	}
+
+	// Evenly spread nodes get about four nodes per cell, clustered nodes leave most cells empty and crowd the
+	// occupied ones, the cells are halved until that is no longer the case
+	const float fNodesPerCell = 4.0f;
+	olc::vf2d vSize = (vMax - vMin).max({ 1e-3f, 1e-3f });
+	float fSize = std::sqrt(fNodesPerCell * vSize.x * vSize.y / float(slots.size()));
+	for (int i = 0; i < 16; i++)
+	{
+		Clear(std::max(fSize, 1e-3f));
+		for (int32_t nSlot : slots) { Insert(nSlot, positions[nSlot]); }
+		if (float(nCount) <= 2.0f * fNodesPerCell * float(cells.size()) || fSize <= 1e-3f) { break; }
+		fSize *= 0.5f;
+	}
+}
+
+// Number of stored nodes
+int32_t NodeGrid::GetCount() const
+{
+	return nCount;
+}
+
+// Current cell size
+float NodeGrid::GetCellSize() const
+{
+	return fCellSize;
+}
+
+// Find the closest node within "fMaxDistance"
+int32_t NodeGrid::FindNearest(const olc::vf2d& vPoint, const float& fMaxDistance, const std::vector<olc::vf2d>& positions, float* squaredDistance) const
+{
+	int32_t nBest = -1;
+	float fBest = fMaxDistance * fMaxDistance;
+	int32_t cx = CellCoordinate(vPoint.x);
+	int32_t cy = CellCoordinate(vPoint.y);
+	int32_t nMaxRing = int32_t(std::min(std::ceil(fMaxDistance * fInverseCellSize), 46340.0f));
+
+	// A radius of many cells visits the occupied cells instead
+	if ((2.0 * double(nMaxRing) + 1.0) * (2.0 * double(nMaxRing) + 1.0) > double(cells.size()))
+	{
+		for (const auto& cell : cells)
+		{
+			for (int32_t nSlot : cell.second)
+			{
+				float fDistance = (positions[nSlot] - vPoint).mag2();
+				if (fDistance <= fBest)
+				{
+					fBest = fDistance;
+					nBest = nSlot;
+				}
+			}
+		}
+		if (squaredDistance) { *squaredDistance = fBest; }
+		return nBest;
+	}
+
+	// Search rings of cells around the point, every cell in ring "r" is at least (r - 1) cells away
+	for (int32_t r = 0; r <= nMaxRing; r++)
+	{
+		if (nBest != -1 && float(r - 1) * fCellSize * float(r - 1) * fCellSize > fBest) { break; }
+		for (int32_t y = cy - r; y <= cy + r; y++)
+		{
+			// Only the first and the last row are complete, the other rows only have their two ends in the ring
+			int32_t nStep = (y == cy - r || y == cy + r) ? 1 : std::max(2 * r, 1);
+			for (int32_t x = cx - r; x <= cx + r; x += nStep)
+			{
+				auto it = cells.find(CellKey(x, y));
+				if (it == cells.end()) { continue; }
+				for (int32_t nSlot : it->second)
+				{
+					float fDistance = (positions[nSlot] - vPoint).mag2();
+					if (fDistance <= fBest)
+					{
+						fBest = fDistance;
+						nBest = nSlot;
+					}
+				}
+			}
+		}
+	}
+	if (squaredDistance) { *squaredDistance = fBest; }
+	return nBest;
+}
+
+// Find all nodes within a radius
+void NodeGrid::FindInRadius(const olc::vf2d& vPoint, const float& fRadius, const std::vector<olc::vf2d>& positions, std::vector<int32_t>* slots) const
+{
+	FindInBox(vPoint - olc::vf2d{ fRadius, fRadius }, vPoint + olc::vf2d{ fRadius, fRadius }, positions, slots);
+	float fRadiusSquared = fRadius * fRadius;
+	int nKept = 0;
+	for (int i = 0; i < slots->size(); i++)
+	{
+		if ((positions[(*slots)[i]] - vPoint).mag2() <= fRadiusSquared)
+		{
+			(*slots)[nKept++] = (*slots)[i];
+		}
+	}
+	slots->resize(nKept);
+}
+
+// Find all nodes inside an axis aligned box
+void NodeGrid::FindInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, const std::vector<olc::vf2d>& positions, std::vector<int32_t>* slots) const
+{
+	slots->clear();
+	int32_t x0 = CellCoordinate(vMin.x);
+	int32_t y0 = CellCoordinate(vMin.y);
+	int32_t x1 = CellCoordinate(vMax.x);
+	int32_t y1 = CellCoordinate(vMax.y);
+
+	auto collect = [&](const std::vector<int32_t>& cell)
+	{
+		for (int32_t nSlot : cell)
+		{
+			const olc::vf2d& vPosition = positions[nSlot];
+			if (vPosition.x >= vMin.x && vPosition.y >= vMin.y && vPosition.x <= vMax.x && vPosition.y <= vMax.y)
+			{
+				slots->push_back(nSlot);
+			}
+		}
+	};
+
+	// Large boxes visit the occupied cells instead of every cell inside the box
+	double fBoxCells = (double(x1) - double(x0) + 1.0) * (double(y1) - double(y0) + 1.0);
+	if (fBoxCells > double(cells.size()))
+	{
+		for (const auto& cell : cells)
+		{
+			collect(cell.second);
+		}
+		return;
+	}
+	for (int32_t y = y0; y <= y1; y++)
+	{
+		for (int32_t x = x0; x <= x1; x++)
+		{
+			auto it = cells.find(CellKey(x, y));
+			if (it != cells.end()) { collect(it->second); }
+		}
+	}
+}
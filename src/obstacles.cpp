@@ -0,0 +1,225 @@
+#include "olcPixelGameEngine.h"
+#include "obstacles.h"
+
+
+// Signed area of a polygon given by node indices, positive for counter-clockwise polygons
+float PolygonSignedArea(const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon)
+{
+	float fArea = 0.0f;
+	for (int i = 0, j = int(polygon.size()) - 1; i < polygon.size(); j = i++)
+	{
+		fArea += nodes[polygon[j]].cross(nodes[polygon[i]]);
+	}
+	return 0.5f * fArea;
+}
+
+// Even-odd point in polygon test
+bool IsPointInPolygon(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<int>& polygon)
+{
+	bool bInside = false;
+	for (int i = 0, j = int(polygon.size()) - 1; i < polygon.size(); j = i++)
+	{
+		const olc::vf2d& vA = nodes[polygon[i]];
+		const olc::vf2d& vB = nodes[polygon[j]];
+		if ((vA.y > vPoint.y) != (vB.y > vPoint.y) &&
+			vPoint.x < (vB.x - vA.x) * (vPoint.y - vA.y) / (vB.y - vA.y) + vA.x)
+		{
+			bInside = !bInside;
+		}
+	}
+	return bInside;
+}
+
+// Check if the point is inside the obstacle, the bounding box is checked first
+static bool IsPointInObstacle(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const Obstacle& obstacle)
+{
+	if (vPoint.x < obstacle.vMin.x || vPoint.y < obstacle.vMin.y || vPoint.x > obstacle.vMax.x || vPoint.y > obstacle.vMax.y)
+	{
+		return false;
+	}
+	return IsPointInPolygon(vPoint, nodes, obstacle.nodes);
+}
+
+// Find all bounded faces of the segment graph and classify them as solids or holes
+std::vector<Obstacle> FindObstacles(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments)
+{
+	std::vector<int> offsets, adjacentSegments;
+	BuildNodeAdjacency(int(nodes.size()), segments, &offsets, &adjacentSegments);
+
+	// Segments on dangling chains cannot bound a face, they are peeled off from their free ends
+	std::vector<bool> active(segments.size(), true);
+	std::vector<int> degree(nodes.size(), 0);
+	std::vector<int> freeEnds;
+	for (int i = 0; i < segments.size(); i++)
+	{
+		if (segments[i][0] == segments[i][1]) { active[i] = false; continue; }
+		degree[segments[i][0]] += 1;
+		degree[segments[i][1]] += 1;
+	}
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (degree[i] == 1) { freeEnds.push_back(i); }
+	}
+	while (!freeEnds.empty())
+	{
+		int i_node = freeEnds.back();
+		freeEnds.pop_back();
+		for (int k = offsets[i_node]; k < offsets[i_node + 1]; k++)
+		{
+			int i_segment = adjacentSegments[k];
+			if (!active[i_segment]) { continue; }
+			active[i_segment] = false;
+			degree[i_node] -= 1;
+			int i_other = (segments[i_segment][0] == i_node) ? segments[i_segment][1] : segments[i_segment][0];
+			if (--degree[i_other] == 1) { freeEnds.push_back(i_other); }
+		}
+	}
+
+	// Half-edge "2 * i" runs from segments[i][0] to segments[i][1], "2 * i + 1" runs back. The outgoing
+	// half-edges of every node are sorted by angle.
+	std::vector<int> outgoing, position(2 * segments.size(), -1), first(nodes.size() + 1, 0);
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		first[i] = int(outgoing.size());
+		for (int k = offsets[i]; k < offsets[i + 1]; k++)
+		{
+			int i_segment = adjacentSegments[k];
+			if (active[i_segment]) { outgoing.push_back(2 * i_segment + (segments[i_segment][0] == i ? 0 : 1)); }
+		}
+		auto angle = [&](int h)
+		{
+			olc::vf2d vDirection = nodes[segments[h / 2][1 - h % 2]] - nodes[i];
+			return std::atan2(vDirection.y, vDirection.x);
+		};
+		std::sort(outgoing.begin() + first[i], outgoing.end(), [&](int hA, int hB) { return angle(hA) < angle(hB); });
+		for (int k = first[i]; k < outgoing.size(); k++) { position[outgoing[k]] = k; }
+	}
+	first[nodes.size()] = int(outgoing.size());
+
+	// Connected component of every node, faces of one component never lie inside each other
+	std::vector<int> component(nodes.size(), -1);
+	std::vector<int> stack;
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (component[i] != -1) { continue; }
+		component[i] = i;
+		stack.push_back(i);
+		while (!stack.empty())
+		{
+			int i_node = stack.back();
+			stack.pop_back();
+			for (int k = first[i_node]; k < first[i_node + 1]; k++)
+			{
+				int h = outgoing[k];
+				int i_other = segments[h / 2][1 - h % 2];
+				if (component[i_other] == -1) { component[i_other] = i; stack.push_back(i_other); }
+			}
+		}
+	}
+
+	// Walk every face with the face on the left: after arriving at a node, leave along the next half-edge
+	// clockwise from the one that leads back. Bounded faces come out counter-clockwise, the outer boundary of
+	// every component clockwise.
+	std::vector<Obstacle> obstacles;
+	std::vector<bool> visited(2 * segments.size(), false);
+	for (int h_start = 0; h_start < 2 * segments.size(); h_start++)
+	{
+		if (visited[h_start] || position[h_start] == -1) { continue; }
+
+		Obstacle obstacle;
+		int h = h_start;
+		do
+		{
+			visited[h] = true;
+			obstacle.nodes.push_back(segments[h / 2][h % 2]);
+			obstacle.segments.push_back(h / 2);
+			int i_next = segments[h / 2][1 - h % 2];
+			int k = position[h ^ 1];
+			h = outgoing[(k == first[i_next]) ? first[i_next + 1] - 1 : k - 1];
+		} while (h != h_start);
+
+		float fSignedArea = PolygonSignedArea(nodes, obstacle.nodes);
+		if (obstacle.nodes.size() < 3 || fSignedArea <= 0.0f) { continue; }
+
+		// Orientation, area and bounding box
+		obstacle.bCounterClockwise = true;
+		obstacle.fArea = fSignedArea;
+		obstacle.vMin = nodes[obstacle.nodes[0]];
+		obstacle.vMax = nodes[obstacle.nodes[0]];
+		for (int j = 1; j < obstacle.nodes.size(); j++)
+		{
+			obstacle.vMin = obstacle.vMin.min(nodes[obstacle.nodes[j]]);
+			obstacle.vMax = obstacle.vMax.max(nodes[obstacle.nodes[j]]);
+		}
+		obstacles.push_back(std::move(obstacle));
+	}
+
+	// Faces of different components are disjoint, so one node decides whether a face lies inside another one
+	for (int i = 0; i < obstacles.size(); i++)
+	{
+		const olc::vf2d& vPoint = nodes[obstacles[i].nodes[0]];
+		for (int j = 0; j < obstacles.size(); j++)
+		{
+			if (i == j || obstacles[j].fArea <= obstacles[i].fArea) { continue; }
+			if (component[obstacles[i].nodes[0]] == component[obstacles[j].nodes[0]]) { continue; }
+			if (IsPointInObstacle(vPoint, nodes, obstacles[j]))
+			{
+				obstacles[i].nDepth += 1;
+				if (obstacles[i].nParent == -1 || obstacles[j].fArea < obstacles[obstacles[i].nParent].fArea)
+				{
+					obstacles[i].nParent = j;
+				}
+			}
+		}
+		obstacles[i].bSolid = (obstacles[i].nDepth % 2 == 0);
+	}
+	return obstacles;
+}
+
+// Find the innermost loop that contains the point. Returns -1 if the point is not inside any loop.
+int FindEnclosingObstacle(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<Obstacle>& obstacles)
+{
+	int i_innermost = -1;
+	for (int i = 0; i < obstacles.size(); i++)
+	{
+		if (i_innermost != -1 && obstacles[i].nDepth <= obstacles[i_innermost].nDepth) { continue; }
+		if (IsPointInObstacle(vPoint, nodes, obstacles[i]))
+		{
+			i_innermost = i;
+		}
+	}
+	return i_innermost;
+}
+
+// Check if the point lies inside solid material
+bool IsPointInsideSolid(const olc::vf2d& vPoint, const std::vector<olc::vf2d>& nodes, const std::vector<Obstacle>& obstacles)
+{
+	int i_obstacle = FindEnclosingObstacle(vPoint, nodes, obstacles);
+	return i_obstacle != -1 && obstacles[i_obstacle].bSolid;
+}
+
+// Flag the loop segments whose solid side faces the observer
+std::vector<bool> FindBackFacingSegments(const olc::vf2d& vObserver, const std::vector<olc::vf2d>& nodes,
+	const std::vector<std::array<int, 2>>& segments, const std::vector<Obstacle>& obstacles)
+{
+	std::vector<bool> backFacing(segments.size(), false);
+	for (int i = 0; i < obstacles.size(); i++)
+	{
+		const Obstacle& obstacle = obstacles[i];
+
+		// The normal "(dy, -dx)" points to the right of the traversal direction. It points out of the
+		// solid for counter-clockwise solids, holes have the solid material on their outside.
+		float fSign = (obstacle.bCounterClockwise == obstacle.bSolid) ? 1.0f : -1.0f;
+		for (int j = 0; j < obstacle.nodes.size(); j++)
+		{
+			const olc::vf2d& vA = nodes[obstacle.nodes[j]];
+			const olc::vf2d& vB = nodes[obstacle.nodes[(j + 1) % obstacle.nodes.size()]];
+			olc::vf2d vNormal = { vB.y - vA.y, vA.x - vB.x };
+			if (fSign * vNormal.dot(vObserver - vA) < 0.0f)
+			{
+				backFacing[obstacle.segments[j]] = true;
+			}
+		}
+	}
+	return backFacing;
+}
@@ -0,0 +1,214 @@
+#include "olcPixelGameEngine.h"
+#include "prefabs.h"
+
+
+// Add a prefab definition
+int PrefabScene::AddPrefab(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments)
+{
+	Prefab prefab;
+	prefab.nodes = nodes;
+	prefab.segments = segments;
+	prefab.vMin = nodes.empty() ? olc::vf2d{ 0.0f, 0.0f } : nodes[0];
+	prefab.vMax = prefab.vMin;
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		prefab.vMin = prefab.vMin.min(nodes[i]);
+		prefab.vMax = prefab.vMax.max(nodes[i]);
+	}
+	for (int i = 0; i < segments.size(); i++)
+	{
+		const olc::vf2d& vStart = nodes[segments[i][0]];
+		const olc::vf2d& vEnd = nodes[segments[i][1]];
+		prefab.segmentTree.Insert(vStart.min(vEnd), vStart.max(vEnd), i);
+	}
+	prefabs.push_back(std::move(prefab));
+	return int(prefabs.size()) - 1;
+}
+
+// World box of an instance, the transformed corners of the prefab box
+void PrefabScene::InstanceBounds(const PrefabInstance& instance, olc::vf2d* vMin, olc::vf2d* vMax) const
+{
+	const Prefab& prefab = prefabs[instance.nPrefab];
+	olc::vf2d corners[4] = { prefab.vMin, { prefab.vMax.x, prefab.vMin.y }, prefab.vMax, { prefab.vMin.x, prefab.vMax.y } };
+	*vMin = ToWorld(instance, corners[0]);
+	*vMax = *vMin;
+	for (int k = 1; k < 4; k++)
+	{
+		olc::vf2d vCorner = ToWorld(instance, corners[k]);
+		*vMin = vMin->min(vCorner);
+		*vMax = vMax->max(vCorner);
+	}
+}
+
+// Add an instance
+int PrefabScene::AddInstance(const int& nPrefab, const olc::vf2d& vPosition, const float& fRotation, const float& fScale)
+{
+	int i_instance = int(instances.size());
+	if (freeInstances.empty())
+	{
+		instances.push_back(PrefabInstance());
+	}
+	else
+	{
+		i_instance = freeInstances.back();
+		freeInstances.pop_back();
+	}
+	PrefabInstance& instance = instances[i_instance];
+	instance.nPrefab = nPrefab;
+	instance.vPosition = vPosition;
+	instance.fRotation = fRotation;
+	instance.fScale = fScale;
+
+	olc::vf2d vMin, vMax;
+	InstanceBounds(instance, &vMin, &vMax);
+	instance.nProxy = instanceTree.Insert(vMin, vMax, i_instance);
+	return i_instance;
+}
+
+// Move an instance
+bool PrefabScene::MoveInstance(const int& i_instance, const olc::vf2d& vPosition, const float& fRotation)
+{
+	if (i_instance < 0 || i_instance >= instances.size() || instances[i_instance].nProxy == -1) { return false; }
+	PrefabInstance& instance = instances[i_instance];
+	instance.vPosition = vPosition;
+	instance.fRotation = fRotation;
+
+	olc::vf2d vMin, vMax;
+	InstanceBounds(instance, &vMin, &vMax);
+	instanceTree.Update(instance.nProxy, vMin, vMax);
+	return true;
+}
+
+// Remove an instance
+bool PrefabScene::RemoveInstance(const int& i_instance)
+{
+	if (i_instance < 0 || i_instance >= instances.size() || instances[i_instance].nProxy == -1) { return false; }
+	instanceTree.Remove(instances[i_instance].nProxy);
+	instances[i_instance].nProxy = -1;
+	freeInstances.push_back(i_instance);
+	return true;
+}
+
+// Remove all prefabs and instances
+void PrefabScene::Clear()
+{
+	prefabs.clear();
+	instances.clear();
+	freeInstances.clear();
+	instanceTree.Clear();
+}
+
+// Number of prefabs
+int PrefabScene::GetPrefabCount() const
+{
+	return int(prefabs.size());
+}
+
+// Number of placed instances
+int PrefabScene::GetInstanceCount() const
+{
+	return int(instances.size() - freeInstances.size());
+}
+
+// Access a prefab
+const Prefab& PrefabScene::GetPrefab(const int& nPrefab) const
+{
+	return prefabs[nPrefab];
+}
+
+// Access an instance
+const PrefabInstance& PrefabScene::GetInstance(const int& i_instance) const
+{
+	return instances[i_instance];
+}
+
+// Transform from prefab space to world space
+olc::vf2d PrefabScene::ToWorld(const PrefabInstance& instance, const olc::vf2d& vLocal) const
+{
+	return instance.vPosition + RotatePoint(vLocal * instance.fScale, instance.fRotation);
+}
+
+// Transform from world space to prefab space
+olc::vf2d PrefabScene::ToLocal(const PrefabInstance& instance, const olc::vf2d& vWorld) const
+{
+	return RotatePoint(vWorld - instance.vPosition, -instance.fRotation) / instance.fScale;
+}
+
+// Find the instances whose world box overlaps a box
+void PrefabScene::FindInstancesInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<int32_t>* foundInstances) const
+{
+	instanceTree.QueryBox(vMin, vMax, foundInstances);
+}
+
+// Find the closest instance segment within "fMaxDistance"
+int PrefabScene::FindNearestSegment(const olc::vf2d& vPoint, const float& fMaxDistance, int* i_segment, float* squaredDistance) const
+{
+	// Distance to an instance is the distance to its closest segment, searched in prefab space
+	auto nearestInInstance = [&](const int32_t& i_instance, int32_t* i_instanceSegment)
+	{
+		const PrefabInstance& instance = instances[i_instance];
+		const Prefab& prefab = prefabs[instance.nPrefab];
+		olc::vf2d vLocal = ToLocal(instance, vPoint);
+		auto distanceSquared = [&](const int32_t& i)
+		{
+			return EuclideanDistanceToLineSquared(prefab.nodes[prefab.segments[i][0]], prefab.nodes[prefab.segments[i][1]], vLocal);
+		};
+		float fLocalDistance;
+		*i_instanceSegment = prefab.segmentTree.FindNearest(vLocal, fMaxDistance / instance.fScale, distanceSquared, &fLocalDistance);
+		if (*i_instanceSegment == -1) { return std::numeric_limits<float>::max(); }
+		return fLocalDistance * instance.fScale * instance.fScale;
+	};
+
+	int32_t i_closestSegment = -1;
+	auto instanceDistance = [&](const int32_t& i_instance) { return nearestInInstance(i_instance, &i_closestSegment); };
+	int32_t i_instance = instanceTree.FindNearest(vPoint, fMaxDistance, instanceDistance, squaredDistance);
+
+	// The last searched instance is not always the closest one, search the winner again for its segment
+	if (i_instance != -1) { nearestInInstance(i_instance, &i_closestSegment); }
+	if (i_segment) { *i_segment = i_closestSegment; }
+	return i_instance;
+}
+
+// Closest hit of a ray with the instances. Affine transforms keep the ray parameter, so it is compared across instances.
+bool PrefabScene::RayCast(const olc::vf2d& vRayStart, const olc::vf2d& vRayEnd, float* fT) const
+{
+	float fBest = std::numeric_limits<float>::max();
+	auto hitInstance = [&](const int32_t& i_instance, const float& fMaxT)
+	{
+		const PrefabInstance& instance = instances[i_instance];
+		const Prefab& prefab = prefabs[instance.nPrefab];
+		olc::vf2d vLocalStart = ToLocal(instance, vRayStart);
+		olc::vf2d vLocalEnd = ToLocal(instance, vRayEnd);
+		olc::vf2d vLocalDirection = vLocalEnd - vLocalStart;
+		float fLength2 = vLocalDirection.mag2();
+
+		auto hitSegment = [&](const int32_t& i, const float& fSegmentMaxT)
+		{
+			olc::vf2d vIntersectionPoint;
+			if (RayToSegmentIntersection(vLocalStart, vLocalEnd, prefab.nodes[prefab.segments[i][0]], prefab.nodes[prefab.segments[i][1]], &vIntersectionPoint))
+			{
+				float t = (vIntersectionPoint - vLocalStart).dot(vLocalDirection) / fLength2;
+				if (t < fBest) { fBest = t; }
+			}
+			return std::min(fSegmentMaxT, fBest);
+		};
+		prefab.segmentTree.RayCast(vLocalStart, vLocalDirection, fMaxT, hitSegment);
+		return std::min(fMaxT, fBest);
+	};
+	instanceTree.RayCast(vRayStart, vRayEnd - vRayStart, std::numeric_limits<float>::max(), hitInstance);
+
+	if (fBest == std::numeric_limits<float>::max()) { return false; }
+	*fT = fBest;
+	return true;
+}
+
+// Memory used by prefabs and instances in bytes
+size_t PrefabScene::GetMemoryUsage() const
+{
+	size_t nBytes = instances.capacity() * sizeof(PrefabInstance);
+	for (int i = 0; i < prefabs.size(); i++)
+	{
+		nBytes += prefabs[i].nodes.capacity() * sizeof(olc::vf2d) + prefabs[i].segments.capacity() * sizeof(std::array<int, 2>);
+	}
+	return nBytes;
+}
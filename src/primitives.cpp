@@ -0,0 +1,298 @@
+#include "olcPixelGameEngine.h"
+#include "primitives.h"
+
+
+// Number of outline samples of a circle that are used as visibility rays
+static const int nCircleSilhouetteSamples = 48;
+
+
+// Check if a point is inside a bounding box grown by "fMargin"
+static bool IsPointInBox(const olc::vf2d& vPoint, const olc::vf2d& vMin, const olc::vf2d& vMax, const float& fMargin)
+{
+	return vPoint.x >= vMin.x - fMargin && vPoint.y >= vMin.y - fMargin && vPoint.x <= vMax.x + fMargin && vPoint.y <= vMax.y + fMargin;
+}
+
+// Check if the segment between two points can touch a bounding box
+static bool CanSegmentTouchBox(const olc::vf2d& vStart, const olc::vf2d& vEnd, const olc::vf2d& vMin, const olc::vf2d& vMax)
+{
+	return std::max(vStart.x, vEnd.x) >= vMin.x && std::min(vStart.x, vEnd.x) <= vMax.x &&
+		std::max(vStart.y, vEnd.y) >= vMin.y && std::min(vStart.y, vEnd.y) <= vMax.y;
+}
+
+// Bounding box of the vertices
+static void UpdatePolygonBounds(Primitive* primitive)
+{
+	primitive->vMin = primitive->vertices[0];
+	primitive->vMax = primitive->vertices[0];
+	for (int i = 1; i < primitive->vertices.size(); i++)
+	{
+		primitive->vMin = primitive->vMin.min(primitive->vertices[i]);
+		primitive->vMax = primitive->vMax.max(primitive->vertices[i]);
+	}
+}
+
+// Make a rotated rectangle
+Primitive MakeRectangle(const olc::vf2d& vCenter, const olc::vf2d& vHalfSize, const float& fRotation)
+{
+	Primitive primitive;
+	primitive.nType = PrimitiveType::Rectangle;
+	primitive.vCenter = vCenter;
+	primitive.vHalfSize = vHalfSize;
+	primitive.fRotation = fRotation;
+	primitive.vertices = {
+		vCenter + RotatePoint({ -vHalfSize.x, -vHalfSize.y }, fRotation),
+		vCenter + RotatePoint({  vHalfSize.x, -vHalfSize.y }, fRotation),
+		vCenter + RotatePoint({  vHalfSize.x,  vHalfSize.y }, fRotation),
+		vCenter + RotatePoint({ -vHalfSize.x,  vHalfSize.y }, fRotation) };
+	UpdatePolygonBounds(&primitive);
+	return primitive;
+}
+
+// Make a circle
+Primitive MakeCircle(const olc::vf2d& vCenter, const float& fRadius)
+{
+	Primitive primitive;
+	primitive.nType = PrimitiveType::Circle;
+	primitive.vCenter = vCenter;
+	primitive.fRadius = fRadius;
+	primitive.vMin = vCenter - olc::vf2d{ fRadius, fRadius };
+	primitive.vMax = vCenter + olc::vf2d{ fRadius, fRadius };
+	return primitive;
+}
+
+// Make a convex polygon from the convex hull of the points (monotone chain)
+Primitive MakeConvexPolygon(const std::vector<olc::vf2d>& points)
+{
+	std::vector<olc::vf2d> sorted = points;
+	std::sort(sorted.begin(), sorted.end(), [](const olc::vf2d& a, const olc::vf2d& b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+
+	Primitive primitive;
+	primitive.nType = PrimitiveType::ConvexPolygon;
+	std::vector<olc::vf2d>& hull = primitive.vertices;
+	hull.resize(2 * sorted.size());
+	int k = 0;
+	for (int i = 0; i < sorted.size(); i++)
+	{
+		while (k >= 2 && (hull[k - 1] - hull[k - 2]).cross(sorted[i] - hull[k - 2]) <= 0.0f) { k--; }
+		hull[k++] = sorted[i];
+	}
+	for (int i = int(sorted.size()) - 2, nLower = k + 1; i >= 0; i--)
+	{
+		while (k >= nLower && (hull[k - 1] - hull[k - 2]).cross(sorted[i] - hull[k - 2]) <= 0.0f) { k--; }
+		hull[k++] = sorted[i];
+	}
+	hull.resize(std::max(k - 1, 0));
+
+	primitive.vCenter = { 0.0f, 0.0f };
+	for (int i = 0; i < hull.size(); i++)
+	{
+		primitive.vCenter += hull[i] / float(hull.size());
+	}
+	if (!hull.empty()) { UpdatePolygonBounds(&primitive); }
+	return primitive;
+}
+
+// Check if a point is inside a primitive
+bool IsPointInPrimitive(const olc::vf2d& vPoint, const Primitive& primitive)
+{
+	if (!IsPointInBox(vPoint, primitive.vMin, primitive.vMax, 0.0f)) { return false; }
+	if (primitive.nType == PrimitiveType::Circle)
+	{
+		return (vPoint - primitive.vCenter).mag2() <= primitive.fRadius * primitive.fRadius;
+	}
+	int n = int(primitive.vertices.size());
+	for (int i = 0; i < n; i++)
+	{
+		if ((primitive.vertices[(i + 1) % n] - primitive.vertices[i]).cross(vPoint - primitive.vertices[i]) < 0.0f) { return false; }
+	}
+	return n >= 3;
+}
+
+// Squared distance from a point to the outline of a primitive
+float PrimitiveDistanceSquared(const olc::vf2d& vPoint, const Primitive& primitive)
+{
+	if (primitive.nType == PrimitiveType::Circle)
+	{
+		float fDistance = (vPoint - primitive.vCenter).mag() - primitive.fRadius;
+		return fDistance * fDistance;
+	}
+	float fMin = std::numeric_limits<float>::max();
+	int n = int(primitive.vertices.size());
+	for (int i = 0; i < n; i++)
+	{
+		fMin = std::min(fMin, EuclideanDistanceToLineSquared(primitive.vertices[i], primitive.vertices[(i + 1) % n], vPoint));
+	}
+	return fMin;
+}
+
+// Find the primitive with the closest outline within "fMaxDistance"
+int FindClosestPrimitive(const olc::vf2d& vPoint, const std::vector<Primitive>& primitives, const float& fMaxDistance, float* squaredDistance)
+{
+	int i_closest = -1;
+	float fBest = fMaxDistance * fMaxDistance;
+	for (int i = 0; i < primitives.size(); i++)
+	{
+		// One box check rejects primitives whose outline cannot be close enough
+		olc::vf2d vBoxPoint = vPoint.max(primitives[i].vMin).min(primitives[i].vMax);
+		if ((vPoint - vBoxPoint).mag2() > fBest) { continue; }
+
+		float fDistance = PrimitiveDistanceSquared(vPoint, primitives[i]);
+		if (fDistance <= fBest)
+		{
+			fBest = fDistance;
+			i_closest = i;
+		}
+	}
+	if (squaredDistance) { *squaredDistance = fBest; }
+	return i_closest;
+}
+
+// First hit of a ray with the outline of a primitive
+bool RayToPrimitiveIntersection(const olc::vf2d& vRayStart, const olc::vf2d& vRayEnd, const Primitive& primitive, float* fT)
+{
+	olc::vf2d vDirection = vRayEnd - vRayStart;
+
+	// Slab test against the bounding box
+	float fEnter = 0.0f;
+	float fExit = std::numeric_limits<float>::max();
+	for (int k = 0; k < 2; k++)
+	{
+		float fOrigin = k == 0 ? vRayStart.x : vRayStart.y;
+		float fDir = k == 0 ? vDirection.x : vDirection.y;
+		float fMin = k == 0 ? primitive.vMin.x : primitive.vMin.y;
+		float fMax = k == 0 ? primitive.vMax.x : primitive.vMax.y;
+		if (std::abs(fDir) < 1e-12f)
+		{
+			if (fOrigin < fMin || fOrigin > fMax) { return false; }
+			continue;
+		}
+		float t1 = (fMin - fOrigin) / fDir;
+		float t2 = (fMax - fOrigin) / fDir;
+		fEnter = std::max(fEnter, std::min(t1, t2));
+		fExit = std::min(fExit, std::max(t1, t2));
+		if (fEnter > fExit) { return false; }
+	}
+
+	// Circle, smaller root from outside and larger root from inside
+	if (primitive.nType == PrimitiveType::Circle)
+	{
+		olc::vf2d vOffset = vRayStart - primitive.vCenter;
+		float a = vDirection.mag2();
+		float b = 2.0f * vOffset.dot(vDirection);
+		float c = vOffset.mag2() - primitive.fRadius * primitive.fRadius;
+		float fDiscriminant = b * b - 4.0f * a * c;
+		if (a == 0.0f || fDiscriminant < 0.0f) { return false; }
+		float fRoot = std::sqrt(fDiscriminant);
+		float t = (c > 0.0f) ? (-b - fRoot) / (2.0f * a) : (-b + fRoot) / (2.0f * a);
+		if (t < 0.0f) { return false; }
+		*fT = t;
+		return true;
+	}
+
+	// Convex polygon, clip the ray against every edge (Cyrus-Beck)
+	float tEnter = 0.0f;
+	float tExit = std::numeric_limits<float>::max();
+	bool bInside = true;
+	int n = int(primitive.vertices.size());
+	for (int i = 0; i < n; i++)
+	{
+		olc::vf2d vEdge = primitive.vertices[(i + 1) % n] - primitive.vertices[i];
+		float fDistance = vEdge.cross(vRayStart - primitive.vertices[i]); // > 0 on the inner side
+		float fRate = vEdge.cross(vDirection);
+		if (fDistance < 0.0f) { bInside = false; }
+		if (fRate == 0.0f)
+		{
+			if (fDistance < 0.0f) { return false; }
+			continue;
+		}
+		float t = -fDistance / fRate;
+		if (fRate > 0.0f) { tEnter = std::max(tEnter, t); }
+		else              { tExit = std::min(tExit, t); }
+		if (tEnter > tExit) { return false; }
+	}
+	if (n < 3 || tExit == std::numeric_limits<float>::max()) { return false; }
+	*fT = bInside ? tExit : tEnter;
+	return true;
+}
+
+// All intersections of a line segment with the outline of a primitive
+void SegmentToPrimitiveIntersections(const olc::vf2d& vStart, const olc::vf2d& vEnd, const Primitive& primitive, std::vector<olc::vf2d>* points)
+{
+	if (!CanSegmentTouchBox(vStart, vEnd, primitive.vMin, primitive.vMax)) { return; }
+	if (primitive.nType == PrimitiveType::Circle)
+	{
+		olc::vf2d vDirection = vEnd - vStart;
+		olc::vf2d vOffset = vStart - primitive.vCenter;
+		float a = vDirection.mag2();
+		float b = 2.0f * vOffset.dot(vDirection);
+		float c = vOffset.mag2() - primitive.fRadius * primitive.fRadius;
+		float fDiscriminant = b * b - 4.0f * a * c;
+		if (a == 0.0f || fDiscriminant < 0.0f) { return; }
+		float fRoot = std::sqrt(fDiscriminant);
+		for (float t : { (-b - fRoot) / (2.0f * a), (-b + fRoot) / (2.0f * a) })
+		{
+			if (t >= 0.0f && t <= 1.0f) { points->push_back(vStart + t * vDirection); }
+		}
+		return;
+	}
+	int n = int(primitive.vertices.size());
+	olc::vf2d vIntersectionPoint;
+	for (int i = 0; i < n; i++)
+	{
+		if (SegmentToSegmentIntersection(vStart, vEnd, primitive.vertices[i], primitive.vertices[(i + 1) % n], &vIntersectionPoint))
+		{
+			points->push_back(vIntersectionPoint);
+		}
+	}
+}
+
+// Points of the outline that can bound the visible region as seen from the observer
+void FindPrimitiveSilhouette(const olc::vf2d& vObserver, const Primitive& primitive, std::vector<olc::vf2d>* points)
+{
+	if (primitive.nType == PrimitiveType::Circle)
+	{
+		olc::vf2d vOffset = vObserver - primitive.vCenter;
+		float fDistance = vOffset.mag();
+		if (fDistance <= primitive.fRadius) { return; }
+
+		// Tangent points and the outline samples between them that face the observer
+		float fAngle = std::atan2(vOffset.y, vOffset.x);
+		float fHalfSpan = std::acos(primitive.fRadius / fDistance);
+		points->push_back(primitive.vCenter + primitive.fRadius * olc::vf2d{ std::cos(fAngle + fHalfSpan), std::sin(fAngle + fHalfSpan) });
+		points->push_back(primitive.vCenter + primitive.fRadius * olc::vf2d{ std::cos(fAngle - fHalfSpan), std::sin(fAngle - fHalfSpan) });
+		int nSamples = std::max(int(nCircleSilhouetteSamples * fHalfSpan / 3.14159265f), 1);
+		for (int i = 1; i < nSamples; i++)
+		{
+			float fSample = fAngle - fHalfSpan + 2.0f * fHalfSpan * float(i) / float(nSamples);
+			points->push_back(primitive.vCenter + primitive.fRadius * olc::vf2d{ std::cos(fSample), std::sin(fSample) });
+		}
+		return;
+	}
+
+	// Vertices of the front-facing edges, the tangent vertices are the ones between a front-facing and a back-facing edge
+	int n = int(primitive.vertices.size());
+	auto isFrontFacing = [&](int i) { return (primitive.vertices[(i + 1) % n] - primitive.vertices[i]).cross(vObserver - primitive.vertices[i]) < 0.0f; };
+	bool bPreviousFront = isFrontFacing(n - 1);
+	for (int i = 0; i < n; i++)
+	{
+		bool bFront = isFrontFacing(i);
+		if (bPreviousFront || bFront) { points->push_back(primitive.vertices[i]); }
+		bPreviousFront = bFront;
+	}
+}
+
+// Outline of a primitive as a closed polyline
+void GetPrimitiveOutline(const Primitive& primitive, const int& nCircleSegments, std::vector<olc::vf2d>* outline)
+{
+	outline->clear();
+	if (primitive.nType != PrimitiveType::Circle)
+	{
+		*outline = primitive.vertices;
+		return;
+	}
+	for (int i = 0; i < nCircleSegments; i++)
+	{
+		float fAngle = 2.0f * 3.14159265f * float(i) / float(nCircleSegments);
+		outline->push_back(primitive.vCenter + primitive.fRadius * olc::vf2d{ std::cos(fAngle), std::sin(fAngle) });
+	}
+}
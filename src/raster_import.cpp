@@ -0,0 +1,434 @@
+#include "olcPixelGameEngine.h"
+#include "raster_import.h"
+#include "parallel_for.h"
+#include "segment_simplification.h"
+
+#include <numeric>
+#include <thread>
+
+
+// Strokes traced from the node pixels of one tile, the fitted points are in pixel coordinates
+struct RasterStrokes
+{
+	std::vector<olc::vf2d> points;                      // Fitted points without the clusters at the ends
+	std::vector<uint32_t> strokeStarts;                 // First point of each stroke, followed by the total number of points
+	std::vector<std::array<int32_t, 2>> strokeClusters; // Clusters at both ends, -1 for a loop that starts and ends at its first point
+};
+
+
+// Zhang-Suen deletion tables of both sub-iterations, indexed by the neighbour code of a pixel
+static const std::array<std::array<uint8_t, 256>, 2>& ThinningTables()
+{
+	static const std::array<std::array<uint8_t, 256>, 2> tables = []()
+	{
+		std::array<std::array<uint8_t, 256>, 2> t = {};
+		for (int c = 0; c < 256; c++)
+		{
+			// Number of wall neighbours and of background to wall transitions around the pixel
+			int nCount = 0;
+			int nTransitions = 0;
+			for (int k = 0; k < 8; k++)
+			{
+				nCount += (c >> k) & 1;
+				if (!((c >> k) & 1) && ((c >> ((k + 1) & 7)) & 1)) { nTransitions += 1; }
+			}
+			bool bNorth = c & 1, bEast = (c >> 2) & 1, bSouth = (c >> 4) & 1, bWest = (c >> 6) & 1;
+			bool bSimple = nCount >= 2 && nCount <= 6 && nTransitions == 1;
+			t[0][c] = bSimple && !(bNorth && bEast && bSouth) && !(bEast && bSouth && bWest);
+			t[1][c] = bSimple && !(bNorth && bEast && bWest) && !(bNorth && bSouth && bWest);
+		}
+		return t;
+	}();
+	return tables;
+}
+
+// Wall neighbours of a pixel as bits, clockwise from north
+static int NeighbourCode(const uint8_t* p, const int64_t& nStride)
+{
+	return p[-nStride] | (p[-nStride + 1] << 1) | (p[1] << 2) | (p[nStride + 1] << 3) |
+		(p[nStride] << 4) | (p[nStride - 1] << 5) | (p[-1] << 6) | (p[-nStride - 1] << 7);
+}
+
+// Neighbours of a skeleton pixel. A diagonal step is left out where a shared 4-neighbour connects both pixels
+// anyway, so staircases trace as simple chains.
+static int SkeletonNeighbours(const uint8_t* mask, const int64_t& i, const int64_t& nStride, int64_t* neighbours)
+{
+	const int64_t straight[4] = { 1, -nStride, -1, nStride };
+	int n = 0;
+	for (int k = 0; k < 4; k++)
+	{
+		if (mask[i + straight[k]]) { neighbours[n++] = i + straight[k]; }
+	}
+	for (int k = 0; k < 4; k++)
+	{
+		int64_t a = straight[k];
+		int64_t b = straight[(k + 1) & 3];
+		if (mask[i + a + b] && !mask[i + a] && !mask[i + b]) { neighbours[n++] = i + a + b; }
+	}
+	return n;
+}
+
+
+// Vectorize a scanned floorplan into wall segments
+bool ImportRaster(const std::string& sPath, GeometryTransaction* transaction, const RasterImportOptions& options, RasterImportStats* stats)
+{
+	int nThreads = options.nThreads > 0 ? options.nThreads : std::max(int(std::thread::hardware_concurrency()), 1);
+	int nTileSize = std::max(options.nTileSize, 16);
+
+	// 1) Threshold into a mask with a one pixel border, so neighbours never need a bounds check. The image is
+	// released before the mask is thinned.
+	int nWidth = 0;
+	int nHeight = 0;
+	std::vector<uint8_t> mask;
+	std::vector<int64_t> tileWallPixels;
+	int64_t nStride = 0;
+	int nTilesX = 0;
+	int nTilesY = 0;
+	{
+		olc::Sprite sprite;
+		if (!olc::Sprite::loader || sprite.LoadFromFile(sPath, options.pack) != olc::rcode::OK) { return false; }
+		if (sprite.width <= 0 || sprite.height <= 0) { return false; }
+		nWidth = sprite.width;
+		nHeight = sprite.height;
+		nStride = int64_t(nWidth) + 2;
+		nTilesX = (nWidth + nTileSize - 1) / nTileSize;
+		nTilesY = (nHeight + nTileSize - 1) / nTileSize;
+		mask.assign(size_t(nStride * (int64_t(nHeight) + 2)), 0);
+		tileWallPixels.assign(size_t(nTilesX) * nTilesY, 0);
+		ParallelFor(nTilesY, nThreads, [&](int ty)
+		{
+			for (int y = ty * nTileSize; y < std::min(nHeight, (ty + 1) * nTileSize); y++)
+			{
+				const olc::Pixel* pixels = sprite.pColData.data() + int64_t(y) * nWidth;
+				uint8_t* row = mask.data() + (int64_t(y) + 1) * nStride + 1;
+				for (int x = 0; x < nWidth; x++)
+				{
+					int nLuminance = (77 * pixels[x].r + 150 * pixels[x].g + 29 * pixels[x].b) >> 8;
+					row[x] = pixels[x].a >= 128 && nLuminance < options.nThreshold;
+					tileWallPixels[size_t(ty) * nTilesX + x / nTileSize] += row[x];
+				}
+			}
+		});
+	}
+	int nTiles = nTilesX * nTilesY;
+	int64_t nWallPixels = std::accumulate(tileWallPixels.begin(), tileWallPixels.end(), int64_t(0));
+
+	// Run a function for every pixel of a tile with its index in the mask
+	auto forEachPixel = [&](const int& t, auto function)
+	{
+		int tx = t % nTilesX;
+		int ty = t / nTilesX;
+		int xEnd = std::min(nWidth, (tx + 1) * nTileSize);
+		for (int y = ty * nTileSize; y < std::min(nHeight, (ty + 1) * nTileSize); y++)
+		{
+			int64_t nRow = (int64_t(y) + 1) * nStride + 1;
+			for (int x = tx * nTileSize; x < xEnd; x++) { function(nRow + x); }
+		}
+	};
+
+	// 2) Zhang-Suen thinning. The pixels to delete are collected from the unchanged mask and deleted after all
+	// tiles are done. A pixel can only change if its neighbourhood changed since the last sub-iteration of the
+	// same kind, so only the tiles next to a change in one of the last two sub-iterations are visited.
+	std::vector<uint8_t> changed(nTiles), changedBefore(nTiles);
+	for (int t = 0; t < nTiles; t++)
+	{
+		changed[t] = changedBefore[t] = tileWallPixels[t] > 0;
+	}
+	std::vector<int> activeTiles;
+	std::vector<std::vector<int64_t>> deletions(nTiles);
+	for (int nStep = 0; ; nStep++)
+	{
+		activeTiles.clear();
+		for (int t = 0; t < nTiles; t++)
+		{
+			int tx = t % nTilesX;
+			int ty = t / nTilesX;
+			bool bActive = false;
+			for (int y = std::max(ty - 1, 0); y <= std::min(ty + 1, nTilesY - 1) && !bActive; y++)
+			{
+				for (int x = std::max(tx - 1, 0); x <= std::min(tx + 1, nTilesX - 1) && !bActive; x++)
+				{
+					bActive = changed[y * nTilesX + x] || changedBefore[y * nTilesX + x];
+				}
+			}
+			if (bActive) { activeTiles.push_back(t); }
+		}
+		if (activeTiles.empty()) { break; }
+		changedBefore.swap(changed);
+		std::fill(changed.begin(), changed.end(), 0);
+
+		const std::array<uint8_t, 256>& table = ThinningTables()[nStep & 1];
+		ParallelFor(int(activeTiles.size()), nThreads, [&](int k)
+		{
+			int t = activeTiles[k];
+			deletions[t].clear();
+			forEachPixel(t, [&](const int64_t& i)
+			{
+				if (mask[i] && table[NeighbourCode(mask.data() + i, nStride)]) { deletions[t].push_back(i); }
+			});
+			changed[t] = !deletions[t].empty();
+		});
+		ParallelFor(int(activeTiles.size()), nThreads, [&](int k)
+		{
+			for (int64_t i : deletions[activeTiles[k]]) { mask[i] = 0; }
+		});
+	}
+	std::vector<std::vector<int64_t>>().swap(deletions);
+
+	// 3) Node pixels are skeleton pixels that do not continue a chain, i.e. end-points and junctions. Loops without
+	// any node are found from their pixel with the lowest index, which is lower than both of its neighbours.
+	std::vector<std::vector<int64_t>> tileNodes(nTiles);
+	std::vector<std::vector<int64_t>> tileLoopStarts(nTiles);
+	std::vector<int64_t> tileSkeletonPixels(nTiles, 0);
+	ParallelFor(nTiles, nThreads, [&](int t)
+	{
+		if (tileWallPixels[t] == 0) { return; }
+		int64_t neighbours[8];
+		forEachPixel(t, [&](const int64_t& i)
+		{
+			if (!mask[i]) { return; }
+			tileSkeletonPixels[t] += 1;
+			int n = SkeletonNeighbours(mask.data(), i, nStride, neighbours);
+			if (n == 1 || n > 2) { tileNodes[t].push_back(i); }
+			if (n == 2 && neighbours[0] > i && neighbours[1] > i) { tileLoopStarts[t].push_back(i); }
+		});
+	});
+	std::vector<int64_t> nodePixels;
+	for (int t = 0; t < nTiles; t++)
+	{
+		nodePixels.insert(nodePixels.end(), tileNodes[t].begin(), tileNodes[t].end());
+	}
+
+	// Most loop starts are bends of chains between nodes, or further minima of a loop. Walk each chain once from
+	// its first start, marking its pixels with 2, and keep only the lowest pixel of every chain that closes into
+	// a loop, in the tile of that pixel. Later starts on a marked chain are skipped, so no pixel is walked twice.
+	std::vector<std::vector<int64_t>> loopStarts(nTiles);
+	for (int t = 0; t < nTiles; t++)
+	{
+		int64_t neighbours[8];
+		int64_t steps[8];
+		for (int64_t a : tileLoopStarts[t])
+		{
+			if (mask[a] == 2) { continue; }
+			mask[a] = 2;
+			SkeletonNeighbours(mask.data(), a, nStride, neighbours);
+			int64_t nPrevious = a;
+			int64_t nCurrent = neighbours[0];
+			int64_t nLowest = a;
+			while (nCurrent != a && mask[nCurrent] != 2 && SkeletonNeighbours(mask.data(), nCurrent, nStride, steps) == 2)
+			{
+				mask[nCurrent] = 2;
+				nLowest = std::min(nLowest, nCurrent);
+				int64_t nNext = (steps[0] == nPrevious) ? steps[1] : steps[0];
+				nPrevious = nCurrent;
+				nCurrent = nNext;
+			}
+			if (nCurrent != a) { continue; }
+			int nX = int(nLowest % nStride - 1);
+			int nY = int(nLowest / nStride - 1);
+			loopStarts[(nY / nTileSize) * nTilesX + nX / nTileSize].push_back(nLowest);
+		}
+	}
+	for (int t = 0; t < nTiles; t++)
+	{
+		std::sort(loopStarts[t].begin(), loopStarts[t].end());
+	}
+	tileLoopStarts.swap(loopStarts);
+	std::vector<std::vector<int64_t>>().swap(loopStarts);
+	std::sort(nodePixels.begin(), nodePixels.end());
+	auto findNodePixel = [&](const int64_t& i) -> int32_t
+	{
+		auto it = std::lower_bound(nodePixels.begin(), nodePixels.end(), i);
+		return (it != nodePixels.end() && *it == i) ? int32_t(it - nodePixels.begin()) : -1;
+	};
+	auto toPixelCenter = [&](const int64_t& i) -> olc::vf2d
+	{
+		return { float(i % nStride - 1) + 0.5f, float(i / nStride - 1) + 0.5f };
+	};
+
+	// Touching node pixels form one cluster, e.g. the pixels of a junction, placed at their mean
+	std::vector<int32_t> parent(nodePixels.size());
+	std::iota(parent.begin(), parent.end(), 0);
+	auto findRoot = [&](int32_t k)
+	{
+		while (parent[k] != k) { parent[k] = parent[parent[k]]; k = parent[k]; }
+		return k;
+	};
+	std::vector<uint8_t> nodeDegree(nodePixels.size());
+	for (int32_t k = 0; k < nodePixels.size(); k++)
+	{
+		int64_t neighbours[8];
+		int n = SkeletonNeighbours(mask.data(), nodePixels[k], nStride, neighbours);
+		nodeDegree[k] = uint8_t(n);
+		for (int j = 0; j < n; j++)
+		{
+			int32_t nOther = findNodePixel(neighbours[j]);
+			if (nOther != -1) { parent[findRoot(k)] = findRoot(nOther); }
+		}
+	}
+	std::vector<int32_t> nodeCluster(nodePixels.size(), -1);
+	std::vector<olc::vd2d> clusterSums;
+	std::vector<int32_t> clusterSizes;
+	std::vector<uint8_t> clusterEndpoint; // Single pixels with one neighbour
+	for (int32_t k = 0; k < nodePixels.size(); k++)
+	{
+		int32_t nRoot = findRoot(k);
+		if (nodeCluster[nRoot] == -1)
+		{
+			nodeCluster[nRoot] = int32_t(clusterSums.size());
+			clusterSums.push_back({ 0.0, 0.0 });
+			clusterSizes.push_back(0);
+			clusterEndpoint.push_back(nodeDegree[k] == 1);
+		}
+		int32_t c = nodeCluster[nRoot];
+		nodeCluster[k] = c;
+		olc::vf2d vCenter = toPixelCenter(nodePixels[k]);
+		clusterSums[c] += olc::vd2d{ vCenter.x, vCenter.y };
+		clusterSizes[c] += 1;
+		clusterEndpoint[c] = clusterSizes[c] == 1 && nodeDegree[k] == 1;
+	}
+	std::vector<olc::vf2d> clusterPositions(clusterSums.size());
+	for (size_t c = 0; c < clusterSums.size(); c++)
+	{
+		olc::vd2d vMean = clusterSums[c] / double(clusterSizes[c]);
+		clusterPositions[c] = { float(vMean.x), float(vMean.y) };
+	}
+
+	// 4) Trace the strokes from the node pixels and the loop starts of each tile and fit them. Every stroke is
+	// found from both of its ends, only the walk with the lower start is kept, every loop is walked once from its
+	// lowest pixel. Short strokes with a free end are
+	// noise or spurs that thinning leaves at the corners of thick walls.
+	std::vector<RasterStrokes> tileStrokes(nTiles);
+	ParallelFor(nTiles, nThreads, [&](int t)
+	{
+		RasterStrokes& strokes = tileStrokes[t];
+		std::vector<olc::vf2d> polyline;
+		int64_t neighbours[8];
+		int64_t steps[8];
+
+		// Fit a polyline and keep its points from "nFirst" to the second to last one
+		auto addStroke = [&](const int32_t& nStartCluster, const int32_t& nEndCluster, const int& nFirst)
+		{
+			std::vector<int> kept = DouglasPeucker(polyline, options.fTolerance);
+			strokes.strokeStarts.push_back(uint32_t(strokes.points.size()));
+			strokes.strokeClusters.push_back({ nStartCluster, nEndCluster });
+			for (int j = nFirst; j + 1 < kept.size(); j++) { strokes.points.push_back(polyline[kept[j]]); }
+		};
+
+		for (int64_t a : tileNodes[t])
+		{
+			int32_t nStartCluster = nodeCluster[findNodePixel(a)];
+			int n = SkeletonNeighbours(mask.data(), a, nStride, neighbours);
+			for (int j = 0; j < n; j++)
+			{
+				// Node pixels next to each other belong to the same cluster
+				if (findNodePixel(neighbours[j]) != -1) { continue; }
+				polyline.clear();
+				polyline.push_back(clusterPositions[nStartCluster]);
+				int64_t nPrevious = a;
+				int64_t nCurrent = neighbours[j];
+				while (SkeletonNeighbours(mask.data(), nCurrent, nStride, steps) == 2)
+				{
+					polyline.push_back(toPixelCenter(nCurrent));
+					int64_t nNext = (steps[0] == nPrevious) ? steps[1] : steps[0];
+					nPrevious = nCurrent;
+					nCurrent = nNext;
+				}
+				if (nCurrent < a || (nCurrent == a && nPrevious < neighbours[j])) { continue; }
+				int32_t nEndCluster = nodeCluster[findNodePixel(nCurrent)];
+				if ((clusterEndpoint[nStartCluster] || clusterEndpoint[nEndCluster]) && int(polyline.size()) + 1 < options.nMinStrokeLength) { continue; }
+				polyline.push_back(clusterPositions[nEndCluster]);
+				addStroke(nStartCluster, nEndCluster, 1);
+			}
+		}
+
+		for (int64_t a : tileLoopStarts[t])
+		{
+			SkeletonNeighbours(mask.data(), a, nStride, neighbours);
+			polyline.clear();
+			polyline.push_back(toPixelCenter(a));
+			int64_t nPrevious = a;
+			int64_t nCurrent = neighbours[0];
+			bool bLoop = false;
+			while (nCurrent > a && SkeletonNeighbours(mask.data(), nCurrent, nStride, steps) == 2)
+			{
+				polyline.push_back(toPixelCenter(nCurrent));
+				int64_t nNext = (steps[0] == nPrevious) ? steps[1] : steps[0];
+				nPrevious = nCurrent;
+				nCurrent = nNext;
+				if (nCurrent == a) { bLoop = true; break; }
+			}
+			if (!bLoop || int(polyline.size()) < options.nMinStrokeLength) { continue; }
+			polyline.push_back(polyline.front());
+			addStroke(-1, -1, 0);
+		}
+		strokes.strokeStarts.push_back(uint32_t(strokes.points.size()));
+	});
+
+	// 5) Assemble the strokes, a cluster becomes a node only if a stroke reaches it
+	float fPixelSize = options.fPixelSize;
+	auto toWorld = [&](const olc::vf2d& vPixel) -> olc::vf2d { return { vPixel.x * fPixelSize, -vPixel.y * fPixelSize }; };
+	std::vector<olc::vf2d> nodes;
+	std::vector<std::array<int, 2>> segments;
+	std::vector<int> clusterNodes(clusterPositions.size(), -1);
+	auto clusterNode = [&](const int32_t& c)
+	{
+		if (clusterNodes[c] == -1)
+		{
+			clusterNodes[c] = int(nodes.size());
+			nodes.push_back(toWorld(clusterPositions[c]));
+		}
+		return clusterNodes[c];
+	};
+	int nStrokes = 0;
+	for (int t = 0; t < nTiles; t++)
+	{
+		const RasterStrokes& strokes = tileStrokes[t];
+		for (size_t k = 0; k + 1 < strokes.strokeStarts.size(); k++)
+		{
+			uint32_t nBegin = strokes.strokeStarts[k];
+			uint32_t nEnd = strokes.strokeStarts[k + 1];
+			bool bLoop = strokes.strokeClusters[k][0] == -1;
+			int nFirstNode = bLoop ? int(nodes.size()) : clusterNode(strokes.strokeClusters[k][0]);
+			int nPrevious = nFirstNode;
+			for (uint32_t j = nBegin; j < nEnd; j++)
+			{
+				nodes.push_back(toWorld(strokes.points[j]));
+				if (nPrevious != int(nodes.size()) - 1) { segments.push_back({ nPrevious, int(nodes.size()) - 1 }); }
+				nPrevious = int(nodes.size()) - 1;
+			}
+			int nLastNode = bLoop ? nFirstNode : clusterNode(strokes.strokeClusters[k][1]);
+			if (nPrevious != nLastNode) { segments.push_back({ nPrevious, nLastNode }); }
+			nStrokes += 1;
+		}
+	}
+	std::vector<RasterStrokes>().swap(tileStrokes);
+
+	// Strokes that were split at a removed spur continue straight through their junction
+	std::vector<olc::vf2d> nodesMerged;
+	std::vector<std::array<int, 2>> segmentsMerged;
+	MergeCollinearSegments(nodes, segments, options.fTolerance * fPixelSize, &nodesMerged, &segmentsMerged);
+
+	std::vector<NodeHandle> nodeHandles(nodesMerged.size());
+	for (size_t i = 0; i < nodesMerged.size(); i++)
+	{
+		nodeHandles[i] = transaction->AddNode(nodesMerged[i]);
+	}
+	int nSegments = 0;
+	for (const std::array<int, 2>& segment : segmentsMerged)
+	{
+		if (transaction->AddSegment(nodeHandles[segment[0]], nodeHandles[segment[1]]).nSlot != -1) { nSegments += 1; }
+	}
+
+	if (stats)
+	{
+		stats->nWidth = nWidth;
+		stats->nHeight = nHeight;
+		stats->nWallPixels = nWallPixels;
+		stats->nSkeletonPixels = std::accumulate(tileSkeletonPixels.begin(), tileSkeletonPixels.end(), int64_t(0));
+		stats->nStrokes = nStrokes;
+		stats->nNodes = int(nodesMerged.size());
+		stats->nSegments = nSegments;
+	}
+	return true;
+}
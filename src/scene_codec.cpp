@@ -0,0 +1,291 @@
+#include "olcPixelGameEngine.h"
+#include "scene_codec.h"
+
+#include <cstring>
+#include <fstream>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+// Magic bytes at the start of a compressed scene
+static const char sCompressedSceneMagic[8] = { 'S', 'C', '2', 'D', 'Z', 'S', 'C', '\0' };
+
+
+// Zigzag mapping of signed values to unsigned ones, small magnitudes give small values
+static uint64_t ZigZag(const int64_t& nValue)
+{
+	return (uint64_t(nValue) << 1) ^ uint64_t(nValue >> 63);
+}
+
+static int64_t UnZigZag(const uint64_t& nValue)
+{
+	return int64_t(nValue >> 1) ^ -int64_t(nValue & 1);
+}
+
+// Append a varint, 7 bits per byte with the high bit set on all but the last byte
+static void WriteVarint(uint64_t nValue, std::vector<uint8_t>* data)
+{
+	while (nValue >= 0x80)
+	{
+		data->push_back(uint8_t(nValue) | 0x80);
+		nValue >>= 7;
+	}
+	data->push_back(uint8_t(nValue));
+}
+
+// Index of the lowest set bit of a non-zero word
+static int LowestSetBit(const uint64_t& nWord)
+{
+#if defined(_MSC_VER)
+	unsigned long nIndex;
+	_BitScanForward64(&nIndex, nWord);
+	return int(nIndex);
+#else
+	return __builtin_ctzll(nWord);
+#endif
+}
+
+// Read a varint of up to 8 bytes with one word load. The last byte is found from the high bits of all 8 bytes
+// at once and the 7-bit groups are packed in three steps, so there is no loop and no branch per byte.
+// Needs 8 readable bytes, which the padding of the stream guarantees. Returns "false" for longer varints.
+static bool ReadVarint(const uint8_t** p, uint64_t* nValue)
+{
+	uint64_t nWord;
+	std::memcpy(&nWord, *p, sizeof(uint64_t));
+	uint64_t nStops = ~nWord & 0x8080808080808080ull;
+	if (nStops == 0) { return false; }
+	int nBits = LowestSetBit(nStops) + 1;
+	uint64_t x = (nBits == 64 ? nWord : nWord & ((uint64_t(1) << nBits) - 1)) & 0x7F7F7F7F7F7F7F7Full;
+	x = ((x & 0x7F007F007F007F00ull) >> 1) | (x & 0x007F007F007F007Full);
+	x = ((x & 0x3FFF00003FFF0000ull) >> 2) | (x & 0x00003FFF00003FFFull);
+	x = ((x & 0x0FFFFFFF00000000ull) >> 4) | (x & 0x000000000FFFFFFFull);
+	*p += nBits >> 3;
+	*nValue = x;
+	return true;
+}
+
+// Interleave the bits of two grid coordinates
+static uint64_t MortonCode(const uint32_t& nX, const uint32_t& nY)
+{
+	auto spread = [](uint64_t v)
+	{
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+		return v;
+	};
+	return spread(nX) | (spread(nY) << 1);
+}
+
+
+// Compress a scene
+void EncodeScene(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const float& fQuantum, std::vector<uint8_t>* data)
+{
+	int nNodes = int(nodes.size());
+
+	// Grid coordinates relative to the lower corner of the scene
+	double fMinX = 0.0, fMinY = 0.0, fMaxX = 0.0, fMaxY = 0.0;
+	for (int i = 0; i < nNodes; i++)
+	{
+		if (i == 0 || nodes[i].x < fMinX) { fMinX = nodes[i].x; }
+		if (i == 0 || nodes[i].y < fMinY) { fMinY = nodes[i].y; }
+		if (i == 0 || nodes[i].x > fMaxX) { fMaxX = nodes[i].x; }
+		if (i == 0 || nodes[i].y > fMaxY) { fMaxY = nodes[i].y; }
+	}
+	double fStep = std::max({ double(fQuantum), (fMaxX - fMinX) / double(1 << 30), (fMaxY - fMinY) / double(1 << 30), 1e-30 });
+	std::vector<std::array<int32_t, 2>> grid(nNodes);
+	for (int i = 0; i < nNodes; i++)
+	{
+		grid[i] = { int32_t(std::llround((nodes[i].x - fMinX) / fStep)), int32_t(std::llround((nodes[i].y - fMinY) / fStep)) };
+	}
+
+	// Outgoing segments of every node
+	std::vector<int32_t> outOffsets(nNodes + 1, 0);
+	std::vector<uint8_t> hasIncoming(nNodes, 0);
+	int nValidSegments = 0;
+	for (int i = 0; i < segments.size(); i++)
+	{
+		if (segments[i][0] < 0 || segments[i][1] < 0 || segments[i][0] >= nNodes || segments[i][1] >= nNodes) { continue; }
+		outOffsets[segments[i][0] + 1] += 1;
+		hasIncoming[segments[i][1]] = 1;
+		nValidSegments += 1;
+	}
+	for (int i = 0; i < nNodes; i++)
+	{
+		outOffsets[i + 1] += outOffsets[i];
+	}
+	std::vector<int32_t> outCursor(outOffsets.begin(), outOffsets.end() - 1);
+	std::vector<int32_t> outNodes(nValidSegments);
+	for (int i = 0; i < segments.size(); i++)
+	{
+		if (segments[i][0] < 0 || segments[i][1] < 0 || segments[i][0] >= nNodes || segments[i][1] >= nNodes) { continue; }
+		outNodes[outCursor[segments[i][0]]++] = segments[i][1];
+	}
+	outCursor.assign(outOffsets.begin(), outOffsets.end() - 1);
+
+	// Chains follow unused segments in their direction. Walks start at nodes without incoming segments first, so
+	// open polylines become one chain each, and the cycles are left for the second pass.
+	std::vector<int32_t> chainNodes;
+	std::vector<int32_t> chainStarts;
+	chainNodes.reserve(nValidSegments + nNodes);
+	auto walk = [&](int32_t i_node)
+	{
+		chainStarts.push_back(int32_t(chainNodes.size()));
+		chainNodes.push_back(i_node);
+		while (outCursor[i_node] < outOffsets[i_node + 1])
+		{
+			i_node = outNodes[outCursor[i_node]++];
+			chainNodes.push_back(i_node);
+		}
+	};
+	for (int i = 0; i < nNodes; i++)
+	{
+		while (!hasIncoming[i] && outCursor[i] < outOffsets[i + 1]) { walk(i); }
+	}
+	for (int i = 0; i < nNodes; i++)
+	{
+		while (outCursor[i] < outOffsets[i + 1]) { walk(i); }
+	}
+	for (int i = 0; i < nNodes; i++)
+	{
+		if (!hasIncoming[i] && outOffsets[i] == outOffsets[i + 1]) { walk(i); }
+	}
+	int nChains = int(chainStarts.size());
+	chainStarts.push_back(int32_t(chainNodes.size()));
+
+	// Nearby chains follow each other
+	std::vector<std::pair<uint64_t, int32_t>> chainOrder(nChains);
+	for (int i = 0; i < nChains; i++)
+	{
+		const std::array<int32_t, 2>& start = grid[chainNodes[chainStarts[i]]];
+		chainOrder[i] = { MortonCode(uint32_t(start[0]), uint32_t(start[1])), i };
+	}
+	std::sort(chainOrder.begin(), chainOrder.end());
+
+	// Header first, its stream size is filled in at the end
+	data->assign(sizeof(CompressedSceneHeader), 0);
+	data->reserve(sizeof(CompressedSceneHeader) + 3 * size_t(nNodes) + size_t(nValidSegments) + size_t(nChains) + nSceneCodecPadding);
+	std::vector<int32_t> emitted(nNodes, -1);
+	int32_t nEmitted = 0;
+	std::array<int64_t, 2> cursor = { 0, 0 };
+	for (int c = 0; c < nChains; c++)
+	{
+		int32_t i_chain = chainOrder[c].second;
+		WriteVarint(uint64_t(chainStarts[i_chain + 1] - chainStarts[i_chain]), data);
+		for (int32_t k = chainStarts[i_chain]; k < chainStarts[i_chain + 1]; k++)
+		{
+			int32_t i_node = chainNodes[k];
+			if (emitted[i_node] != -1)
+			{
+				WriteVarint((uint64_t(nEmitted - 1 - emitted[i_node]) << 1) | 1, data);
+			}
+			else
+			{
+				WriteVarint(ZigZag(grid[i_node][0] - cursor[0]) << 1, data);
+				WriteVarint(ZigZag(grid[i_node][1] - cursor[1]), data);
+				emitted[i_node] = nEmitted++;
+			}
+			cursor = { grid[i_node][0], grid[i_node][1] };
+		}
+	}
+
+	CompressedSceneHeader header = {};
+	std::memcpy(header.sMagic, sCompressedSceneMagic, sizeof(sCompressedSceneMagic));
+	header.nVersion = nSceneCodecVersion;
+	header.fOriginX = fMinX;
+	header.fOriginY = fMinY;
+	header.fQuantum = fStep;
+	header.nNodes = uint64_t(nEmitted);
+	header.nSegments = uint64_t(nValidSegments);
+	header.nChains = uint64_t(nChains);
+	header.nStreamBytes = data->size() - sizeof(CompressedSceneHeader);
+	std::memcpy(data->data(), &header, sizeof(CompressedSceneHeader));
+	data->resize(data->size() + nSceneCodecPadding, 0);
+}
+
+// Decompress a scene
+bool DecodeScene(const uint8_t* pData, const size_t& nSize, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments)
+{
+	CompressedSceneHeader header;
+	if (nSize < sizeof(CompressedSceneHeader)) { return false; }
+	std::memcpy(&header, pData, sizeof(CompressedSceneHeader));
+	if (std::memcmp(header.sMagic, sCompressedSceneMagic, sizeof(sCompressedSceneMagic)) != 0 || header.nVersion != nSceneCodecVersion) { return false; }
+	if (header.nStreamBytes > nSize - sizeof(CompressedSceneHeader) || nSize - sizeof(CompressedSceneHeader) - header.nStreamBytes < nSceneCodecPadding) { return false; }
+	// Every node and segment takes at least one byte of the stream
+	if (header.nNodes > header.nStreamBytes || header.nSegments > header.nStreamBytes || header.nChains > header.nStreamBytes) { return false; }
+
+	// The output is written through raw pointers, the header bounds every index. Every varint starts before the end
+	// of the stream, so the padding covers the bytes a varint reads past it.
+	const uint8_t* p = pData + sizeof(CompressedSceneHeader);
+	const uint8_t* pEnd = p + header.nStreamBytes;
+	nodes->resize(header.nNodes);
+	segments->resize(header.nSegments);
+	std::vector<std::array<int64_t, 2>> grid(header.nNodes);
+	olc::vf2d* pNodes = nodes->data();
+	std::array<int, 2>* pSegments = segments->data();
+	std::array<int64_t, 2>* pGrid = grid.data();
+	uint64_t nNodes = 0;
+	uint64_t nSegments = 0;
+	int64_t nX = 0;
+	int64_t nY = 0;
+	for (uint64_t c = 0; c < header.nChains; c++)
+	{
+		uint64_t nLength;
+		if (p >= pEnd || !ReadVarint(&p, &nLength) || nLength == 0 || nLength > uint64_t(pEnd - p) || nSegments + nLength - 1 > header.nSegments) { return false; }
+		int i_previous = -1;
+		for (uint64_t k = 0; k < nLength; k++)
+		{
+			uint64_t nToken;
+			if (p >= pEnd || !ReadVarint(&p, &nToken)) { return false; }
+			int i_node;
+			if (nToken & 1)
+			{
+				uint64_t nBack = nToken >> 1;
+				if (nBack >= nNodes) { return false; }
+				i_node = int(nNodes - 1 - nBack);
+				nX = pGrid[i_node][0];
+				nY = pGrid[i_node][1];
+			}
+			else
+			{
+				uint64_t nDy;
+				if (p >= pEnd || !ReadVarint(&p, &nDy) || nNodes == header.nNodes) { return false; }
+				nX += UnZigZag(nToken >> 1);
+				nY += UnZigZag(nDy);
+				i_node = int(nNodes++);
+				pGrid[i_node] = { nX, nY };
+				pNodes[i_node] = { float(header.fOriginX + double(nX) * header.fQuantum), float(header.fOriginY + double(nY) * header.fQuantum) };
+			}
+			if (i_previous != -1) { pSegments[nSegments++] = { i_previous, i_node }; }
+			i_previous = i_node;
+		}
+		if (p > pEnd) { return false; }
+	}
+	return p == pEnd && nNodes == header.nNodes && nSegments == header.nSegments;
+}
+
+// Write a compressed scene file
+bool SaveCompressedScene(const std::string& sPath, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const float& fQuantum)
+{
+	std::vector<uint8_t> data;
+	EncodeScene(nodes, segments, fQuantum, &data);
+	std::ofstream file(sPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) { return false; }
+	file.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+	return bool(file);
+}
+
+// Read a compressed scene file
+bool LoadCompressedScene(const std::string& sPath, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments)
+{
+	std::ifstream file(sPath, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) { return false; }
+	std::vector<uint8_t> data(size_t(file.tellg()));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size()))) { return false; }
+	return DecodeScene(data.data(), data.size(), nodes, segments);
+}
@@ -0,0 +1,346 @@
+#include "olcPixelGameEngine.h"
+#include "scene_file.h"
+
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SCENE_FILE_MMAP
+#endif
+
+
+// Magic bytes at the start of a scene file
+static const char sSceneMagic[8] = { 'S', 'C', '2', 'D', 'S', 'C', 'N', '\0' };
+
+
+// Round an offset up to the array alignment
+static uint64_t AlignOffset(const uint64_t& nOffset)
+{
+	return (nOffset + nSceneAlignment - 1) / nSceneAlignment * nSceneAlignment;
+}
+
+
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+// Map a scene file and check its header
+bool SceneFile::Open(const std::string& sPath)
+{
+	Close();
+
+#ifdef SCENE_FILE_MMAP
+	int fd = open(sPath.c_str(), O_RDONLY);
+	if (fd == -1) { return false; }
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < off_t(sizeof(SceneHeader)))
+	{
+		close(fd);
+		return false;
+	}
+	void* pMapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (pMapping == MAP_FAILED) { return false; }
+	pData = static_cast<const uint8_t*>(pMapping);
+	nSize = uint64_t(info.st_size);
+	bMapped = true;
+#else
+	std::ifstream file(sPath, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) { return false; }
+	nSize = uint64_t(file.tellg());
+	buffer.resize((nSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(buffer.data()), std::streamsize(nSize));
+	pData = reinterpret_cast<const uint8_t*>(buffer.data());
+	if (!file || nSize < sizeof(SceneHeader))
+	{
+		Close();
+		return false;
+	}
+#endif
+
+	// The header and the array bounds are checked, the node and segment arrays are used as they are
+	pHeader = reinterpret_cast<const SceneHeader*>(pData);
+	bool bValid = std::memcmp(pHeader->sMagic, sSceneMagic, sizeof(sSceneMagic)) == 0 && pHeader->nVersion == nSceneVersion &&
+		IsArrayValid(pHeader->nNodeXOffset, pHeader->nNodes, sizeof(float)) &&
+		IsArrayValid(pHeader->nNodeYOffset, pHeader->nNodes, sizeof(float)) &&
+		IsArrayValid(pHeader->nSegmentStartOffset, pHeader->nSegments, sizeof(uint32_t)) &&
+		IsArrayValid(pHeader->nSegmentEndOffset, pHeader->nSegments, sizeof(uint32_t));
+	if (bValid && (pHeader->nFlags & nSceneFlagGrid))
+	{
+		uint64_t nCells = uint64_t(pHeader->nGridWidth) * uint64_t(pHeader->nGridHeight);
+		bValid = pHeader->fGridCellSize > 0.0f && pHeader->nGridWidth > 0 && pHeader->nGridHeight > 0 &&
+			IsArrayValid(pHeader->nGridCellOffset, nCells + 1, sizeof(uint32_t)) &&
+			IsArrayValid(pHeader->nGridEntryOffset, pHeader->nGridEntries, sizeof(uint32_t)) &&
+			std::isfinite(pHeader->fGridMinX) && std::isfinite(pHeader->fGridMinY) && std::isfinite(pHeader->fGridCellSize);
+
+		// Grid queries index the entries through the cell offsets and the segments through the entries without
+		// checks, so both are validated once here
+		if (bValid)
+		{
+			const uint32_t* cellOffsets = reinterpret_cast<const uint32_t*>(pData + pHeader->nGridCellOffset);
+			const uint32_t* entries = reinterpret_cast<const uint32_t*>(pData + pHeader->nGridEntryOffset);
+			bValid = cellOffsets[0] == 0 && cellOffsets[nCells] == pHeader->nGridEntries;
+			for (uint64_t i = 0; i < nCells && bValid; i++)
+			{
+				bValid = cellOffsets[i] <= cellOffsets[i + 1];
+			}
+			for (uint64_t i = 0; i < pHeader->nGridEntries && bValid; i++)
+			{
+				bValid = entries[i] < pHeader->nSegments;
+			}
+		}
+	}
+	if (!bValid)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// Unmap the file
+void SceneFile::Close()
+{
+#ifdef SCENE_FILE_MMAP
+	if (bMapped) { munmap(const_cast<uint8_t*>(pData), size_t(nSize)); }
+#endif
+	buffer.clear();
+	buffer.shrink_to_fit();
+	pData = nullptr;
+	pHeader = nullptr;
+	nSize = 0;
+	bMapped = false;
+}
+
+bool SceneFile::IsOpen() const
+{
+	return pHeader != nullptr;
+}
+
+// Check that an array lies inside the file and is aligned
+bool SceneFile::IsArrayValid(const uint64_t& nOffset, const uint64_t& nCount, const uint64_t& nElementSize) const
+{
+	return nOffset % nSceneAlignment == 0 && nOffset <= nSize && nCount <= (nSize - nOffset) / nElementSize;
+}
+
+uint64_t SceneFile::GetNodeCount() const
+{
+	return pHeader->nNodes;
+}
+
+uint64_t SceneFile::GetSegmentCount() const
+{
+	return pHeader->nSegments;
+}
+
+const float* SceneFile::GetNodeX() const
+{
+	return reinterpret_cast<const float*>(pData + pHeader->nNodeXOffset);
+}
+
+const float* SceneFile::GetNodeY() const
+{
+	return reinterpret_cast<const float*>(pData + pHeader->nNodeYOffset);
+}
+
+const uint32_t* SceneFile::GetSegmentStart() const
+{
+	return reinterpret_cast<const uint32_t*>(pData + pHeader->nSegmentStartOffset);
+}
+
+const uint32_t* SceneFile::GetSegmentEnd() const
+{
+	return reinterpret_cast<const uint32_t*>(pData + pHeader->nSegmentEndOffset);
+}
+
+// Check if the file has a grid of the segments
+bool SceneFile::HasGrid() const
+{
+	return pHeader && (pHeader->nFlags & nSceneFlagGrid) != 0;
+}
+
+// Segments in the grid cells that overlap a box, each of them once
+bool SceneFile::FindSegmentsInBox(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<uint32_t>* foundSegments) const
+{
+	foundSegments->clear();
+	if (!(pHeader->nFlags & nSceneFlagGrid)) { return false; }
+
+	const uint32_t* cellOffsets = reinterpret_cast<const uint32_t*>(pData + pHeader->nGridCellOffset);
+	const uint32_t* entries = reinterpret_cast<const uint32_t*>(pData + pHeader->nGridEntryOffset);
+	auto cellCoordinate = [&](const float& fValue, const float& fOrigin, const uint32_t& nCells)
+	{
+		float fCell = std::floor((fValue - fOrigin) / pHeader->fGridCellSize);
+		return int64_t(std::min(std::max(fCell, 0.0f), float(nCells - 1)));
+	};
+	if (vMax.x < pHeader->fGridMinX || vMax.y < pHeader->fGridMinY) { return true; }
+	int64_t x0 = cellCoordinate(vMin.x, pHeader->fGridMinX, pHeader->nGridWidth);
+	int64_t y0 = cellCoordinate(vMin.y, pHeader->fGridMinY, pHeader->nGridHeight);
+	int64_t x1 = cellCoordinate(vMax.x, pHeader->fGridMinX, pHeader->nGridWidth);
+	int64_t y1 = cellCoordinate(vMax.y, pHeader->fGridMinY, pHeader->nGridHeight);
+	for (int64_t y = y0; y <= y1; y++)
+	{
+		for (int64_t x = x0; x <= x1; x++)
+		{
+			int64_t nCell = y * pHeader->nGridWidth + x;
+			foundSegments->insert(foundSegments->end(), entries + cellOffsets[nCell], entries + cellOffsets[nCell + 1]);
+		}
+	}
+
+	// Segments that span several cells are listed in each of them
+	std::sort(foundSegments->begin(), foundSegments->end());
+	foundSegments->erase(std::unique(foundSegments->begin(), foundSegments->end()), foundSegments->end());
+	return true;
+}
+
+// Write a scene file
+bool SaveScene(const std::string& sPath, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const bool& bGrid)
+{
+	SceneHeader header = {};
+	std::memcpy(header.sMagic, sSceneMagic, sizeof(sSceneMagic));
+	header.nVersion = nSceneVersion;
+	header.nNodes = nodes.size();
+	header.nSegments = segments.size();
+
+	// Structure of arrays
+	std::vector<float> nodeX(nodes.size()), nodeY(nodes.size());
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		nodeX[i] = nodes[i].x;
+		nodeY[i] = nodes[i].y;
+	}
+	std::vector<uint32_t> segmentStart(segments.size()), segmentEnd(segments.size());
+	for (int i = 0; i < segments.size(); i++)
+	{
+		segmentStart[i] = uint32_t(segments[i][0]);
+		segmentEnd[i] = uint32_t(segments[i][1]);
+	}
+
+	// Grid with about two segments per cell, counted first and filled second
+	std::vector<uint32_t> cellOffsets, entries;
+	if (bGrid && !nodes.empty() && !segments.empty())
+	{
+		olc::vf2d vMin = nodes[0];
+		olc::vf2d vMax = nodes[0];
+		for (int i = 1; i < nodes.size(); i++)
+		{
+			vMin = vMin.min(nodes[i]);
+			vMax = vMax.max(nodes[i]);
+		}
+		olc::vf2d vExtent = (vMax - vMin).max({ 1.0f, 1.0f });
+		float fCellSize = std::sqrt(vExtent.x * vExtent.y / std::max(float(segments.size()) * 0.5f, 1.0f));
+		fCellSize = std::max({ fCellSize, vExtent.x / 4096.0f, vExtent.y / 4096.0f });
+		uint32_t nWidth = uint32_t(vExtent.x / fCellSize) + 1;
+		uint32_t nHeight = uint32_t(vExtent.y / fCellSize) + 1;
+
+		header.nFlags |= nSceneFlagGrid;
+		header.fGridMinX = vMin.x;
+		header.fGridMinY = vMin.y;
+		header.fGridCellSize = fCellSize;
+		header.nGridWidth = nWidth;
+		header.nGridHeight = nHeight;
+
+		auto forEachCell = [&](const int& i, auto visit)
+		{
+			const olc::vf2d& vStart = nodes[segments[i][0]];
+			const olc::vf2d& vEnd = nodes[segments[i][1]];
+			olc::vf2d vSegmentMin = vStart.min(vEnd) - vMin;
+			olc::vf2d vSegmentMax = vStart.max(vEnd) - vMin;
+			uint32_t x0 = std::min(uint32_t(vSegmentMin.x / fCellSize), nWidth - 1);
+			uint32_t y0 = std::min(uint32_t(vSegmentMin.y / fCellSize), nHeight - 1);
+			uint32_t x1 = std::min(uint32_t(vSegmentMax.x / fCellSize), nWidth - 1);
+			uint32_t y1 = std::min(uint32_t(vSegmentMax.y / fCellSize), nHeight - 1);
+			for (uint32_t y = y0; y <= y1; y++)
+			{
+				for (uint32_t x = x0; x <= x1; x++) { visit(y * nWidth + x); }
+			}
+		};
+		cellOffsets.assign(size_t(nWidth) * nHeight + 1, 0);
+		for (int i = 0; i < segments.size(); i++)
+		{
+			forEachCell(i, [&](const uint32_t& nCell) { cellOffsets[nCell + 1] += 1; });
+		}
+		for (size_t i = 1; i < cellOffsets.size(); i++)
+		{
+			cellOffsets[i] += cellOffsets[i - 1];
+		}
+		entries.resize(cellOffsets.back());
+		std::vector<uint32_t> cellFill(cellOffsets.begin(), cellOffsets.end() - 1);
+		for (int i = 0; i < segments.size(); i++)
+		{
+			forEachCell(i, [&](const uint32_t& nCell) { entries[cellFill[nCell]++] = uint32_t(i); });
+		}
+		header.nGridEntries = entries.size();
+	}
+
+	// Layout of the arrays
+	uint64_t nOffset = AlignOffset(sizeof(SceneHeader));
+	auto place = [&](uint64_t* nArrayOffset, const uint64_t& nBytes)
+	{
+		*nArrayOffset = nOffset;
+		nOffset = AlignOffset(nOffset + nBytes);
+	};
+	place(&header.nNodeXOffset, nodeX.size() * sizeof(float));
+	place(&header.nNodeYOffset, nodeY.size() * sizeof(float));
+	place(&header.nSegmentStartOffset, segmentStart.size() * sizeof(uint32_t));
+	place(&header.nSegmentEndOffset, segmentEnd.size() * sizeof(uint32_t));
+	if (header.nFlags & nSceneFlagGrid)
+	{
+		place(&header.nGridCellOffset, cellOffsets.size() * sizeof(uint32_t));
+		place(&header.nGridEntryOffset, entries.size() * sizeof(uint32_t));
+	}
+
+	// Write the header and the arrays with zero padding in between
+	std::ofstream file(sPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) { return false; }
+	uint64_t nWritten = 0;
+	auto write = [&](const uint64_t& nArrayOffset, const void* pArray, const uint64_t& nBytes)
+	{
+		static const char padding[nSceneAlignment] = {};
+		file.write(padding, std::streamsize(nArrayOffset - nWritten));
+		file.write(static_cast<const char*>(pArray), std::streamsize(nBytes));
+		nWritten = nArrayOffset + nBytes;
+	};
+	write(0, &header, sizeof(SceneHeader));
+	write(header.nNodeXOffset, nodeX.data(), nodeX.size() * sizeof(float));
+	write(header.nNodeYOffset, nodeY.data(), nodeY.size() * sizeof(float));
+	write(header.nSegmentStartOffset, segmentStart.data(), segmentStart.size() * sizeof(uint32_t));
+	write(header.nSegmentEndOffset, segmentEnd.data(), segmentEnd.size() * sizeof(uint32_t));
+	if (header.nFlags & nSceneFlagGrid)
+	{
+		write(header.nGridCellOffset, cellOffsets.data(), cellOffsets.size() * sizeof(uint32_t));
+		write(header.nGridEntryOffset, entries.data(), entries.size() * sizeof(uint32_t));
+	}
+	return bool(file);
+}
+
+// Copy the geometry of an open scene file
+bool LoadScene(const SceneFile& file, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments)
+{
+	if (!file.IsOpen()) { return false; }
+
+	const float* nodeX = file.GetNodeX();
+	const float* nodeY = file.GetNodeY();
+	const uint32_t* segmentStart = file.GetSegmentStart();
+	const uint32_t* segmentEnd = file.GetSegmentEnd();
+	uint64_t nNodes = file.GetNodeCount();
+	uint64_t nSegments = file.GetSegmentCount();
+
+	nodes->resize(nNodes);
+	for (uint64_t i = 0; i < nNodes; i++)
+	{
+		(*nodes)[i] = { nodeX[i], nodeY[i] };
+	}
+	segments->resize(nSegments);
+	for (uint64_t i = 0; i < nSegments; i++)
+	{
+		if (segmentStart[i] >= nNodes || segmentEnd[i] >= nNodes) { return false; }
+		(*segments)[i] = { int(segmentStart[i]), int(segmentEnd[i]) };
+	}
+	return true;
+}
@@ -0,0 +1,221 @@
+#include "olcPixelGameEngine.h"
+#include "scene_reload.h"
+
+#include <cstring>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#define FILE_WATCHER_INOTIFY
+#endif
+
+
+// Key of an exact position, both zeros give the same key
+static uint64_t PositionKey(const olc::vf2d& vPosition)
+{
+	float fX = vPosition.x == 0.0f ? 0.0f : vPosition.x;
+	float fY = vPosition.y == 0.0f ? 0.0f : vPosition.y;
+	uint32_t nX, nY;
+	std::memcpy(&nX, &fX, sizeof(uint32_t));
+	std::memcpy(&nY, &fY, sizeof(uint32_t));
+	return (uint64_t(nX) << 32) | uint64_t(nY);
+}
+
+#ifndef FILE_WATCHER_INOTIFY
+// Modification time of a file, 0 if it does not exist
+static int64_t LastWriteTime(const std::string& sPath)
+{
+	std::error_code error;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(sPath, error);
+	return error ? 0 : int64_t(time.time_since_epoch().count());
+}
+#endif
+
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+// Start watching a file
+bool FileWatcher::Watch(const std::string& sPath)
+{
+	Stop();
+	std::filesystem::path path(sPath);
+	std::string sDirectory = path.has_parent_path() ? path.parent_path().string() : std::string(".");
+	sFilePath = sPath;
+	sFileName = path.filename().string();
+
+#ifdef FILE_WATCHER_INOTIFY
+	// Events of the directory, the file itself may be replaced
+	nDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (nDescriptor < 0) { return false; }
+	nWatch = inotify_add_watch(nDescriptor, sDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (nWatch < 0)
+	{
+		close(nDescriptor);
+		nDescriptor = -1;
+		return false;
+	}
+#else
+	std::error_code error;
+	if (!std::filesystem::is_directory(sDirectory, error)) { return false; }
+	nLastWriteTime = LastWriteTime(sFilePath);
+#endif
+	bWatching = true;
+	return true;
+}
+
+// Stop watching
+void FileWatcher::Stop()
+{
+#ifdef FILE_WATCHER_INOTIFY
+	if (nDescriptor >= 0) { close(nDescriptor); }
+#endif
+	nDescriptor = -1;
+	nWatch = -1;
+	bWatching = false;
+}
+
+bool FileWatcher::IsWatching() const
+{
+	return bWatching;
+}
+
+// Check for changes without blocking
+bool FileWatcher::Poll()
+{
+	if (!bWatching) { return false; }
+	bool bChanged = false;
+
+#ifdef FILE_WATCHER_INOTIFY
+	// Drain all events, a lost queue may have held one for the file
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		ssize_t nRead = read(nDescriptor, buffer, sizeof(buffer));
+		if (nRead <= 0) { break; }
+		for (const char* p = buffer; p < buffer + nRead; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+			if (event->mask & IN_Q_OVERFLOW) { bChanged = true; }
+			if (event->len > 0 && sFileName == event->name) { bChanged = true; }
+			p += sizeof(inotify_event) + event->len;
+		}
+	}
+#else
+	int64_t nWriteTime = LastWriteTime(sFilePath);
+	bChanged = nWriteTime != nLastWriteTime && nWriteTime != 0;
+	nLastWriteTime = nWriteTime;
+#endif
+	return bChanged;
+}
+
+
+// Turn the geometry into a new version of it with as few edits as possible
+void ApplySceneDiff(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	GeometryStore* geometry, GeometryTransaction* transaction, SceneDiffStats* stats)
+{
+	// Everything is planned on the unchanged geometry, the packed indices stay valid until the first edit
+	const std::vector<olc::vf2d>& nodesOld = geometry->GetNodes();
+	const std::vector<std::array<int, 2>>& segmentsOld = geometry->GetSegments();
+	int nOld = int(nodesOld.size());
+	int nNew = int(nodes.size());
+
+	// Match the nodes at the same position, nodes that share a position are matched in order
+	std::vector<std::pair<uint64_t, int>> keysOld(nOld), keysNew(nNew);
+	for (int i = 0; i < nOld; i++) { keysOld[i] = { PositionKey(nodesOld[i]), i }; }
+	for (int i = 0; i < nNew; i++) { keysNew[i] = { PositionKey(nodes[i]), i }; }
+	std::sort(keysOld.begin(), keysOld.end());
+	std::sort(keysNew.begin(), keysNew.end());
+	std::vector<int> oldToNew(nOld, -1), newToOld(nNew, -1);
+	for (int i = 0, j = 0; i < nOld && j < nNew; )
+	{
+		if      (keysOld[i].first < keysNew[j].first) { i++; }
+		else if (keysNew[j].first < keysOld[i].first) { j++; }
+		else
+		{
+			oldToNew[keysOld[i].second] = keysNew[j].second;
+			newToOld[keysNew[j].second] = keysOld[i].second;
+			i++;
+			j++;
+		}
+	}
+	std::vector<NodeHandle> handlesOld(nOld);
+	for (int i = 0; i < nOld; i++) { handlesOld[i] = geometry->GetNodeHandle(i); }
+
+	// A moved node keeps at least one neighbour in place, it is paired with an unmatched neighbour of that
+	// neighbour in the old geometry
+	std::vector<int> offsets, adjacentSegments;
+	BuildNodeAdjacency(nNew, segments, &offsets, &adjacentSegments);
+	std::vector<uint8_t> moved(nNew, 0);
+	std::vector<NodeHandle> neighbours;
+	for (int i = 0; i < nNew; i++)
+	{
+		if (newToOld[i] != -1) { continue; }
+		for (int k = offsets[i]; k < offsets[i + 1] && newToOld[i] == -1; k++)
+		{
+			const std::array<int, 2>& segment = segments[adjacentSegments[k]];
+			int i_other = (segment[0] == i) ? segment[1] : segment[0];
+			if (newToOld[i_other] == -1 || moved[i_other]) { continue; }
+			geometry->GetNeighbourNodes(handlesOld[newToOld[i_other]], &neighbours);
+			for (const NodeHandle& hNeighbour : neighbours)
+			{
+				int j = geometry->GetNodeIndex(hNeighbour);
+				if (oldToNew[j] != -1) { continue; }
+				oldToNew[j] = i;
+				newToOld[i] = j;
+				moved[i] = 1;
+				break;
+			}
+		}
+	}
+
+	// Segments between matched nodes that already exist are kept
+	std::vector<uint8_t> kept(segmentsOld.size(), 0);
+	std::vector<int> segmentsAdded;
+	for (int i = 0; i < segments.size(); i++)
+	{
+		if (segments[i][0] == segments[i][1]) { continue; }
+		int i_start = newToOld[segments[i][0]];
+		int i_end = newToOld[segments[i][1]];
+		SegmentHandle hSegment;
+		if (i_start != -1 && i_end != -1) { hSegment = geometry->FindSegment(handlesOld[i_start], handlesOld[i_end]); }
+		if (hSegment.nSlot != -1) { kept[geometry->GetSegmentIndex(hSegment)] = 1; }
+		else                      { segmentsAdded.push_back(i); }
+	}
+	std::vector<SegmentHandle> segmentsDeleted;
+	for (int i = 0; i < segmentsOld.size(); i++)
+	{
+		if (!kept[i]) { segmentsDeleted.push_back(geometry->GetSegmentHandle(i)); }
+	}
+
+	// Apply the differences
+	SceneDiffStats diff;
+	for (const SegmentHandle& hSegment : segmentsDeleted)
+	{
+		if (transaction->DeleteSegment(hSegment)) { diff.nDeletedSegments += 1; }
+	}
+	for (int i = 0; i < nOld; i++)
+	{
+		if (oldToNew[i] == -1 && transaction->DeleteNode(handlesOld[i])) { diff.nDeletedNodes += 1; }
+	}
+	std::vector<NodeHandle> handlesNew(nNew);
+	for (int i = 0; i < nNew; i++)
+	{
+		if (newToOld[i] == -1)
+		{
+			handlesNew[i] = transaction->AddNode(nodes[i]);
+			diff.nAddedNodes += 1;
+			continue;
+		}
+		handlesNew[i] = handlesOld[newToOld[i]];
+		if (moved[i] && transaction->MoveNode(handlesNew[i], nodes[i])) { diff.nMovedNodes += 1; }
+	}
+	for (int i : segmentsAdded)
+	{
+		if (transaction->AddSegment(handlesNew[segments[i][0]], handlesNew[segments[i][1]]).nSlot != -1) { diff.nAddedSegments += 1; }
+	}
+	if (stats) { *stats = diff; }
+}
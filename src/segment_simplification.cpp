@@ -0,0 +1,267 @@
+#include "olcPixelGameEngine.h"
+#include "segment_simplification.h"
+
+#include <unordered_set>
+
+
+// Split the segment graph into chains that run between nodes without exactly two connections.
+// Closed loops where every node has two connections are returned with the first node repeated at the end.
+static void ExtractSegmentChains(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	const std::vector<int>& offsets, const std::vector<int>& adjacentSegments, std::vector<std::vector<int>>* chains)
+{
+	std::vector<bool> visited(segments.size(), false);
+
+	// Walk from "i_start" along "i_segment" until a node without exactly two connections is reached
+	auto walk = [&](int i_start, int i_segment)
+	{
+		std::vector<int> chain;
+		chain.push_back(i_start);
+		int i_current = i_start;
+		while (!visited[i_segment])
+		{
+			visited[i_segment] = true;
+			i_current = (segments[i_segment][0] == i_current) ? segments[i_segment][1] : segments[i_segment][0];
+			chain.push_back(i_current);
+
+			// Stop at the end of the chain
+			if (offsets[i_current + 1] - offsets[i_current] != 2) { break; }
+
+			// Continue along the other connected segment
+			int i_first = adjacentSegments[offsets[i_current]];
+			i_segment = (i_first == i_segment) ? adjacentSegments[offsets[i_current] + 1] : i_first;
+		}
+		chains->push_back(std::move(chain));
+	};
+
+	// Chains that start and end at an end-point or a junction
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (offsets[i + 1] - offsets[i] == 2) { continue; }
+		for (int j = offsets[i]; j < offsets[i + 1]; j++)
+		{
+			if (!visited[adjacentSegments[j]]) { walk(i, adjacentSegments[j]); }
+		}
+	}
+	// Remaining segments form closed loops
+	for (int i = 0; i < segments.size(); i++)
+	{
+		if (!visited[i]) { walk(segments[i][0], i); }
+	}
+}
+
+// Assemble the simplified geometry from the kept nodes of each chain
+static void AssembleSimplifiedGeometry(const std::vector<olc::vf2d>& nodes, const std::vector<int>& offsets,
+	const std::vector<std::vector<int>>& chains, std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut)
+{
+	// Nodes that are not part of any chain or end a chain are always kept
+	std::vector<int> remap(nodes.size(), -1);
+	std::vector<bool> keep(nodes.size(), false);
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		keep[i] = (offsets[i + 1] - offsets[i] != 2);
+	}
+	for (int i = 0; i < chains.size(); i++)
+	{
+		for (int j = 0; j < chains[i].size(); j++)
+		{
+			keep[chains[i][j]] = true;
+		}
+	}
+
+	// Re-number the kept nodes in their original order
+	nodesOut->clear();
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		if (keep[i])
+		{
+			remap[i] = int(nodesOut->size());
+			nodesOut->push_back(nodes[i]);
+		}
+	}
+
+	// Connect consecutive kept nodes, skipping degenerate and duplicate segments
+	std::unordered_set<int64_t> existing;
+	segmentsOut->clear();
+	for (int i = 0; i < chains.size(); i++)
+	{
+		for (int j = 0; j + 1 < chains[i].size(); j++)
+		{
+			int a = remap[chains[i][j]];
+			int b = remap[chains[i][j + 1]];
+			if (a == b) { continue; }
+			int64_t key = (int64_t(std::min(a, b)) << 32) | int64_t(std::max(a, b));
+			if (existing.insert(key).second)
+			{
+				segmentsOut->push_back({ a, b });
+			}
+		}
+	}
+}
+
+
+// Douglas-Peucker simplification of an open polyline. Returns the indices of the kept points.
+std::vector<int> DouglasPeucker(const std::vector<olc::vf2d>& polyline, const float& fTolerance)
+{
+	std::vector<int> kept;
+	if (polyline.size() < 3)
+	{
+		for (int i = 0; i < polyline.size(); i++) { kept.push_back(i); }
+		return kept;
+	}
+
+	// Explicit stack instead of recursion, long chains would overflow the call stack
+	std::vector<bool> keep(polyline.size(), false);
+	std::vector<std::array<int, 2>> stack;
+	keep.front() = true;
+	keep.back() = true;
+	stack.push_back({ 0, int(polyline.size()) - 1 });
+	float fToleranceSquared = fTolerance * fTolerance;
+	while (!stack.empty())
+	{
+		std::array<int, 2> range = stack.back();
+		stack.pop_back();
+
+		// Find the point that is the furthest away from the line
+		int i_max = -1;
+		float fMaxDistance = -1.0f;
+		for (int i = range[0] + 1; i < range[1]; i++)
+		{
+			float fDistance = EuclideanDistanceToLineSquared(polyline[range[0]], polyline[range[1]], polyline[i]);
+			if (fDistance > fMaxDistance)
+			{
+				fMaxDistance = fDistance;
+				i_max = i;
+			}
+		}
+		// Split the range if the error is too large
+		if (i_max != -1 && fMaxDistance > fToleranceSquared)
+		{
+			keep[i_max] = true;
+			stack.push_back({ range[0], i_max });
+			stack.push_back({ i_max, range[1] });
+		}
+	}
+
+	for (int i = 0; i < polyline.size(); i++)
+	{
+		if (keep[i]) { kept.push_back(i); }
+	}
+	return kept;
+}
+
+// Simplify one chain with Douglas-Peucker, closed loops are split at the node furthest away from the start
+static void SimplifyChain(const std::vector<olc::vf2d>& nodes, const float& fTolerance, std::vector<int>* chain, std::vector<olc::vf2d>* polyline)
+{
+	int i_split = int(chain->size()) - 1;
+	if (chain->front() == chain->back())
+	{
+		float fMaxDistance = -1.0f;
+		for (int j = 1; j + 1 < chain->size(); j++)
+		{
+			float fDistance = EuclideanDistanceSquared(nodes[chain->front()], nodes[(*chain)[j]]);
+			if (fDistance > fMaxDistance)
+			{
+				fMaxDistance = fDistance;
+				i_split = j;
+			}
+		}
+	}
+
+	// Simplify each part of the chain
+	std::vector<int> simplified;
+	simplified.reserve(chain->size());
+	simplified.push_back(chain->front());
+	for (int part = 0; part < 2; part++)
+	{
+		int i_begin = (part == 0) ? 0 : i_split;
+		int i_end = (part == 0) ? i_split : int(chain->size()) - 1;
+		if (i_begin == i_end) { continue; }
+
+		polyline->clear();
+		for (int j = i_begin; j <= i_end; j++) { polyline->push_back(nodes[(*chain)[j]]); }
+		std::vector<int> kept = DouglasPeucker(*polyline, fTolerance);
+		for (int j = 1; j < kept.size(); j++) { simplified.push_back((*chain)[i_begin + kept[j]]); }
+	}
+	*chain = std::move(simplified);
+}
+
+// Merge chains of collinear segments that are split at nodes with exactly two connections
+void MergeCollinearSegments(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	const float& fTolerance, std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut)
+{
+	std::vector<int> offsets, adjacentSegments;
+	BuildNodeAdjacency(int(nodes.size()), segments, &offsets, &adjacentSegments);
+
+	std::vector<std::vector<int>> chains;
+	ExtractSegmentChains(nodes, segments, offsets, adjacentSegments, &chains);
+
+	// A node is only dropped if it lies within the tolerance of the segment that finally replaces it. Testing each
+	// node against its neighbours alone lets the error add up along gentle arcs until a circle collapses.
+	std::vector<olc::vf2d> polyline;
+	for (int i = 0; i < chains.size(); i++)
+	{
+		SimplifyChain(nodes, fTolerance, &chains[i], &polyline);
+	}
+
+	AssembleSimplifiedGeometry(nodes, offsets, chains, nodesOut, segmentsOut);
+}
+
+// Simplify chains of segments with Douglas-Peucker, the result stays within "fTolerance" of the input
+void SimplifySegments(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	const float& fTolerance, std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut)
+{
+	std::vector<int> offsets, adjacentSegments;
+	BuildNodeAdjacency(int(nodes.size()), segments, &offsets, &adjacentSegments);
+
+	std::vector<std::vector<int>> chains;
+	ExtractSegmentChains(nodes, segments, offsets, adjacentSegments, &chains);
+
+	std::vector<olc::vf2d> polyline;
+	for (int i = 0; i < chains.size(); i++)
+	{
+		SimplifyChain(nodes, fTolerance, &chains[i], &polyline);
+	}
+
+	AssembleSimplifiedGeometry(nodes, offsets, chains, nodesOut, segmentsOut);
+}
+
+// Simplify the geometry so that the error is at most "fPixelTolerance" pixels at the zoom level "fScale"
+void SimplifySegmentsForZoom(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	const float& fScale, const float& fPixelTolerance,
+	std::vector<olc::vf2d>* nodesOut, std::vector<std::array<int, 2>>* segmentsOut)
+{
+	SimplifySegments(nodes, segments, fPixelTolerance / fScale, nodesOut, segmentsOut);
+}
+
+// Build "nLevels" levels of detail, each one with twice the tolerance of the previous one
+std::vector<GeometryLOD> BuildLevelsOfDetail(const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments,
+	const float& fBaseTolerance, const int& nLevels)
+{
+	std::vector<GeometryLOD> levels(std::max(nLevels, 1));
+
+	// The finest level only merges collinear segments, its error is at most fBaseTolerance
+	levels[0].fTolerance = fBaseTolerance;
+	MergeCollinearSegments(nodes, segments, fBaseTolerance, &levels[0].nodes, &levels[0].segments);
+
+	// Each coarser level is simplified from the previous one with fBaseTolerance * 2^(i - 1), so the accumulated
+	// error of level "i" stays below fBaseTolerance * 2^i
+	for (int i = 1; i < levels.size(); i++)
+	{
+		levels[i].fTolerance = 0.5f * fBaseTolerance * float(1 << i);
+		SimplifySegments(levels[i - 1].nodes, levels[i - 1].segments, levels[i].fTolerance, &levels[i].nodes, &levels[i].segments);
+		levels[i].fTolerance *= 2.0f;
+	}
+	return levels;
+}
+
+// Select the coarsest level of detail that stays within "fPixelTolerance" pixels at the zoom level "fScale"
+const GeometryLOD& SelectLevelOfDetail(const std::vector<GeometryLOD>& levels, const float& fScale, const float& fPixelTolerance)
+{
+	float fWorldTolerance = fPixelTolerance / fScale;
+	int i_level = 0;
+	for (int i = 1; i < levels.size(); i++)
+	{
+		if (levels[i].fTolerance <= fWorldTolerance) { i_level = i; }
+	}
+	return levels[i_level];
+}
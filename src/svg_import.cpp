@@ -0,0 +1,606 @@
+#include "olcPixelGameEngine.h"
+#include "svg_import.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+
+// Affine transform, a point is mapped to (a * x + c * y + e, b * x + d * y + f)
+struct SvgTransform
+{
+	float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f, e = 0.0f, f = 0.0f;
+};
+
+
+// Transform "rhs" first and "lhs" second
+static SvgTransform Multiply(const SvgTransform& lhs, const SvgTransform& rhs)
+{
+	SvgTransform m;
+	m.a = lhs.a * rhs.a + lhs.c * rhs.b;
+	m.b = lhs.b * rhs.a + lhs.d * rhs.b;
+	m.c = lhs.a * rhs.c + lhs.c * rhs.d;
+	m.d = lhs.b * rhs.c + lhs.d * rhs.d;
+	m.e = lhs.a * rhs.e + lhs.c * rhs.f + lhs.e;
+	m.f = lhs.b * rhs.e + lhs.d * rhs.f + lhs.f;
+	return m;
+}
+
+// Apply a transform to a point
+static olc::vf2d Apply(const SvgTransform& m, const olc::vf2d& vPoint)
+{
+	return { m.a * vPoint.x + m.c * vPoint.y + m.e, m.b * vPoint.x + m.d * vPoint.y + m.f };
+}
+
+// Largest length a unit vector can get under a transform, used to scale the flattening tolerance of arcs
+static float MaxScale(const SvgTransform& m)
+{
+	return std::max(std::sqrt(m.a * m.a + m.b * m.b), std::sqrt(m.c * m.c + m.d * m.d));
+}
+
+// Skip white space and commas
+static const char* SkipSeparators(const char* p)
+{
+	while (*p == ' ' || *p == ',' || *p == '\t' || *p == '\n' || *p == '\r') { p++; }
+	return p;
+}
+
+// Read a number, returns "false" if there is none
+static bool ReadNumber(const char** p, float* fValue)
+{
+	const char* pStart = SkipSeparators(*p);
+	char* pEnd = nullptr;
+	*fValue = std::strtof(pStart, &pEnd);
+	if (pEnd == pStart) { return false; }
+	*p = pEnd;
+	return true;
+}
+
+// Read an arc flag, which can be written without a separator before the next number
+static bool ReadFlag(const char** p, bool* bFlag)
+{
+	const char* pStart = SkipSeparators(*p);
+	if (*pStart != '0' && *pStart != '1') { return false; }
+	*bFlag = (*pStart == '1');
+	*p = pStart + 1;
+	return true;
+}
+
+// Parse a transform list such as "translate(10, 20) rotate(45)"
+static SvgTransform ParseTransform(const char* p)
+{
+	SvgTransform m;
+	while (*(p = SkipSeparators(p)))
+	{
+		const char* pName = p;
+		while (*p && *p != '(') { p++; }
+		if (!*p) { break; }
+		std::string sName(pName, p - pName);
+		sName.erase(sName.find_last_not_of(" \t\r\n") + 1);
+		p++;
+
+		float values[6] = {};
+		int nValues = 0;
+		while (nValues < 6 && ReadNumber(&p, &values[nValues])) { nValues++; }
+		while (*p && *p != ')') { p++; }
+		if (*p) { p++; }
+
+		SvgTransform t;
+		if (sName == "matrix" && nValues == 6)
+		{
+			t = { values[0], values[1], values[2], values[3], values[4], values[5] };
+		}
+		else if (sName == "translate" && nValues >= 1)
+		{
+			t.e = values[0];
+			t.f = nValues > 1 ? values[1] : 0.0f;
+		}
+		else if (sName == "scale" && nValues >= 1)
+		{
+			t.a = values[0];
+			t.d = nValues > 1 ? values[1] : values[0];
+		}
+		else if (sName == "rotate" && nValues >= 1)
+		{
+			float fAngle = values[0] * 3.14159265f / 180.0f;
+			t = { std::cos(fAngle), std::sin(fAngle), -std::sin(fAngle), std::cos(fAngle), 0.0f, 0.0f };
+			if (nValues == 3)
+			{
+				SvgTransform to, from;
+				to.e = values[1];
+				to.f = values[2];
+				from.e = -values[1];
+				from.f = -values[2];
+				t = Multiply(to, Multiply(t, from));
+			}
+		}
+		else if (sName == "skewX" && nValues >= 1)
+		{
+			t.c = std::tan(values[0] * 3.14159265f / 180.0f);
+		}
+		else if (sName == "skewY" && nValues >= 1)
+		{
+			t.b = std::tan(values[0] * 3.14159265f / 180.0f);
+		}
+		m = Multiply(m, t);
+	}
+	return m;
+}
+
+
+// Writes flattened outlines into a transaction and welds their vertices
+class SvgImporter
+{
+public:
+	SvgImporter(GeometryTransaction* transaction, const SvgImportOptions& options, SvgImportStats* stats)
+	{
+		this->transaction = transaction;
+		this->options = options;
+		this->stats = stats;
+		fInverseCellSize = 0.125f / std::max(options.fWeldDistance, 1e-9f);
+		transforms.push_back(SvgTransform());
+	}
+
+	// Handle one tag without the angle brackets
+	void ProcessTag(const char* pTag, size_t nLength)
+	{
+		if (nLength == 0 || pTag[0] == '?' || pTag[0] == '!') { return; }
+		if (pTag[0] == '/')
+		{
+			if (transforms.size() > 1) { transforms.pop_back(); }
+			return;
+		}
+		tag.assign(pTag, nLength);
+		bool bSelfClosing = tag.back() == '/';
+		if (bSelfClosing) { tag.pop_back(); }
+
+		// Element name without a namespace prefix
+		size_t nNameEnd = tag.find_first_of(" \t\r\n");
+		std::string sName = tag.substr(0, nNameEnd);
+		size_t nColon = sName.find(':');
+		if (nColon != std::string::npos) { sName = sName.substr(nColon + 1); }
+		ParseAttributes(nNameEnd == std::string::npos ? tag.size() : nNameEnd);
+
+		const std::string* sTransform = FindAttribute("transform");
+		transform = sTransform ? Multiply(transforms.back(), ParseTransform(sTransform->c_str())) : transforms.back();
+		fScale = MaxScale(transform);
+
+		if      (sName == "path")     { ImportPath(); }
+		else if (sName == "line")     { ImportLine(); }
+		else if (sName == "polyline") { ImportPoints(false); }
+		else if (sName == "polygon")  { ImportPoints(true); }
+		else if (sName == "rect")     { ImportRect(); }
+
+		// Children inherit the transform
+		if (!bSelfClosing) { transforms.push_back(transform); }
+	}
+
+private:
+	// Split the attributes of the current tag into names and values
+	void ParseAttributes(size_t nPosition)
+	{
+		attributes.clear();
+		while (true)
+		{
+			size_t nNameStart = tag.find_first_not_of(" \t\r\n", nPosition);
+			if (nNameStart == std::string::npos) { return; }
+			size_t nEquals = tag.find('=', nNameStart);
+			if (nEquals == std::string::npos) { return; }
+			size_t nQuote = tag.find_first_of("\"'", nEquals);
+			if (nQuote == std::string::npos) { return; }
+			size_t nValueEnd = tag.find(tag[nQuote], nQuote + 1);
+			if (nValueEnd == std::string::npos) { return; }
+			std::string sName = tag.substr(nNameStart, nEquals - nNameStart);
+			sName.erase(sName.find_last_not_of(" \t\r\n") + 1);
+			attributes.push_back({ sName, tag.substr(nQuote + 1, nValueEnd - nQuote - 1) });
+			nPosition = nValueEnd + 1;
+		}
+	}
+
+	// Value of an attribute of the current tag, "nullptr" if it is missing
+	const std::string* FindAttribute(const char* sName) const
+	{
+		for (int i = 0; i < attributes.size(); i++)
+		{
+			if (attributes[i].first == sName) { return &attributes[i].second; }
+		}
+		return nullptr;
+	}
+
+	// Numeric attribute of the current tag
+	float GetNumber(const char* sName) const
+	{
+		const std::string* sValue = FindAttribute(sName);
+		return sValue ? std::strtof(sValue->c_str(), nullptr) : 0.0f;
+	}
+
+	// Node of a vertex in world space, vertices within the weld distance share one node. The cells are eight
+	// weld distances wide, so the neighbouring cells only need to be searched near the cell borders.
+	NodeHandle Weld(const olc::vf2d& vPoint)
+	{
+		olc::vf2d vCell = vPoint * fInverseCellSize;
+		int64_t cx = int64_t(std::floor(vCell.x));
+		int64_t cy = int64_t(std::floor(vCell.y));
+		float fBorder = 0.125f;
+		int64_t x0 = (vCell.x - float(cx) < fBorder) ? cx - 1 : cx;
+		int64_t x1 = (float(cx + 1) - vCell.x < fBorder) ? cx + 1 : cx;
+		int64_t y0 = (vCell.y - float(cy) < fBorder) ? cy - 1 : cy;
+		int64_t y1 = (float(cy + 1) - vCell.y < fBorder) ? cy + 1 : cy;
+		float fWeldSquared = options.fWeldDistance * options.fWeldDistance;
+		for (int64_t y = y0; y <= y1; y++)
+		{
+			for (int64_t x = x0; x <= x1; x++)
+			{
+				auto it = weldCells.find((uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y)));
+				if (it == weldCells.end()) { continue; }
+				for (int32_t i = it->second; i != -1; i = weldVertices[i].nNext)
+				{
+					if ((weldVertices[i].vPosition - vPoint).mag2() <= fWeldSquared) { return weldVertices[i].hNode; }
+				}
+			}
+		}
+
+		// New vertex at the head of the list of its cell
+		NodeHandle hNode = transaction->AddNode(vPoint);
+		auto inserted = weldCells.emplace((uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy)), -1);
+		weldVertices.push_back({ vPoint, hNode, inserted.first->second });
+		inserted.first->second = int32_t(weldVertices.size()) - 1;
+		if (stats) { stats->nNodes += 1; }
+		return hNode;
+	}
+
+	// Start a new outline at a point in user space
+	void MoveTo(const olc::vf2d& vPoint)
+	{
+		vCurrent = vPoint;
+		vSubpathStart = vPoint;
+		hPrevious = Weld(ToWorld(vPoint));
+		hSubpathStart = hPrevious;
+	}
+
+	// Continue the outline to a point in world space
+	void AddVertex(const olc::vf2d& vWorldPoint)
+	{
+		NodeHandle hNode = Weld(vWorldPoint);
+		if (hPrevious.nSlot != -1 && hNode != hPrevious && transaction->AddSegment(hPrevious, hNode).nSlot != -1)
+		{
+			if (stats) { stats->nSegments += 1; }
+		}
+		hPrevious = hNode;
+	}
+
+	// Straight line to a point in user space
+	void LineTo(const olc::vf2d& vPoint)
+	{
+		AddVertex(ToWorld(vPoint));
+		vCurrent = vPoint;
+	}
+
+	// Close the current outline
+	void ClosePath()
+	{
+		if (hPrevious.nSlot != -1 && hSubpathStart.nSlot != -1) { AddVertex(ToWorld(vSubpathStart)); }
+		vCurrent = vSubpathStart;
+	}
+
+	// Flatten a cubic curve, the control points are transformed first because affine maps preserve curves
+	void CubicTo(const olc::vf2d& vControl1, const olc::vf2d& vControl2, const olc::vf2d& vPoint)
+	{
+		olc::vf2d p0 = ToWorld(vCurrent), p1 = ToWorld(vControl1), p2 = ToWorld(vControl2), p3 = ToWorld(vPoint);
+		float fDeviation = std::max((p0 - 2.0f * p1 + p2).mag(), (p1 - 2.0f * p2 + p3).mag());
+		int nSteps = std::min(std::max(int(std::ceil(std::sqrt(0.75f * fDeviation / options.fTolerance))), 1), 1024);
+		for (int i = 1; i <= nSteps; i++)
+		{
+			float t = float(i) / float(nSteps);
+			float s = 1.0f - t;
+			AddVertex(s * s * s * p0 + 3.0f * s * s * t * p1 + 3.0f * s * t * t * p2 + t * t * t * p3);
+		}
+		vCurrent = vPoint;
+	}
+
+	// Flatten a quadratic curve
+	void QuadraticTo(const olc::vf2d& vControl, const olc::vf2d& vPoint)
+	{
+		olc::vf2d p0 = ToWorld(vCurrent), p1 = ToWorld(vControl), p2 = ToWorld(vPoint);
+		float fDeviation = (p0 - 2.0f * p1 + p2).mag();
+		int nSteps = std::min(std::max(int(std::ceil(std::sqrt(0.25f * fDeviation / options.fTolerance))), 1), 1024);
+		for (int i = 1; i <= nSteps; i++)
+		{
+			float t = float(i) / float(nSteps);
+			float s = 1.0f - t;
+			AddVertex(s * s * p0 + 2.0f * s * t * p1 + t * t * p2);
+		}
+		vCurrent = vPoint;
+	}
+
+	// Flatten an elliptical arc given in the endpoint form of the SVG specification
+	void ArcTo(float rx, float ry, const float& fAxisRotation, const bool& bLargeArc, const bool& bSweep, const olc::vf2d& vPoint)
+	{
+		rx = std::abs(rx);
+		ry = std::abs(ry);
+		if (rx == 0.0f || ry == 0.0f || vPoint == vCurrent)
+		{
+			LineTo(vPoint);
+			return;
+		}
+
+		// Center form of the arc
+		float fPhi = fAxisRotation * 3.14159265f / 180.0f;
+		float fCos = std::cos(fPhi);
+		float fSin = std::sin(fPhi);
+		olc::vf2d vHalf = 0.5f * (vCurrent - vPoint);
+		olc::vf2d v1 = { fCos * vHalf.x + fSin * vHalf.y, -fSin * vHalf.x + fCos * vHalf.y };
+		float fLambda = (v1.x * v1.x) / (rx * rx) + (v1.y * v1.y) / (ry * ry);
+		if (fLambda > 1.0f)
+		{
+			rx *= std::sqrt(fLambda);
+			ry *= std::sqrt(fLambda);
+		}
+		float fNumerator = rx * rx * ry * ry - rx * rx * v1.y * v1.y - ry * ry * v1.x * v1.x;
+		float fDenominator = rx * rx * v1.y * v1.y + ry * ry * v1.x * v1.x;
+		float fFactor = std::sqrt(std::max(fNumerator / fDenominator, 0.0f)) * (bLargeArc == bSweep ? -1.0f : 1.0f);
+		olc::vf2d vCenter1 = { fFactor * rx * v1.y / ry, -fFactor * ry * v1.x / rx };
+		olc::vf2d vMid = 0.5f * (vCurrent + vPoint);
+		olc::vf2d vCenter = { fCos * vCenter1.x - fSin * vCenter1.y + vMid.x, fSin * vCenter1.x + fCos * vCenter1.y + vMid.y };
+		float fStart = std::atan2((v1.y - vCenter1.y) / ry, (v1.x - vCenter1.x) / rx);
+		float fEnd = std::atan2((-v1.y - vCenter1.y) / ry, (-v1.x - vCenter1.x) / rx);
+		float fSweep = fEnd - fStart;
+		if (bSweep && fSweep < 0.0f) { fSweep += 2.0f * 3.14159265f; }
+		if (!bSweep && fSweep > 0.0f) { fSweep -= 2.0f * 3.14159265f; }
+
+		// Enough steps to keep the chords within the tolerance of the transformed radius
+		float fRadius = std::max(rx, ry) * fScale;
+		float fStepAngle = 2.0f * std::acos(std::max(1.0f - options.fTolerance / std::max(fRadius, options.fTolerance), -1.0f));
+		int nSteps = std::min(std::max(int(std::ceil(std::abs(fSweep) / std::max(fStepAngle, 1e-3f))), 1), 1024);
+		for (int i = 1; i < nSteps; i++)
+		{
+			float fAngle = fStart + fSweep * float(i) / float(nSteps);
+			olc::vf2d vLocal = { rx * std::cos(fAngle), ry * std::sin(fAngle) };
+			AddVertex(ToWorld({ fCos * vLocal.x - fSin * vLocal.y + vCenter.x, fSin * vLocal.x + fCos * vLocal.y + vCenter.y }));
+		}
+		LineTo(vPoint);
+	}
+
+	// Path data, all commands with their relative forms and implicit repetitions
+	void ImportPath()
+	{
+		const std::string* sData = FindAttribute("d");
+		if (!sData) { return; }
+		if (stats) { stats->nElements += 1; }
+
+		const char* p = sData->c_str();
+		char cCommand = 0;
+		olc::vf2d vLastControl;
+		char cLastCommand = 0;
+		hPrevious = NodeHandle();
+		hSubpathStart = NodeHandle();
+		vCurrent = { 0.0f, 0.0f };
+		vSubpathStart = { 0.0f, 0.0f };
+		while (*(p = SkipSeparators(p)))
+		{
+			if (std::isalpha(static_cast<unsigned char>(*p)))
+			{
+				cCommand = *p++;
+			}
+			else if (cCommand == 0)
+			{
+				return;
+			}
+			bool bRelative = std::islower(static_cast<unsigned char>(cCommand)) != 0;
+			olc::vf2d vOrigin = bRelative ? vCurrent : olc::vf2d{ 0.0f, 0.0f };
+			char cUpper = char(std::toupper(static_cast<unsigned char>(cCommand)));
+			float v[7];
+			bool bOk = true;
+			auto read = [&](int nCount)
+			{
+				for (int i = 0; i < nCount && bOk; i++) { bOk = ReadNumber(&p, &v[i]); }
+				return bOk;
+			};
+
+			if (cUpper == 'Z')
+			{
+				ClosePath();
+			}
+			else if (cUpper == 'M' && read(2))
+			{
+				MoveTo(vOrigin + olc::vf2d{ v[0], v[1] });
+				cCommand = bRelative ? 'l' : 'L'; // Further pairs are lines
+			}
+			else if (cUpper == 'L' && read(2)) { LineTo(vOrigin + olc::vf2d{ v[0], v[1] }); }
+			else if (cUpper == 'H' && read(1)) { LineTo({ (bRelative ? vCurrent.x : 0.0f) + v[0], vCurrent.y }); }
+			else if (cUpper == 'V' && read(1)) { LineTo({ vCurrent.x, (bRelative ? vCurrent.y : 0.0f) + v[0] }); }
+			else if (cUpper == 'C' && read(6))
+			{
+				vLastControl = vOrigin + olc::vf2d{ v[2], v[3] };
+				CubicTo(vOrigin + olc::vf2d{ v[0], v[1] }, vLastControl, vOrigin + olc::vf2d{ v[4], v[5] });
+			}
+			else if (cUpper == 'S' && read(4))
+			{
+				olc::vf2d vControl1 = (cLastCommand == 'C' || cLastCommand == 'S') ? 2.0f * vCurrent - vLastControl : vCurrent;
+				vLastControl = vOrigin + olc::vf2d{ v[0], v[1] };
+				CubicTo(vControl1, vLastControl, vOrigin + olc::vf2d{ v[2], v[3] });
+			}
+			else if (cUpper == 'Q' && read(4))
+			{
+				vLastControl = vOrigin + olc::vf2d{ v[0], v[1] };
+				QuadraticTo(vLastControl, vOrigin + olc::vf2d{ v[2], v[3] });
+			}
+			else if (cUpper == 'T' && read(2))
+			{
+				vLastControl = (cLastCommand == 'Q' || cLastCommand == 'T') ? 2.0f * vCurrent - vLastControl : vCurrent;
+				QuadraticTo(vLastControl, vOrigin + olc::vf2d{ v[0], v[1] });
+			}
+			else if (cUpper == 'A')
+			{
+				bool bLargeArc = false, bSweep = false;
+				bOk = read(3) && ReadFlag(&p, &bLargeArc) && ReadFlag(&p, &bSweep) && ReadNumber(&p, &v[3]) && ReadNumber(&p, &v[4]);
+				if (bOk) { ArcTo(v[0], v[1], v[2], bLargeArc, bSweep, vOrigin + olc::vf2d{ v[3], v[4] }); }
+			}
+			else
+			{
+				bOk = false;
+			}
+
+			// Malformed data ends the path, the part before it is kept
+			if (!bOk) { return; }
+			cLastCommand = cUpper;
+		}
+	}
+
+	// Single line
+	void ImportLine()
+	{
+		if (stats) { stats->nElements += 1; }
+		MoveTo({ GetNumber("x1"), GetNumber("y1") });
+		LineTo({ GetNumber("x2"), GetNumber("y2") });
+	}
+
+	// Open or closed list of points
+	void ImportPoints(const bool& bClosed)
+	{
+		const std::string* sPoints = FindAttribute("points");
+		if (!sPoints) { return; }
+		if (stats) { stats->nElements += 1; }
+		const char* p = sPoints->c_str();
+		olc::vf2d vPoint;
+		bool bFirst = true;
+		while (ReadNumber(&p, &vPoint.x) && ReadNumber(&p, &vPoint.y))
+		{
+			if (bFirst) { MoveTo(vPoint); }
+			else        { LineTo(vPoint); }
+			bFirst = false;
+		}
+		if (bClosed && !bFirst) { ClosePath(); }
+	}
+
+	// Rectangle, rounded corners are imported as sharp corners
+	void ImportRect()
+	{
+		float x = GetNumber("x");
+		float y = GetNumber("y");
+		float w = GetNumber("width");
+		float h = GetNumber("height");
+		if (w <= 0.0f || h <= 0.0f) { return; }
+		if (stats) { stats->nElements += 1; }
+		MoveTo({ x, y });
+		LineTo({ x + w, y });
+		LineTo({ x + w, y + h });
+		LineTo({ x, y + h });
+		ClosePath();
+	}
+
+	// User space to world space, SVG has its y-axis pointing down
+	olc::vf2d ToWorld(const olc::vf2d& vPoint) const
+	{
+		olc::vf2d vTransformed = Apply(transform, vPoint);
+		return { vTransformed.x, -vTransformed.y };
+	}
+
+private:
+	GeometryTransaction* transaction;
+	SvgImportOptions options;
+	SvgImportStats* stats;
+
+	// Current tag and its attributes
+	std::string tag;
+	std::vector<std::pair<std::string, std::string>> attributes;
+
+	// Transforms of the open elements and of the current element
+	std::vector<SvgTransform> transforms;
+	SvgTransform transform;
+	float fScale = 1.0f;
+
+	// Current outline
+	olc::vf2d vCurrent, vSubpathStart;
+	NodeHandle hPrevious, hSubpathStart;
+
+	// Welded vertices, each cell holds the head of a list of its vertices
+	struct WeldVertex
+	{
+		olc::vf2d vPosition;
+		NodeHandle hNode;
+		int32_t nNext;
+	};
+	float fInverseCellSize;
+	std::unordered_map<uint64_t, int32_t> weldCells;
+	std::vector<WeldVertex> weldVertices;
+};
+
+
+// Import the outlines of an SVG file
+bool ImportSvg(const std::string& sPath, GeometryTransaction* transaction, const SvgImportOptions& options, SvgImportStats* stats)
+{
+	FILE* file = std::fopen(sPath.c_str(), "rb");
+	if (!file) { return false; }
+	if (stats) { *stats = SvgImportStats(); }
+
+	SvgImporter importer(transaction, options, stats);
+	std::string pending;
+	std::vector<char> chunk(std::max(options.nChunkSize, size_t(1)));
+
+	// Scan state of an incomplete tag, so a tag that spans many chunks is scanned only once
+	size_t nScan = 0;
+	char cQuote = 0;
+	while (true)
+	{
+		size_t nRead = std::fread(chunk.data(), 1, chunk.size(), file);
+		if (nRead == 0) { break; }
+		pending.append(chunk.data(), nRead);
+
+		// Handle every complete tag, the incomplete one at the end waits for the next chunk
+		size_t nPosition = 0;
+		while (true)
+		{
+			size_t nOpen = pending.find('<', nPosition);
+			if (nOpen == std::string::npos)
+			{
+				nPosition = pending.size();
+				break;
+			}
+			size_t nClose = std::string::npos;
+			bool bComment = pending.compare(nOpen, 4, "<!--") == 0;
+			bool bData = pending.compare(nOpen, 9, "<![CDATA[") == 0;
+			if (!bComment && !bData && pending.size() - nOpen < 9 && pending.compare(nOpen, 2, "<!") == 0)
+			{
+				// Too short to tell a comment from other markup yet
+				nPosition = nOpen;
+				break;
+			}
+			if (bComment || bData)
+			{
+				size_t nEnd = pending.find(bComment ? "-->" : "]]>", std::max(nOpen + (bComment ? 4 : 9), nScan));
+				if (nEnd != std::string::npos) { nClose = nEnd + 2; }
+				else { nScan = std::max(pending.size(), size_t(2)) - 2; }
+			}
+			else
+			{
+				// Quoted attribute values may contain '>'
+				for (size_t i = std::max(nOpen + 1, nScan); i < pending.size(); i++)
+				{
+					char c = pending[i];
+					if (cQuote) { if (c == cQuote) { cQuote = 0; } }
+					else if (c == '"' || c == '\'') { cQuote = c; }
+					else if (c == '>') { nClose = i; break; }
+				}
+				if (nClose == std::string::npos) { nScan = pending.size(); }
+			}
+			if (nClose == std::string::npos)
+			{
+				nPosition = nOpen;
+				break;
+			}
+			if (!bComment && !bData) { importer.ProcessTag(pending.data() + nOpen + 1, nClose - nOpen - 1); }
+			nPosition = nClose + 1;
+			nScan = 0;
+			cQuote = 0;
+		}
+
+		// Keep only the incomplete tag, the scan position moves with it
+		pending.erase(0, nPosition);
+		nScan = nScan > nPosition ? nScan - nPosition : 0;
+	}
+	std::fclose(file);
+	return true;
+}
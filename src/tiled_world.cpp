@@ -0,0 +1,619 @@
+#include "olcPixelGameEngine.h"
+#include "tiled_world.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
+
+
+static const char sWorldMagic[8] = { 'S', 'C', '2', 'D', 'W', 'L', 'D', '\0' };
+
+
+TiledWorld::~TiledWorld()
+{
+	Close();
+}
+
+// Chunk coordinate of a position
+int32_t TiledWorld::ChunkCoordinate(const float& fValue) const
+{
+	return int32_t(std::floor(fValue * fInverseChunkSize));
+}
+
+// Table key of a chunk
+uint64_t TiledWorld::ChunkKey(const int32_t& nX, const int32_t& nY)
+{
+	return (uint64_t(uint32_t(nX)) << 32) | uint64_t(uint32_t(nY));
+}
+
+// Read the chunk table and start the loader thread
+bool TiledWorld::Open(const std::string& sPath)
+{
+	Close();
+	std::ifstream file(sPath, std::ios::binary);
+	if (!file) { return false; }
+	file.seekg(0, std::ios::end);
+	uint64_t nSize = uint64_t(file.tellg());
+	file.seekg(0, std::ios::beg);
+
+	// Check the header and that every chunk lies inside the file
+	WorldHeader header;
+	if (nSize < sizeof(WorldHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(WorldHeader))) { return false; }
+	if (std::memcmp(header.sMagic, sWorldMagic, sizeof(sWorldMagic)) != 0 || header.nVersion != nWorldVersion) { return false; }
+	if (!(header.fChunkSize > 0.0f) || header.nTableOffset > nSize || header.nChunks > (nSize - header.nTableOffset) / sizeof(WorldChunkEntry)) { return false; }
+	std::vector<WorldChunkEntry> table(header.nChunks);
+	file.seekg(std::streamoff(header.nTableOffset));
+	if (!table.empty() && !file.read(reinterpret_cast<char*>(table.data()), std::streamsize(table.size() * sizeof(WorldChunkEntry)))) { return false; }
+	for (int i = 0; i < table.size(); i++)
+	{
+		uint64_t nBytes = 8 + uint64_t(table[i].nNodes) * 12 + uint64_t(table[i].nSegments) * 12;
+		if (table[i].nOffset > nSize || nBytes > nSize - table[i].nOffset) { return false; }
+	}
+
+	this->sPath = sPath;
+	fChunkSize = header.fChunkSize;
+	fInverseChunkSize = 1.0f / fChunkSize;
+	entries = std::move(table);
+	for (int i = 0; i < entries.size(); i++)
+	{
+		entryByKey[ChunkKey(entries[i].nX, entries[i].nY)] = i;
+	}
+	bStop = false;
+	loader = std::thread(&TiledWorld::LoaderThread, this);
+	return true;
+}
+
+// Stop the loader thread and drop all chunks
+void TiledWorld::Close()
+{
+	if (loader.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bStop = true;
+		}
+		wakeLoader.notify_one();
+		loader.join();
+	}
+	queue.clear();
+	loaded.clear();
+	nLoading = -1;
+	resident.clear();
+	recent.clear();
+	requested.clear();
+	nLoadedBytes = 0;
+	entries.clear();
+	entryByKey.clear();
+	sPath.clear();
+}
+
+bool TiledWorld::IsOpen() const
+{
+	return !sPath.empty();
+}
+
+float TiledWorld::GetChunkSize() const
+{
+	return fChunkSize;
+}
+
+// Maximum size of the loaded chunks
+void TiledWorld::SetMemoryBudget(const size_t& nBytes)
+{
+	nMemoryBudget = nBytes;
+}
+
+// Bytes a loaded chunk takes
+size_t TiledWorld::ChunkBytes(const WorldChunk& chunk)
+{
+	return sizeof(WorldChunk) + chunk.nodes.size() * (sizeof(olc::vf2d) + sizeof(uint32_t)) + chunk.segments.size() * (sizeof(std::array<int, 2>) + sizeof(uint32_t));
+}
+
+// Request the chunks that overlap a grown box
+void TiledWorld::RequestRegion(const olc::vf2d& vMin, const olc::vf2d& vMax, const float& fMargin)
+{
+	if (!IsOpen()) { return; }
+	olc::vf2d vCenter = 0.5f * (vMin + vMax);
+	int32_t x0 = ChunkCoordinate(vMin.x - fMargin);
+	int32_t y0 = ChunkCoordinate(vMin.y - fMargin);
+	int32_t x1 = ChunkCoordinate(vMax.x + fMargin);
+	int32_t y1 = ChunkCoordinate(vMax.y + fMargin);
+
+	// Very large regions visit the chunk table instead of every chunk inside the region
+	bool bScanTable = (double(x1) - double(x0) + 1.0) * (double(y1) - double(y0) + 1.0) > double(entries.size());
+	auto request = [&](const int32_t& nEntry)
+	{
+		auto it = resident.find(nEntry);
+		if (it != resident.end())
+		{
+			recent.splice(recent.begin(), recent, it->second.itRecent);
+			it->second.nLastFrame = nFrame;
+			return;
+		}
+		olc::vf2d vChunkCenter = (olc::vf2d{ float(entries[nEntry].nX), float(entries[nEntry].nY) } + olc::vf2d{ 0.5f, 0.5f }) * fChunkSize;
+		requested.push_back({ (vChunkCenter - vCenter).mag2(), nEntry });
+	};
+	if (bScanTable)
+	{
+		for (int32_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].nX >= x0 && entries[i].nX <= x1 && entries[i].nY >= y0 && entries[i].nY <= y1) { request(i); }
+		}
+		return;
+	}
+	for (int32_t y = y0; y <= y1; y++)
+	{
+		for (int32_t x = x0; x <= x1; x++)
+		{
+			auto it = entryByKey.find(ChunkKey(x, y));
+			if (it != entryByKey.end()) { request(it->second); }
+		}
+	}
+}
+
+// Drop a loaded chunk
+void TiledWorld::Evict(const int32_t& nEntry)
+{
+	auto it = resident.find(nEntry);
+	if (it == resident.end()) { return; }
+	nLoadedBytes -= ChunkBytes(*it->second.chunk);
+	recent.erase(it->second.itRecent);
+	resident.erase(it);
+}
+
+// Take the loaded chunks, drop chunks above the budget and pass the requests to the loader thread
+void TiledWorld::Update()
+{
+	if (!IsOpen()) { return; }
+
+	// The closest request of every chunk decides its order, the loader thread takes chunks from the back
+	std::sort(requested.begin(), requested.end(), [](const std::pair<float, int32_t>& a, const std::pair<float, int32_t>& b)
+	{
+		return a.first > b.first || (a.first == b.first && a.second > b.second);
+	});
+	std::vector<std::unique_ptr<WorldChunk>> newChunks;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		newChunks.swap(loaded);
+		std::unordered_set<int32_t> skipped = { nLoading };
+		for (int i = 0; i < newChunks.size(); i++)
+		{
+			skipped.insert(newChunks[i]->nEntry);
+		}
+		// A chunk requested by several regions is queued once, at its closest position
+		queue.clear();
+		for (int i = int(requested.size()) - 1; i >= 0; i--)
+		{
+			if (skipped.insert(requested[i].second).second) { queue.push_back(requested[i].second); }
+		}
+		std::reverse(queue.begin(), queue.end());
+	}
+	if (!requested.empty()) { wakeLoader.notify_one(); }
+	requested.clear();
+
+	// Chunks that finish loading count as requested in this frame
+	for (int i = 0; i < newChunks.size(); i++)
+	{
+		int32_t nEntry = newChunks[i]->nEntry;
+		if (resident.count(nEntry) != 0) { continue; }
+		recent.push_front(nEntry);
+		nLoadedBytes += ChunkBytes(*newChunks[i]);
+		ResidentChunk& chunk = resident[nEntry];
+		chunk.chunk = std::move(newChunks[i]);
+		chunk.itRecent = recent.begin();
+		chunk.nLastFrame = nFrame;
+	}
+
+	// Drop the least recently requested chunks, but never the ones in use
+	while (nLoadedBytes > nMemoryBudget && !recent.empty() && resident[recent.back()].nLastFrame < nFrame)
+	{
+		Evict(recent.back());
+	}
+	nFrame += 1;
+}
+
+// Read chunks until the world is closed
+void TiledWorld::LoaderThread()
+{
+	std::ifstream file(sPath, std::ios::binary);
+	while (true)
+	{
+		int32_t nEntry;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			nLoading = -1;
+			wakeLoader.wait(lock, [&]() { return bStop || !queue.empty(); });
+			if (bStop) { return; }
+			nEntry = queue.back();
+			queue.pop_back();
+			nLoading = nEntry;
+		}
+
+		// The chunk table was checked against the file size, so only a file that changed can fail here
+		const WorldChunkEntry& entry = entries[nEntry];
+		std::unique_ptr<WorldChunk> chunk(new WorldChunk());
+		chunk->nEntry = nEntry;
+		std::vector<uint32_t> data(2 + 3 * (size_t(entry.nNodes) + size_t(entry.nSegments)));
+		file.clear();
+		file.seekg(std::streamoff(entry.nOffset));
+		if (file.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size() * sizeof(uint32_t))) && data[0] == entry.nNodes && data[1] == entry.nSegments)
+		{
+			chunk->nodeIds.resize(entry.nNodes);
+			chunk->nodes.resize(entry.nNodes);
+			for (uint32_t i = 0; i < entry.nNodes; i++)
+			{
+				const uint32_t* pNode = &data[2 + 3 * size_t(i)];
+				chunk->nodeIds[i] = pNode[0];
+				std::memcpy(&chunk->nodes[i].x, &pNode[1], sizeof(float));
+				std::memcpy(&chunk->nodes[i].y, &pNode[2], sizeof(float));
+			}
+			chunk->segmentIds.reserve(entry.nSegments);
+			chunk->segments.reserve(entry.nSegments);
+			for (uint32_t i = 0; i < entry.nSegments; i++)
+			{
+				const uint32_t* pSegment = &data[2 + 3 * (size_t(entry.nNodes) + i)];
+				if (pSegment[1] >= entry.nNodes || pSegment[2] >= entry.nNodes) { continue; }
+				chunk->segmentIds.push_back(pSegment[0]);
+				chunk->segments.push_back({ int(pSegment[1]), int(pSegment[2]) });
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		loaded.push_back(std::move(chunk));
+	}
+}
+
+// Check whether all chunks that overlap a box are loaded
+bool TiledWorld::IsRegionLoaded(const olc::vf2d& vMin, const olc::vf2d& vMax) const
+{
+	for (int32_t y = ChunkCoordinate(vMin.y); y <= ChunkCoordinate(vMax.y); y++)
+	{
+		for (int32_t x = ChunkCoordinate(vMin.x); x <= ChunkCoordinate(vMax.x); x++)
+		{
+			auto it = entryByKey.find(ChunkKey(x, y));
+			if (it != entryByKey.end() && resident.count(it->second) == 0) { return false; }
+		}
+	}
+	return true;
+}
+
+// Loaded chunks that overlap a box
+void TiledWorld::FindLoadedChunks(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<const WorldChunk*>* chunks) const
+{
+	chunks->clear();
+	int32_t x0 = ChunkCoordinate(vMin.x);
+	int32_t y0 = ChunkCoordinate(vMin.y);
+	int32_t x1 = ChunkCoordinate(vMax.x);
+	int32_t y1 = ChunkCoordinate(vMax.y);
+	for (const auto& it : resident)
+	{
+		const WorldChunkEntry& entry = entries[it.first];
+		if (entry.nX >= x0 && entry.nX <= x1 && entry.nY >= y0 && entry.nY <= y1) { chunks->push_back(it.second.chunk.get()); }
+	}
+	// Same order in every frame
+	std::sort(chunks->begin(), chunks->end(), [](const WorldChunk* a, const WorldChunk* b) { return a->nEntry < b->nEntry; });
+}
+
+// Merge the loaded geometry that overlaps a box
+void TiledWorld::GatherRegion(const olc::vf2d& vMin, const olc::vf2d& vMax, std::vector<olc::vf2d>* nodes, std::vector<std::array<int, 2>>* segments) const
+{
+	nodes->clear();
+	segments->clear();
+	std::vector<const WorldChunk*> chunks;
+	FindLoadedChunks(vMin, vMax, &chunks);
+	std::unordered_map<uint32_t, int> nodeById;
+	std::unordered_set<uint32_t> segmentIds;
+	auto gatherNode = [&](const WorldChunk* chunk, const int& i_node)
+	{
+		auto it = nodeById.emplace(chunk->nodeIds[i_node], int(nodes->size()));
+		if (it.second) { nodes->push_back(chunk->nodes[i_node]); }
+		return it.first->second;
+	};
+	for (const WorldChunk* chunk : chunks)
+	{
+		for (int i = 0; i < chunk->segments.size(); i++)
+		{
+			const olc::vf2d& vStart = chunk->nodes[chunk->segments[i][0]];
+			const olc::vf2d& vEnd = chunk->nodes[chunk->segments[i][1]];
+			if (std::max(vStart.x, vEnd.x) < vMin.x || std::max(vStart.y, vEnd.y) < vMin.y || std::min(vStart.x, vEnd.x) > vMax.x || std::min(vStart.y, vEnd.y) > vMax.y) { continue; }
+			if (!segmentIds.insert(chunk->segmentIds[i]).second) { continue; }
+			segments->push_back({ gatherNode(chunk, chunk->segments[i][0]), gatherNode(chunk, chunk->segments[i][1]) });
+		}
+	}
+}
+
+// Find the closest loaded node within "fMaxDistance"
+int64_t TiledWorld::FindNearestNode(const olc::vf2d& vPoint, const float& fMaxDistance, olc::vf2d* vPosition) const
+{
+	// Nodes near a chunk border can be stored in the neighbouring chunks too
+	std::vector<const WorldChunk*> chunks;
+	FindLoadedChunks(vPoint - olc::vf2d{ fMaxDistance, fMaxDistance }, vPoint + olc::vf2d{ fMaxDistance, fMaxDistance }, &chunks);
+	int64_t nBest = -1;
+	float fBest = fMaxDistance * fMaxDistance;
+	for (const WorldChunk* chunk : chunks)
+	{
+		for (int i = 0; i < chunk->nodes.size(); i++)
+		{
+			float fDistance = (chunk->nodes[i] - vPoint).mag2();
+			if (fDistance <= fBest)
+			{
+				fBest = fDistance;
+				nBest = chunk->nodeIds[i];
+				if (vPosition) { *vPosition = chunk->nodes[i]; }
+			}
+		}
+	}
+	return nBest;
+}
+
+int TiledWorld::GetLoadedChunkCount() const
+{
+	return int(resident.size());
+}
+
+size_t TiledWorld::GetLoadedBytes() const
+{
+	return nLoadedBytes;
+}
+
+int TiledWorld::GetPendingChunkCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return int(queue.size()) + (nLoading != -1 ? 1 : 0);
+}
+
+
+// Chunks a segment passes through, from the chunk of its start to the chunk of its end
+template <typename Visit>
+static void TraverseChunks(const olc::vf2d& vStart, const olc::vf2d& vEnd, const float& fChunkSize, Visit visit)
+{
+	float fInverseChunkSize = 1.0f / fChunkSize;
+	int32_t x = int32_t(std::floor(vStart.x * fInverseChunkSize));
+	int32_t y = int32_t(std::floor(vStart.y * fInverseChunkSize));
+	int32_t xEnd = int32_t(std::floor(vEnd.x * fInverseChunkSize));
+	int32_t yEnd = int32_t(std::floor(vEnd.y * fInverseChunkSize));
+	int32_t nStepX = xEnd > x ? 1 : -1;
+	int32_t nStepY = yEnd > y ? 1 : -1;
+
+	// Parameter along the segment at which it crosses the next chunk border on each axis, computed from the
+	// border itself in double precision so that segments passing close to a chunk corner take the right side
+	double fDirectionX = double(vEnd.x) - double(vStart.x);
+	double fDirectionY = double(vEnd.y) - double(vStart.y);
+	auto crossing = [&](const int32_t& nChunk, const int32_t& nStep, const float& fStart, const double& fDirection)
+	{
+		return ((double(nChunk) + (nStep > 0 ? 1.0 : 0.0)) * double(fChunkSize) - double(fStart)) / fDirection;
+	};
+
+	// Step into the neighbour whose border is crossed first. An axis that reached the end chunk does not step
+	// again, so rounding cannot lead past the end chunk.
+	visit(x, y);
+	while (x != xEnd || y != yEnd)
+	{
+		if (y == yEnd || (x != xEnd && crossing(x, nStepX, vStart.x, fDirectionX) < crossing(y, nStepY, vStart.y, fDirectionY)))
+		{
+			x += nStepX;
+		}
+		else
+		{
+			y += nStepY;
+		}
+		visit(x, y);
+	}
+}
+
+// Node or segment that is stored in a chunk, records are sorted by chunk and nodes come before segments
+struct ChunkRecord
+{
+	int32_t nX;
+	int32_t nY;
+	uint32_t nKind; // 0 node, 1 segment
+	uint32_t nId;
+
+	bool operator < (const ChunkRecord& other) const
+	{
+		if (nX != other.nX) { return nX < other.nX; }
+		if (nY != other.nY) { return nY < other.nY; }
+		if (nKind != other.nKind) { return nKind < other.nKind; }
+		return nId < other.nId;
+	}
+};
+
+// Records that are sorted in memory at a time, larger worlds are sorted in runs in a temporary file and merged
+const size_t nChunkRecordRun = size_t(1) << 20;
+const size_t nChunkRecordBuffer = size_t(1) << 12;
+
+// Split geometry into square chunks and write it as a tiled world
+bool SaveTiledWorld(const std::string& sPath, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const float& fChunkSize)
+{
+	if (!(fChunkSize > 0.0f)) { return false; }
+	float fInverseChunkSize = 1.0f / fChunkSize;
+	auto coordinate = [&](const float& fValue) { return int32_t(std::floor(fValue * fInverseChunkSize)); };
+
+	// Sort the records of one run and write it to the temporary file
+	std::string sRunPath = sPath + ".tmp";
+	std::fstream runFile;
+	std::vector<std::pair<uint64_t, uint64_t>> runs; // First record and record count
+	std::vector<ChunkRecord> run;
+	run.reserve(std::min(nChunkRecordRun, nodes.size() + 2 * segments.size()));
+	bool bRunsValid = true;
+	auto flushRun = [&]()
+	{
+		std::sort(run.begin(), run.end());
+		if (!runFile.is_open())
+		{
+			runFile.open(sRunPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!runFile) { bRunsValid = false; }
+		}
+		uint64_t nFirst = runs.empty() ? 0 : runs.back().first + runs.back().second;
+		runFile.write(reinterpret_cast<const char*>(run.data()), std::streamsize(run.size() * sizeof(ChunkRecord)));
+		bRunsValid = bRunsValid && bool(runFile);
+		runs.push_back({ nFirst, run.size() });
+		run.clear();
+	};
+	auto addRecord = [&](const ChunkRecord& record)
+	{
+		run.push_back(record);
+		if (run.size() == nChunkRecordRun) { flushRun(); }
+	};
+
+	// Every node is stored in its own chunk, even without segments
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		addRecord({ coordinate(nodes[i].x), coordinate(nodes[i].y), 0, uint32_t(i) });
+	}
+	// Every segment is stored in each chunk it passes through, together with its two nodes
+	for (int i = 0; i < segments.size(); i++)
+	{
+		TraverseChunks(nodes[segments[i][0]], nodes[segments[i][1]], fChunkSize, [&](const int32_t& x, const int32_t& y)
+		{
+			addRecord({ x, y, 1, uint32_t(i) });
+		});
+	}
+
+	// Records in sorted order, from memory if they fit in one run and otherwise merged from the sorted runs
+	size_t nNext = 0;
+	struct RunCursor
+	{
+		uint64_t nNext;
+		uint64_t nEnd;
+		std::vector<ChunkRecord> buffer;
+		size_t nBuffered = 0;
+	};
+	std::vector<RunCursor> cursors;
+	auto compareCursors = [&](const int& a, const int& b) { return cursors[b].buffer[cursors[b].nBuffered] < cursors[a].buffer[cursors[a].nBuffered]; };
+	std::vector<int> heap;
+	auto refill = [&](RunCursor& cursor)
+	{
+		size_t nCount = size_t(std::min(cursor.nEnd - cursor.nNext, uint64_t(nChunkRecordBuffer)));
+		cursor.buffer.resize(nCount);
+		cursor.nBuffered = 0;
+		runFile.seekg(std::streamoff(cursor.nNext * sizeof(ChunkRecord)));
+		runFile.read(reinterpret_cast<char*>(cursor.buffer.data()), std::streamsize(nCount * sizeof(ChunkRecord)));
+		bRunsValid = bRunsValid && bool(runFile);
+		cursor.nNext += nCount;
+		return nCount > 0 && bRunsValid;
+	};
+	if (!runs.empty())
+	{
+		if (!run.empty()) { flushRun(); }
+		std::vector<ChunkRecord>().swap(run);
+		runFile.flush();
+		cursors.resize(runs.size());
+		for (int i = 0; i < runs.size(); i++)
+		{
+			cursors[i].nNext = runs[i].first;
+			cursors[i].nEnd = runs[i].first + runs[i].second;
+			if (refill(cursors[i])) { heap.push_back(i); }
+		}
+		std::make_heap(heap.begin(), heap.end(), compareCursors);
+	}
+	else
+	{
+		std::sort(run.begin(), run.end());
+	}
+	auto nextRecord = [&](ChunkRecord* record)
+	{
+		if (runs.empty())
+		{
+			if (nNext == run.size()) { return false; }
+			*record = run[nNext++];
+			return true;
+		}
+		if (heap.empty()) { return false; }
+		std::pop_heap(heap.begin(), heap.end(), compareCursors);
+		RunCursor& cursor = cursors[heap.back()];
+		*record = cursor.buffer[cursor.nBuffered++];
+		if (cursor.nBuffered < cursor.buffer.size() || refill(cursor))
+		{
+			std::push_heap(heap.begin(), heap.end(), compareCursors);
+		}
+		else
+		{
+			heap.pop_back();
+		}
+		return true;
+	};
+
+	std::ofstream file(sPath, std::ios::binary | std::ios::trunc);
+	if (!file || !bRunsValid)
+	{
+		runFile.close();
+		std::remove(sRunPath.c_str());
+		return false;
+	}
+	WorldHeader header = {};
+	std::memcpy(header.sMagic, sWorldMagic, sizeof(sWorldMagic));
+	header.nVersion = nWorldVersion;
+	header.fChunkSize = fChunkSize;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(WorldHeader));
+	std::vector<WorldChunkEntry> table;
+	uint64_t nOffset = sizeof(WorldHeader);
+
+	// Only the chunk that is being written is built, with the local index of every node it uses
+	std::vector<uint32_t> data;
+	std::unordered_map<uint32_t, uint32_t> localNodes;
+	uint32_t nNodes = 0;
+	std::vector<uint32_t> segmentData;
+	auto addNode = [&](const int& i_node)
+	{
+		auto it = localNodes.emplace(uint32_t(i_node), nNodes);
+		if (it.second)
+		{
+			uint32_t x, y;
+			std::memcpy(&x, &nodes[i_node].x, sizeof(float));
+			std::memcpy(&y, &nodes[i_node].y, sizeof(float));
+			data.insert(data.end(), { uint32_t(i_node), x, y });
+			nNodes += 1;
+		}
+		return it.first->second;
+	};
+	auto writeChunk = [&](const int32_t& x, const int32_t& y)
+	{
+		uint32_t nSegments = uint32_t(segmentData.size() / 3);
+		uint32_t counts[2] = { nNodes, nSegments };
+		file.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+		file.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size() * sizeof(uint32_t)));
+		file.write(reinterpret_cast<const char*>(segmentData.data()), std::streamsize(segmentData.size() * sizeof(uint32_t)));
+		table.push_back({ x, y, nOffset, nNodes, nSegments });
+		nOffset += sizeof(counts) + (data.size() + segmentData.size()) * sizeof(uint32_t);
+		data.clear();
+		localNodes.clear();
+		nNodes = 0;
+		segmentData.clear();
+	};
+
+	ChunkRecord record;
+	bool bChunk = false;
+	int32_t nChunkX = 0, nChunkY = 0;
+	while (nextRecord(&record))
+	{
+		if (bChunk && (record.nX != nChunkX || record.nY != nChunkY)) { writeChunk(nChunkX, nChunkY); }
+		bChunk = true;
+		nChunkX = record.nX;
+		nChunkY = record.nY;
+		if (record.nKind == 0)
+		{
+			addNode(int(record.nId));
+		}
+		else
+		{
+			uint32_t nStart = addNode(segments[record.nId][0]);
+			uint32_t nEnd = addNode(segments[record.nId][1]);
+			segmentData.insert(segmentData.end(), { record.nId, nStart, nEnd });
+		}
+	}
+	if (bChunk) { writeChunk(nChunkX, nChunkY); }
+	if (runFile.is_open())
+	{
+		runFile.close();
+		std::remove(sRunPath.c_str());
+	}
+
+	header.nChunks = table.size();
+	header.nTableOffset = nOffset;
+	file.write(reinterpret_cast<const char*>(table.data()), std::streamsize(table.size() * sizeof(WorldChunkEntry)));
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(WorldHeader));
+	return bool(file) && bRunsValid;
+}
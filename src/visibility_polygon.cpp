@@ -1,8 +1,44 @@
 #include "olcPixelGameEngine.h"
 #include "visibility_polygon.h"
 
+
+// Flag the nodes that can cast a shadow boundary as seen from the observer
+std::vector<bool> FindSilhouetteNodes(const olc::vf2d& vObserver, const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments)
+{
+	std::vector<int> offsets, adjacentSegments;
+	BuildNodeAdjacency(int(nodes.size()), segments, &offsets, &adjacentSegments);
+
+	std::vector<bool> silhouette(nodes.size(), false);
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		// Open end-points always cast a shadow boundary
+		int nDegree = offsets[i + 1] - offsets[i];
+		if (nDegree <= 1)
+		{
+			silhouette[i] = (nDegree == 1);
+			continue;
+		}
+		// The ray grazes the node only if no segment blocks it on the other side
+		olc::vf2d vRay = nodes[i] - vObserver;
+		bool bLeft = false;
+		bool bRight = false;
+		for (int j = offsets[i]; j < offsets[i + 1]; j++)
+		{
+			const std::array<int, 2>& segment = segments[adjacentSegments[j]];
+			int i_other = (segment[0] == i) ? segment[1] : segment[0];
+			float fSide = vRay.cross(nodes[i_other] - nodes[i]);
+			if (fSide > 0.0f) { bLeft = true; }
+			if (fSide < 0.0f) { bRight = true; }
+		}
+		silhouette[i] = !(bLeft && bRight);
+	}
+	return silhouette;
+}
+
+// Compute the polygon visible from "vMP_W" within the screen bounding box
 std::vector<olc::vf2d> VisibilityPolygon(const olc::vf2d& vMP_W, const olc::vf2d& vTL_W, const olc::vf2d& vTR_W, const olc::vf2d& vBR_W, const olc::vf2d& vBL_W,
-	const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const std::vector<olc::vf2d>& intersections)
+	const std::vector<olc::vf2d>& nodes, const std::vector<std::array<int, 2>>& segments, const std::vector<olc::vf2d>& intersections,
+	const PrefabScene* prefabs, const std::vector<Primitive>* primitives)
 {
 	// Add screen edges to the list of nodes
 	std::vector<olc::vf2d> nodes_edg;
@@ -37,9 +73,60 @@ std::vector<olc::vf2d> VisibilityPolygon(const olc::vf2d& vMP_W, const olc::vf2d
 		}
 	}
 
+	// Rays towards the nodes of the visible prefab instances and their intersections with the screen edges
+	std::vector<olc::vf2d> nodes_prefab;
+	std::vector<bool> silhouette_prefab;
+	if (prefabs)
+	{
+		std::vector<int32_t> visibleInstances;
+		prefabs->FindInstancesInBox(vBL_W, vTR_W, &visibleInstances);
+		for (int32_t i_instance : visibleInstances)
+		{
+			const PrefabInstance& instance = prefabs->GetInstance(i_instance);
+			const Prefab& prefab = prefabs->GetPrefab(instance.nPrefab);
+			std::vector<bool> silhouette = FindSilhouetteNodes(prefabs->ToLocal(instance, vMP_W), prefab.nodes, prefab.segments);
+			for (int i = 0; i < prefab.nodes.size(); i++)
+			{
+				nodes_prefab.push_back(prefabs->ToWorld(instance, prefab.nodes[i]));
+				silhouette_prefab.push_back(silhouette[i]);
+			}
+			for (int i = 0; i < 4; i++)
+			{
+				olc::vf2d vEdgeStart = prefabs->ToLocal(instance, nodes_edg[segments_edg[i][0]]);
+				olc::vf2d vEdgeEnd = prefabs->ToLocal(instance, nodes_edg[segments_edg[i][1]]);
+				olc::vf2d vIntersectionPoint;
+				for (int j = 0; j < prefab.segments.size(); j++)
+				{
+					if (SegmentToSegmentIntersection(vEdgeStart, vEdgeEnd, prefab.nodes[prefab.segments[j][0]], prefab.nodes[prefab.segments[j][1]], &vIntersectionPoint))
+					{
+						intersections_edg.push_back(prefabs->ToWorld(instance, vIntersectionPoint));
+					}
+				}
+			}
+		}
+	}
+
+	// Rays towards the silhouettes of the primitives on the screen and their intersections with the screen edges
+	std::vector<olc::vf2d> nodes_primitive;
+	std::vector<int> primitives_visible;
+	if (primitives)
+	{
+		for (int i = 0; i < primitives->size(); i++)
+		{
+			const Primitive& primitive = (*primitives)[i];
+			if (primitive.vMax.x < vBL_W.x || primitive.vMax.y < vBL_W.y || primitive.vMin.x > vTR_W.x || primitive.vMin.y > vTR_W.y) { continue; }
+			primitives_visible.push_back(i);
+			FindPrimitiveSilhouette(vMP_W, primitive, &nodes_primitive);
+			for (int j = 0; j < 4; j++)
+			{
+				SegmentToPrimitiveIntersections(nodes_edg[segments_edg[j][0]], nodes_edg[segments_edg[j][1]], primitive, &intersections_edg);
+			}
+		}
+	}
+
 	// Create a list of rays all rays
 	std::vector<olc::vf2d> rays_all;
-	rays_all.reserve(4 + intersections_edg.size() + 3 * nodes.size() + 3 * intersections.size());
+	rays_all.reserve(4 + intersections_edg.size() + 3 * nodes.size() + 3 * nodes_prefab.size() + 3 * nodes_primitive.size() + 3 * intersections.size());
 	for (int i = 0; i < 4; i++)
 	{
 		rays_all.push_back(nodes_edg[i]);
@@ -48,12 +135,28 @@ std::vector<olc::vf2d> VisibilityPolygon(const olc::vf2d& vMP_W, const olc::vf2d
 	{
 		rays_all.push_back(intersections_edg[i]);
 	}
+	// Every node is a corner of the polygon if it is visible, only the silhouette nodes need the two rays past it
+	std::vector<bool> silhouette = FindSilhouetteNodes(vMP_W, nodes, segments);
 	for (int i = 0; i < nodes.size(); i++)
 	{
-		rays_all.push_back(RotatePoint(nodes[i], -0.000001f, vMP_W));
 		rays_all.push_back(nodes[i]);
+		if (!silhouette[i]) { continue; }
+		rays_all.push_back(RotatePoint(nodes[i], -0.000001f, vMP_W));
 		rays_all.push_back(RotatePoint(nodes[i], 0.000001f, vMP_W));
 	}
+	for (int i = 0; i < nodes_prefab.size(); i++)
+	{
+		rays_all.push_back(nodes_prefab[i]);
+		if (!silhouette_prefab[i]) { continue; }
+		rays_all.push_back(RotatePoint(nodes_prefab[i], -0.000001f, vMP_W));
+		rays_all.push_back(RotatePoint(nodes_prefab[i], 0.000001f, vMP_W));
+	}
+	for (int i = 0; i < nodes_primitive.size(); i++)
+	{
+		rays_all.push_back(RotatePoint(nodes_primitive[i], -0.000001f, vMP_W));
+		rays_all.push_back(nodes_primitive[i]);
+		rays_all.push_back(RotatePoint(nodes_primitive[i], 0.000001f, vMP_W));
+	}
 	for (int i = 0; i < intersections.size(); i++)
 	{
 		rays_all.push_back(RotatePoint(intersections[i], -0.000001f, vMP_W));
@@ -125,6 +228,24 @@ std::vector<olc::vf2d> VisibilityPolygon(const olc::vf2d& vMP_W, const olc::vf2d
 				vRayIntersections.push_back(vIntersectionPoint);
 			}
 		}
+		// Closest hit with the prefab instances
+		float fT;
+		if (prefabs && prefabs->RayCast(vMP_W, rays_active[i], &fT))
+		{
+			vIntersectionPoint = vMP_W + fT * (rays_active[i] - vMP_W);
+			vRayIntersectionDistances.push_back(EuclideanDistanceSquared(vMP_W, vIntersectionPoint));
+			vRayIntersections.push_back(vIntersectionPoint);
+		}
+		// Closest hit with the primitives, the box test inside rejects most of them
+		for (int j = 0; j < primitives_visible.size(); j++)
+		{
+			if (RayToPrimitiveIntersection(vMP_W, rays_active[i], (*primitives)[primitives_visible[j]], &fT))
+			{
+				vIntersectionPoint = vMP_W + fT * (rays_active[i] - vMP_W);
+				vRayIntersectionDistances.push_back(EuclideanDistanceSquared(vMP_W, vIntersectionPoint));
+				vRayIntersections.push_back(vIntersectionPoint);
+			}
+		}
 		// Find closest intersection
 		if (vRayIntersections.size() == 1)
 		{